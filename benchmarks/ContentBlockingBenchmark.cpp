@@ -0,0 +1,303 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2024 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "../src/core/AdblockContentFiltersProfile.h"
+#include "../src/core/Console.h"
+#include "../src/core/ContentFiltersManager.h"
+#include "../src/core/JsonSettings.h"
+#include "../src/core/SessionsManager.h"
+#include "../src/core/SettingsManager.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTextStream>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+
+using namespace Otter;
+
+struct CorpusEntry final
+{
+	QUrl baseUrl;
+	QUrl requestUrl;
+	NetworkManager::ResourceType resourceType = NetworkManager::OtherType;
+};
+
+qint64 getPeakMemoryUsage()
+{
+#ifdef Q_OS_UNIX
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef Q_OS_MACOS
+		return static_cast<qint64>(usage.ru_maxrss);
+#else
+		return (static_cast<qint64>(usage.ru_maxrss) * 1024);
+#endif
+	}
+#endif
+
+	return -1;
+}
+
+QVector<CorpusEntry> loadCorpus(const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return {};
+	}
+
+	QVector<CorpusEntry> entries;
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+
+	while (!stream.atEnd())
+	{
+		const QStringList fields(stream.readLine().split(QLatin1Char('\t')));
+
+		if (fields.count() != 3)
+		{
+			continue;
+		}
+
+		bool isValid(false);
+		const int resourceType(fields.at(0).toInt(&isValid));
+
+		if (!isValid || resourceType < NetworkManager::OtherType || resourceType > NetworkManager::WebSocketType)
+		{
+			continue;
+		}
+
+		CorpusEntry entry;
+		entry.baseUrl = QUrl::fromEncoded(fields.at(1).toUtf8());
+		entry.requestUrl = QUrl::fromEncoded(fields.at(2).toUtf8());
+		entry.resourceType = static_cast<NetworkManager::ResourceType>(resourceType);
+
+		entries.append(entry);
+	}
+
+	file.close();
+
+	return entries;
+}
+
+ContentFiltersManager::CheckResult checkUrl(const QVector<ContentFiltersProfile*> &profiles, const CorpusEntry &entry)
+{
+	ContentFiltersManager::CheckResult result;
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		const ContentFiltersManager::CheckResult currentResult(profiles.at(i)->checkUrl(entry.baseUrl, entry.requestUrl, entry.resourceType));
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
+		}
+	}
+
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication application(argc, argv);
+	QCoreApplication::setApplicationName(QLatin1String("otter-browser-content-blocking-benchmark"));
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription(QLatin1String("Replays recorded requests through content blocking profiles.\nCorpus lines contain resource type, base URL and request URL separated by tabs, as written by ContentBlocking/RecordRequestsPath."));
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption(QLatin1String("profile"), QLatin1String("Uses <path> as profile directory containing contentBlocking/*.txt"), QLatin1String("path")));
+	parser.addOption(QCommandLineOption(QLatin1String("corpus"), QLatin1String("Replays requests recorded in <path>"), QLatin1String("path")));
+	parser.addOption(QCommandLineOption(QLatin1String("profiles"), QLatin1String("Comma separated <names> of content blocking profiles, all by default"), QLatin1String("names")));
+	parser.addOption(QCommandLineOption(QLatin1String("iterations"), QLatin1String("Replays corpus <amount> times"), QLatin1String("amount"), QLatin1String("1")));
+	parser.addOption(QCommandLineOption(QLatin1String("readonly"), QLatin1String("Does not write rules cache files")));
+	parser.process(application);
+
+	QTextStream output(stdout);
+	const QString profilePath(QDir(parser.value(QLatin1String("profile"))).absolutePath());
+
+	if (!parser.isSet(QLatin1String("profile")) || !QFile::exists(profilePath))
+	{
+		output << "Profile directory not found\n";
+
+		return 1;
+	}
+
+	const QString sourcePath(QDir(profilePath).filePath(QLatin1String("contentBlocking")));
+	QStringList names(parser.isSet(QLatin1String("profiles")) ? parser.value(QLatin1String("profiles")).split(QLatin1Char(','), Qt::SkipEmptyParts) : QStringList());
+
+	if (names.isEmpty())
+	{
+		const QList<QFileInfo> existingProfiles(QDir(sourcePath).entryInfoList({QLatin1String("*.txt")}, QDir::Files, QDir::Name));
+
+		for (int i = 0; i < existingProfiles.count(); ++i)
+		{
+			names.append(existingProfiles.at(i).completeBaseName());
+		}
+	}
+
+	QTemporaryDir temporaryDirectory;
+
+	if (!temporaryDirectory.isValid() || !QDir(temporaryDirectory.path()).mkpath(QLatin1String("contentBlocking")))
+	{
+		output << "Failed to create temporary profile directory\n";
+
+		return 1;
+	}
+
+	const QString temporaryPath(QDir(temporaryDirectory.path()).filePath(QLatin1String("contentBlocking")));
+	const QJsonObject settingsObject(JsonSettings(QDir(profilePath).filePath(QLatin1String("contentBlocking.json"))).object());
+
+	Console::createInstance();
+	SessionsManager::createInstance(temporaryDirectory.path(), QDir(temporaryDirectory.path()).filePath(QLatin1String("cache")), false, parser.isSet(QLatin1String("readonly")));
+	SettingsManager::createInstance(temporaryDirectory.path());
+	ContentFiltersManager::setPendingRequestsPolicy(ContentFiltersManager::WaitForProfilesPolicy);
+
+	QVector<ContentFiltersProfile*> profiles;
+	const QUrl loadUrl(QLatin1String("http://example.com/"));
+
+	for (int i = 0; i < names.count(); ++i)
+	{
+		const QString &name(names.at(i));
+
+		if (!QFile::copy(QDir(sourcePath).filePath(name + QLatin1String(".txt")), QDir(temporaryPath).filePath(name + QLatin1String(".txt"))))
+		{
+			output << "Profile " << name << " not found\n";
+
+			continue;
+		}
+
+		QFile::copy(QDir(sourcePath).filePath(name + QLatin1String(".dat")), QDir(temporaryPath).filePath(name + QLatin1String(".dat")));
+
+		const QJsonObject profileObject(settingsObject.value(name).toObject());
+		const QString cosmeticFiltersMode(profileObject.value(QLatin1String("cosmeticFiltersMode")).toString());
+		ContentFiltersProfile::ProfileSummary profileSummary;
+		profileSummary.name = name;
+		profileSummary.areWildcardsEnabled = profileObject.value(QLatin1String("areWildcardsEnabled")).toBool();
+
+		if (cosmeticFiltersMode == QLatin1String("none"))
+		{
+			profileSummary.cosmeticFiltersMode = ContentFiltersManager::NoFilters;
+		}
+		else if (cosmeticFiltersMode == QLatin1String("domainOnly"))
+		{
+			profileSummary.cosmeticFiltersMode = ContentFiltersManager::DomainOnlyFilters;
+		}
+
+		const qint64 peakMemoryUsage(getPeakMemoryUsage());
+		QElapsedTimer timer;
+		timer.start();
+
+		ContentFiltersProfile *profile(new AdblockContentFiltersProfile(profileSummary, {}, ContentFiltersProfile::NoFlags, &application));
+		profile->checkUrl(loadUrl, loadUrl, NetworkManager::OtherType);
+
+		const qint64 loadTime(timer.nsecsElapsed());
+
+		output << "Profile: " << profile->getName() << '\n';
+		output << "  load time: " << QString::number((loadTime / 1000000.0), 'f', 2) << " ms\n";
+		output << "  rules memory: " << profile->getMemoryUsage() << " bytes\n";
+		output << "  peak memory growth: " << qMax(qint64(0), (getPeakMemoryUsage() - peakMemoryUsage)) << " bytes\n";
+
+		profiles.append(profile);
+	}
+
+	if (profiles.isEmpty())
+	{
+		output << "No content blocking profiles found\n";
+
+		return 1;
+	}
+
+	output << "Peak memory: " << getPeakMemoryUsage() << " bytes\n";
+
+	if (!parser.isSet(QLatin1String("corpus")))
+	{
+		return 0;
+	}
+
+	const QVector<CorpusEntry> entries(loadCorpus(parser.value(QLatin1String("corpus"))));
+
+	if (entries.isEmpty())
+	{
+		output << "Corpus is empty or could not be read\n";
+
+		return 1;
+	}
+
+	const int iterations(qMax(1, parser.value(QLatin1String("iterations")).toInt()));
+	QVector<qint64> latencies;
+	latencies.reserve(entries.count() * iterations);
+
+	int blockedAmount(0);
+	QElapsedTimer totalTimer;
+	totalTimer.start();
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		for (int j = 0; j < entries.count(); ++j)
+		{
+			const CorpusEntry &entry(entries.at(j));
+			QElapsedTimer timer;
+			timer.start();
+
+			const ContentFiltersManager::CheckResult result(checkUrl(profiles, entry));
+
+			latencies.append(timer.nsecsElapsed());
+
+			if (i == 0 && result.isBlocked)
+			{
+				++blockedAmount;
+			}
+		}
+	}
+
+	const qint64 totalTime(totalTimer.nsecsElapsed());
+
+	std::sort(latencies.begin(), latencies.end());
+
+	const auto getPercentile([&](double percentile) -> double
+	{
+		const int index(qBound(0, static_cast<int>(latencies.count() * percentile), (latencies.count() - 1)));
+
+		return (latencies.at(index) / 1000.0);
+	});
+
+	output << "Requests: " << entries.count() << " x " << iterations << ", blocked: " << blockedAmount << '\n';
+	output << "Latency p50: " << QString::number(getPercentile(0.5), 'f', 2) << " us\n";
+	output << "Latency p99: " << QString::number(getPercentile(0.99), 'f', 2) << " us\n";
+	output << "Throughput: " << QString::number((latencies.count() / (totalTime / 1000000000.0)), 'f', 0) << " requests/s\n";
+
+	return 0;
+}
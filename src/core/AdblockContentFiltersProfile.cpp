@@ -28,8 +28,11 @@
 #include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QBuffer>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
 #include <QtCore/QSaveFile>
+#include <QtCore/QSysInfo>
 #include <QtCore/QTextStream>
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMessageBox>
@@ -41,12 +44,13 @@ QHash<QString, AdblockContentFiltersProfile::RuleOption> AdblockContentFiltersPr
 QHash<NetworkManager::ResourceType, AdblockContentFiltersProfile::RuleOption> AdblockContentFiltersProfile::m_resourceTypes({{NetworkManager::ImageType, ImageOption}, {NetworkManager::ScriptType, ScriptOption}, {NetworkManager::StyleSheetType, StyleSheetOption}, {NetworkManager::ObjectType, ObjectOption}, {NetworkManager::XmlHttpRequestType, XmlHttpRequestOption}, {NetworkManager::SubFrameType, SubDocumentOption},{NetworkManager::PopupType, PopupOption}, {NetworkManager::ObjectSubrequestType, ObjectSubRequestOption}, {NetworkManager::WebSocketType, WebSocketOption}});
 
 AdblockContentFiltersProfile::AdblockContentFiltersProfile(const ContentFiltersProfile::ProfileSummary &profileSummary, const QStringList &languages, ContentFiltersProfile::ProfileFlags flags, QObject *parent) : ContentFiltersProfile(parent),
-	m_root(nullptr),
 	m_dataFetchJob(nullptr),
+	m_updateWatcher(nullptr),
 	m_profileSummary(profileSummary),
+	m_rulesStorage(std::make_shared<RulesStorage>()),
 	m_error(NoError),
 	m_flags(flags),
-	m_wasLoaded(false)
+	m_isFetchingDiff(false)
 {
 	if (!languages.isEmpty())
 	{
@@ -73,21 +77,49 @@ AdblockContentFiltersProfile::AdblockContentFiltersProfile(const ContentFiltersP
 
 void AdblockContentFiltersProfile::clear()
 {
-	if (!m_wasLoaded)
+	QMutexLocker locker(&m_rulesStorage->mutex);
+
+	if (!m_rulesStorage->isRequested)
 	{
 		return;
 	}
 
-	if (m_root)
+	++m_rulesStorage->generation;
+
+	m_rulesStorage->isLoading = false;
+	m_rulesStorage->isRequested = false;
+
+	std::atomic_store(&m_rulesStorage->snapshot, std::shared_ptr<const RulesSnapshot>());
+
+	m_rulesStorage->condition.wakeAll();
+
+	ContentFiltersManager::invalidateCaches();
+}
+
+void AdblockContentFiltersProfile::load()
+{
+	if (thread() != QThread::currentThread())
 	{
-		QtConcurrent::run(this, &AdblockContentFiltersProfile::deleteNode, m_root);
+		QMetaObject::invokeMethod(this, [=]()
+		{
+			load();
+		}, Qt::QueuedConnection);
+
+		return;
 	}
 
-	m_cosmeticFiltersRules.clear();
-	m_cosmeticFiltersDomainExceptions.clear();
-	m_cosmeticFiltersDomainRules.clear();
+	bool isRequested(false);
+
+	{
+		QMutexLocker locker(&m_rulesStorage->mutex);
+
+		isRequested = m_rulesStorage->isRequested;
+	}
 
-	m_wasLoaded = false;
+	if (!isRequested)
+	{
+		loadRules();
+	}
 }
 
 void AdblockContentFiltersProfile::loadHeader()
@@ -119,18 +151,83 @@ void AdblockContentFiltersProfile::loadHeader()
 		return;
 	}
 
+	applyHeader(information);
+
+	if (!m_dataFetchJob && m_profileSummary.updateInterval > 0 && (!m_profileSummary.lastUpdate.isValid() || m_profileSummary.lastUpdate.daysTo(QDateTime::currentDateTimeUtc()) > m_profileSummary.updateInterval))
+	{
+		update();
+	}
+}
+
+void AdblockContentFiltersProfile::applyHeader(const HeaderInformation &information)
+{
 	if (!m_flags.testFlag(HasCustomTitleFlag) && !information.title.isEmpty())
 	{
 		m_profileSummary.title = information.title;
 	}
 
-	if (!m_dataFetchJob && m_profileSummary.updateInterval > 0 && (!m_profileSummary.lastUpdate.isValid() || m_profileSummary.lastUpdate.daysTo(QDateTime::currentDateTimeUtc()) > m_profileSummary.updateInterval))
+	m_diffPath = information.diffPath;
+}
+
+void AdblockContentFiltersProfile::loadRules()
+{
+	const QString path(getPath());
+	const std::shared_ptr<RulesStorage> storage(m_rulesStorage);
+
+	m_error = NoError;
+
+	QMutexLocker locker(&storage->mutex);
+
+	++storage->generation;
+
+	storage->isRequested = true;
+
+	if (!QFile::exists(path))
 	{
-		update();
+		storage->isLoading = false;
+		storage->condition.wakeAll();
+
+		locker.unlock();
+
+		if (!m_profileSummary.updateUrl.isEmpty())
+		{
+			update();
+		}
+
+		return;
 	}
+
+	storage->isLoading = true;
+
+	const quint64 generation(storage->generation);
+
+	locker.unlock();
+
+	const ProfileSummary profileSummary(m_profileSummary);
+	const QString cachePath(getRulesCachePath());
+
+	QtConcurrent::run([=]()
+	{
+		const std::shared_ptr<const RulesSnapshot> snapshot(createSnapshot(profileSummary, path, cachePath));
+		QMutexLocker snapshotLocker(&storage->mutex);
+
+		if (storage->generation == generation)
+		{
+			std::atomic_store(&storage->snapshot, snapshot);
+
+			storage->isLoading = false;
+			storage->condition.wakeAll();
+
+			snapshotLocker.unlock();
+
+			ContentFiltersManager::invalidateCaches();
+
+			emit ContentFiltersManager::getInstance()->profileLoaded(profileSummary.name);
+		}
+	});
 }
 
-void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
+void AdblockContentFiltersProfile::parseRuleLine(const QString &rule, const ContentFiltersProfile::ProfileSummary &profileSummary, RulesSnapshot *snapshot, QVector<RuleDefinition> *definitions)
 {
 	if (rule.isEmpty() || rule.startsWith(QLatin1Char('!')))
 	{
@@ -139,9 +236,9 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 
 	if (rule.startsWith(QLatin1String("##")))
 	{
-		if (m_profileSummary.cosmeticFiltersMode == ContentFiltersManager::AllFilters)
+		if (profileSummary.cosmeticFiltersMode == ContentFiltersManager::AllFilters)
 		{
-			m_cosmeticFiltersRules.append(rule.mid(2));
+			snapshot->cosmeticFiltersRules.append(rule.mid(2));
 		}
 
 		return;
@@ -149,9 +246,9 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 
 	if (rule.contains(QLatin1String("##")))
 	{
-		if (m_profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
+		if (profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
 		{
-			parseStyleSheetRule(rule.split(QLatin1String("##")), m_cosmeticFiltersDomainRules);
+			parseStyleSheetRule(rule.split(QLatin1String("##")), snapshot->cosmeticFiltersDomainRules);
 		}
 
 		return;
@@ -159,9 +256,9 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 
 	if (rule.contains(QLatin1String("#@#")))
 	{
-		if (m_profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
+		if (profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
 		{
-			parseStyleSheetRule(rule.split(QLatin1String("#@#")), m_cosmeticFiltersDomainExceptions);
+			parseStyleSheetRule(rule.split(QLatin1String("#@#")), snapshot->cosmeticFiltersDomainExceptions);
 		}
 
 		return;
@@ -186,37 +283,37 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 		line = line.mid(1);
 	}
 
-	if (!m_profileSummary.areWildcardsEnabled && line.contains(QLatin1Char('*')))
+	if (!profileSummary.areWildcardsEnabled && line.contains(QLatin1Char('*')))
 	{
 		return;
 	}
 
-	Node::Rule *definition(new Node::Rule());
-	definition->rule = rule;
-	definition->isException = line.startsWith(QLatin1String("@@"));
+	RuleDefinition definition;
+	definition.rule = rule;
+	definition.isException = line.startsWith(QLatin1String("@@"));
 
-	if (definition->isException)
+	if (definition.isException)
 	{
 		line = line.mid(2);
 	}
 
-	definition->needsDomainCheck = line.startsWith(QLatin1String("||"));
+	definition.needsDomainCheck = line.startsWith(QLatin1String("||"));
 
-	if (definition->needsDomainCheck)
+	if (definition.needsDomainCheck)
 	{
 		line = line.mid(2);
 	}
 
 	if (line.startsWith(QLatin1Char('|')))
 	{
-		definition->ruleMatch = StartMatch;
+		definition.ruleMatch = StartMatch;
 
 		line = line.mid(1);
 	}
 
 	if (line.endsWith(QLatin1Char('|')))
 	{
-		definition->ruleMatch = ((definition->ruleMatch == StartMatch) ? ExactMatch : EndMatch);
+		definition.ruleMatch = ((definition.ruleMatch == StartMatch) ? ExactMatch : EndMatch);
 
 		line = line.left(line.length() - 1);
 	}
@@ -230,18 +327,18 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 		{
 			const RuleOption option(m_options.value(optionName));
 
-			if ((!definition->isException || isOptionException) && (option == ElementHideOption || option == GenericHideOption))
+			if ((!definition.isException || isOptionException) && (option == ElementHideOption || option == GenericHideOption))
 			{
 				continue;
 			}
 
 			if (!isOptionException)
 			{
-				definition->ruleOptions |= option;
+				definition.ruleOptions |= option;
 			}
 			else if (option != WebSocketOption && option != PopupOption)
 			{
-				definition->ruleExceptions |= option;
+				definition.ruleExceptions |= option;
 			}
 		}
 		else if (optionName.startsWith(QLatin1String("domain")))
@@ -252,11 +349,11 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 			{
 				if (parsedDomains.at(j).startsWith(QLatin1Char('~')))
 				{
-					definition->allowedDomains.append(parsedDomains.at(j).mid(1));
+					definition.allowedDomains.append(parsedDomains.at(j).mid(1));
 				}
 				else
 				{
-					definition->blockedDomains.append(parsedDomains.at(j));
+					definition.blockedDomains.append(parsedDomains.at(j));
 				}
 			}
 		}
@@ -266,46 +363,9 @@ void AdblockContentFiltersProfile::parseRuleLine(const QString &rule)
 		}
 	}
 
-	Node *node(m_root);
-
-	for (int i = 0; i < line.length(); ++i)
-	{
-		const QChar value(line.at(i));
-		bool hasChildren(false);
-
-		for (int j = 0; j < node->children.count(); ++j)
-		{
-			Node *nextNode(node->children.at(j));
-
-			if (nextNode->value == value)
-			{
-				node = nextNode;
-
-				hasChildren = true;
-
-				break;
-			}
-		}
-
-		if (!hasChildren)
-		{
-			Node *newNode(new Node());
-			newNode->value = value;
-
-			if (value == QLatin1Char('^'))
-			{
-				node->children.insert(0, newNode);
-			}
-			else
-			{
-				node->children.append(newNode);
-			}
-
-			node = newNode;
-		}
-	}
+	definition.pattern = line;
 
-	node->rules.append(definition);
+	definitions->append(definition);
 }
 
 void AdblockContentFiltersProfile::parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list)
@@ -318,178 +378,185 @@ void AdblockContentFiltersProfile::parseStyleSheetRule(const QStringList &line,
 	}
 }
 
-void AdblockContentFiltersProfile::deleteNode(Node *node) const
+QByteArray AdblockContentFiltersProfile::compileRules(const QVector<RuleDefinition> &definitions)
 {
-	for (int i = 0; i < node->children.count(); ++i)
-	{
-		deleteNode(node->children.at(i));
-	}
+	QVector<QVector<quint32> > rulesTokens;
+	rulesTokens.reserve(definitions.count());
 
-	for (int i = 0; i < node->rules.count(); ++i)
+	QHash<quint32, int> tokensFrequency;
+
+	for (int i = 0; i < definitions.count(); ++i)
 	{
-		delete node->rules.at(i);
+		const QVector<quint32> tokens(getRuleTokens(definitions.at(i)));
+
+		for (int j = 0; j < tokens.count(); ++j)
+		{
+			++tokensFrequency[tokens.at(j)];
+		}
+
+		rulesTokens.append(tokens);
 	}
 
-	delete node;
-}
+	QHash<quint32, QVector<quint32> > tokenizedRules;
+	QVector<quint32> rulesReferences;
+	QVector<Rule> rules;
+	QVector<DomainReference> domains;
+	QHash<QString, StringReference> internedStrings;
+	QString strings;
 
-ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkUrlSubstring(const Node *node, const QString &subString, QString currentRule, const Request &request) const
-{
-	ContentFiltersManager::CheckResult result;
-	ContentFiltersManager::CheckResult currentResult;
+	tokenizedRules.reserve(tokensFrequency.count());
+	rules.reserve(definitions.count());
 
-	for (int i = 0; i < subString.length(); ++i)
+	const auto internString([&](const QString &string) -> StringReference
 	{
-		const QChar treeChar(subString.at(i));
-		bool childrenExists(false);
+		const QHash<QString, StringReference>::const_iterator iterator(internedStrings.constFind(string));
 
-		currentResult = evaluateNodeRules(node, currentRule, request);
-
-		if (currentResult.isBlocked)
+		if (iterator != internedStrings.constEnd())
 		{
-			result = currentResult;
+			return iterator.value();
 		}
-		else if (currentResult.isException)
+
+		StringReference reference;
+		reference.position = static_cast<quint32>(strings.length());
+		reference.length = static_cast<quint32>(string.length());
+
+		strings.append(string);
+
+		internedStrings.insert(string, reference);
+
+		return reference;
+	});
+
+	for (int i = 0; i < definitions.count(); ++i)
+	{
+		const RuleDefinition &definition(definitions.at(i));
+		const int patternOffset(definition.rule.indexOf(definition.pattern));
+		Rule rule;
+		rule.rule = internString(definition.rule);
+		rule.ruleOptions = static_cast<quint16>(definition.ruleOptions);
+		rule.ruleExceptions = static_cast<quint16>(definition.ruleExceptions);
+		rule.ruleMatch = static_cast<quint8>(definition.ruleMatch);
+		rule.isException = definition.isException;
+		rule.needsDomainCheck = definition.needsDomainCheck;
+		rule.domainsPosition = static_cast<quint32>(domains.count());
+		rule.blockedDomainsAmount = static_cast<quint16>(qMin(definition.blockedDomains.count(), 0xFFFF));
+		rule.allowedDomainsAmount = static_cast<quint16>(qMin(definition.allowedDomains.count(), 0xFFFF));
+
+		if (patternOffset >= 0)
 		{
-			return currentResult;
+			rule.pattern.position = (rule.rule.position + static_cast<quint32>(patternOffset));
+			rule.pattern.length = static_cast<quint32>(definition.pattern.length());
 		}
-
-		for (int j = 0; j < node->children.count(); ++j)
+		else
 		{
-			const Node *nextNode(node->children.at(j));
+			rule.pattern = internString(definition.pattern);
+		}
 
-			if (nextNode->value == QLatin1Char('*'))
-			{
-				const QString wildcardSubString(subString.mid(i));
+		const QVector<QPair<const QStringList*, int> > domainLists({{&definition.blockedDomains, rule.blockedDomainsAmount}, {&definition.allowedDomains, rule.allowedDomainsAmount}});
 
-				for (int k = 0; k < wildcardSubString.length(); ++k)
-				{
-					currentResult = checkUrlSubstring(nextNode, wildcardSubString.right(wildcardSubString.length() - k), (currentRule + wildcardSubString.left(k)), request);
-
-					if (currentResult.isBlocked)
-					{
-						result = currentResult;
-					}
-					else if (currentResult.isException)
-					{
-						return currentResult;
-					}
-				}
-			}
+		for (int j = 0; j < domainLists.count(); ++j)
+		{
+			const int listPosition(domains.count());
 
-			if (nextNode->value == QLatin1Char('^') && !treeChar.isDigit() && !treeChar.isLetter() && treeChar != QLatin1Char('_') && treeChar != QLatin1Char('-') && treeChar != QLatin1Char('.') && treeChar != QLatin1Char('%'))
+			for (int k = 0; k < domainLists.at(j).second; ++k)
 			{
-				currentResult = checkUrlSubstring(nextNode, subString.mid(i), currentRule, request);
+				const QString &domain(domainLists.at(j).first->at(k));
+				DomainReference reference;
+				reference.domain = internString(domain);
+				reference.hash = qHash(domain);
 
-				if (currentResult.isBlocked)
-				{
-					result = currentResult;
-				}
-				else if (currentResult.isException)
-				{
-					return currentResult;
-				}
+				domains.append(reference);
 			}
 
-			if (nextNode->value == treeChar)
+			std::sort((domains.begin() + listPosition), domains.end(), [&](const DomainReference &first, const DomainReference &second)
 			{
-				node = nextNode;
-
-				childrenExists = true;
-
-				break;
-			}
-		}
-
-		if (!childrenExists)
-		{
-			return result;
+				return (first.hash < second.hash);
+			});
 		}
 
-		currentRule += treeChar;
-	}
-
-	currentResult = evaluateNodeRules(node, currentRule, request);
+		rules.append(rule);
 
-	if (currentResult.isBlocked)
-	{
-		result = currentResult;
-	}
-	else if (currentResult.isException)
-	{
-		return currentResult;
-	}
+		const QVector<quint32> &tokens(rulesTokens.at(i));
 
-	for (int i = 0; i < node->children.count(); ++i)
-	{
-		if (node->children.at(i)->value != QLatin1Char('^'))
+		if (tokens.isEmpty())
 		{
+			rulesReferences.append(static_cast<quint32>(i));
+
 			continue;
 		}
 
-		currentResult = evaluateNodeRules(node, currentRule, request);
+		quint32 rarestToken(tokens.at(0));
+		int rarestFrequency(tokensFrequency.value(rarestToken));
 
-		if (currentResult.isBlocked)
-		{
-			result = currentResult;
-		}
-		else if (currentResult.isException)
+		for (int j = 1; j < tokens.count(); ++j)
 		{
-			return currentResult;
-		}
-	}
-
-	return result;
-}
+			const int frequency(tokensFrequency.value(tokens.at(j)));
 
-ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkRuleMatch(const Node::Rule *rule, const QString &currentRule, const Request &request) const
-{
-	switch (rule->ruleMatch)
-	{
-		case StartMatch:
-			if (!request.requestUrl.startsWith(currentRule))
+			if (frequency < rarestFrequency)
 			{
-				return {};
+				rarestToken = tokens.at(j);
+				rarestFrequency = frequency;
 			}
+		}
 
-			break;
-		case EndMatch:
-			if (!request.requestUrl.endsWith(currentRule))
-			{
-				return {};
-			}
+		tokenizedRules[rarestToken].append(static_cast<quint32>(i));
+	}
 
-			break;
-		case ExactMatch:
-			if (request.requestUrl != currentRule)
-			{
-				return {};
-			}
+	RulesIndex::Header header;
+	header.rulesAmount = static_cast<quint32>(rules.count());
+	header.bucketsAmount = static_cast<quint32>(tokenizedRules.count());
+	header.untokenizedRulesAmount = static_cast<quint32>(rulesReferences.count());
+	header.domainsAmount = static_cast<quint32>(domains.count());
+	header.stringsLength = static_cast<quint32>(strings.length());
 
-			break;
-		default:
-			if (!request.requestUrl.contains(currentRule))
-			{
-				return {};
-			}
+	QList<quint32> tokens(tokenizedRules.keys());
+	QVector<RulesBucket> buckets;
+	buckets.reserve(tokens.count());
 
-			break;
+	std::sort(tokens.begin(), tokens.end());
+
+	for (int i = 0; i < tokens.count(); ++i)
+	{
+		const QVector<quint32> &bucketRules(tokenizedRules[tokens.at(i)]);
+		RulesBucket bucket;
+		bucket.token = tokens.at(i);
+		bucket.position = static_cast<quint32>(rulesReferences.count());
+		bucket.amount = static_cast<quint32>(bucketRules.count());
+
+		rulesReferences.append(bucketRules);
+		buckets.append(bucket);
 	}
 
-	const QStringList requestSubdomainList(ContentFiltersManager::createSubdomainList(request.requestHost));
+	header.rulesReferencesAmount = static_cast<quint32>(rulesReferences.count());
+
+	QByteArray data;
+	data.reserve(static_cast<int>(sizeof(RulesIndex::Header) + (rules.count() * sizeof(Rule)) + (buckets.count() * sizeof(RulesBucket)) + (rulesReferences.count() * sizeof(quint32)) + (domains.count() * sizeof(DomainReference)) + (strings.length() * sizeof(QChar))));
+	data.append(reinterpret_cast<const char*>(&header), sizeof(RulesIndex::Header));
+	data.append(reinterpret_cast<const char*>(rules.constData()), static_cast<int>(rules.count() * sizeof(Rule)));
+	data.append(reinterpret_cast<const char*>(buckets.constData()), static_cast<int>(buckets.count() * sizeof(RulesBucket)));
+	data.append(reinterpret_cast<const char*>(rulesReferences.constData()), static_cast<int>(rulesReferences.count() * sizeof(quint32)));
+	data.append(reinterpret_cast<const char*>(domains.constData()), static_cast<int>(domains.count() * sizeof(DomainReference)));
+	data.append(reinterpret_cast<const char*>(strings.constData()), static_cast<int>(strings.length() * sizeof(QChar)));
+
+	return data;
+}
 
-	if (rule->needsDomainCheck && !requestSubdomainList.contains(currentRule.left(currentRule.indexOf(m_domainExpression))))
+ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkRuleMatch(const RulesIndex &rulesIndex, const Rule &rule, const Request &request)
+{
+	if (!matchRule(rulesIndex, rule, request))
 	{
 		return {};
 	}
 
-	const bool hasBlockedDomains(!rule->blockedDomains.isEmpty());
-	const bool hasAllowedDomains(!rule->allowedDomains.isEmpty());
+	const RuleOptions ruleOptions(QFlag(rule.ruleOptions));
+	const RuleOptions ruleExceptions(QFlag(rule.ruleExceptions));
+	const bool hasBlockedDomains(rule.blockedDomainsAmount > 0);
+	const bool hasAllowedDomains(rule.allowedDomainsAmount > 0);
 	bool isBlocked(true);
 
 	if (hasBlockedDomains)
 	{
-		isBlocked = resolveDomainExceptions(request.baseHost, rule->blockedDomains);
+		isBlocked = resolveDomainExceptions(rulesIndex, request, rule.domainsPosition, rule.blockedDomainsAmount);
 
 		if (!isBlocked)
 		{
@@ -497,21 +564,21 @@ ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkRuleMatch(
 		}
 	}
 
-	isBlocked = (hasAllowedDomains ? !resolveDomainExceptions(request.baseHost, rule->allowedDomains) : isBlocked);
+	isBlocked = (hasAllowedDomains ? !resolveDomainExceptions(rulesIndex, request, (rule.domainsPosition + rule.blockedDomainsAmount), rule.allowedDomainsAmount) : isBlocked);
 
-	if (rule->ruleOptions.testFlag(ThirdPartyOption) || rule->ruleExceptions.testFlag(ThirdPartyOption))
+	if (ruleOptions.testFlag(ThirdPartyOption) || ruleExceptions.testFlag(ThirdPartyOption))
 	{
-		if (request.baseHost.isEmpty() || requestSubdomainList.contains(request.baseHost))
+		if (request.baseHost.isEmpty() || request.requestSubdomains.contains(request.baseHost))
 		{
-			isBlocked = rule->ruleExceptions.testFlag(ThirdPartyOption);
+			isBlocked = ruleExceptions.testFlag(ThirdPartyOption);
 		}
 		else if (!hasBlockedDomains && !hasAllowedDomains)
 		{
-			isBlocked = rule->ruleOptions.testFlag(ThirdPartyOption);
+			isBlocked = ruleOptions.testFlag(ThirdPartyOption);
 		}
 	}
 
-	if (rule->ruleOptions != NoOption || rule->ruleExceptions != NoOption)
+	if (ruleOptions != NoOption || ruleExceptions != NoOption)
 	{
 		QHash<NetworkManager::ResourceType, RuleOption>::const_iterator iterator;
 
@@ -519,18 +586,18 @@ ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkRuleMatch(
 		{
 			const bool supportsException(iterator.value() != WebSocketOption && iterator.value() != PopupOption);
 
-			if (!rule->ruleOptions.testFlag(iterator.value()) && !(supportsException && rule->ruleExceptions.testFlag(iterator.value())))
+			if (!ruleOptions.testFlag(iterator.value()) && !(supportsException && ruleExceptions.testFlag(iterator.value())))
 			{
 				continue;
 			}
 
 			if (request.resourceType == iterator.key())
 			{
-				isBlocked = (isBlocked ? rule->ruleOptions.testFlag(iterator.value()) : isBlocked);
+				isBlocked = (isBlocked ? ruleOptions.testFlag(iterator.value()) : isBlocked);
 			}
 			else if (supportsException)
 			{
-				isBlocked = (isBlocked ? rule->ruleExceptions.testFlag(iterator.value()) : isBlocked);
+				isBlocked = (isBlocked ? ruleExceptions.testFlag(iterator.value()) : isBlocked);
 			}
 			else
 			{
@@ -549,18 +616,18 @@ ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkRuleMatch(
 	}
 
 	ContentFiltersManager::CheckResult result;
-	result.rule = rule->rule;
+	result.rule = rulesIndex.getString(rule.rule).toString();
 
-	if (rule->isException)
+	if (rule.isException)
 	{
 		result.isBlocked = false;
 		result.isException = true;
 
-		if (rule->ruleOptions.testFlag(ElementHideOption))
+		if (ruleOptions.testFlag(ElementHideOption))
 		{
 			result.comesticFiltersMode = ContentFiltersManager::NoFilters;
 		}
-		else if (rule->ruleOptions.testFlag(GenericHideOption))
+		else if (ruleOptions.testFlag(GenericHideOption))
 		{
 			result.comesticFiltersMode = ContentFiltersManager::DomainOnlyFilters;
 		}
@@ -589,57 +656,115 @@ void AdblockContentFiltersProfile::handleJobFinished(bool isSuccess)
 		return;
 	}
 
-	QIODevice *device(m_dataFetchJob->getData());
+	QNetworkReply *reply(qobject_cast<QNetworkReply*>(m_dataFetchJob->getData()));
+	const int statusCode(m_dataFetchJob->getStatusCode());
+	const bool isFetchingDiff(m_isFetchingDiff);
 
 	m_dataFetchJob->deleteLater();
 	m_dataFetchJob = nullptr;
+	m_isFetchingDiff = false;
 
-	if (!isSuccess)
+	if (isFetchingDiff)
 	{
-		raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(device ? device->errorString() : tr("Download failure")), DownloadError);
+		if (!isSuccess || !reply)
+		{
+			Console::addMessage(QCoreApplication::translate("main", "Failed to apply differential update of content blocking profile, downloading full list"), Console::OtherCategory, Console::WarningLevel, getPath());
 
-		return;
+			if (!startUpdate(m_profileSummary.updateUrl, false))
+			{
+				emit profileModified();
+			}
+
+			return;
+		}
 	}
+	else
+	{
+		if (!isSuccess)
+		{
+			raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(reply ? reply->errorString() : tr("Download failure")), DownloadError);
 
-	QBuffer buffer;
-	buffer.setData(device->readAll());
-	buffer.open(QIODevice::ReadOnly | QIODevice::Text);
+			return;
+		}
 
-	const HeaderInformation information(loadHeader(&buffer));
+		if (statusCode == 304)
+		{
+			m_profileSummary.lastUpdate = QDateTime::currentDateTimeUtc();
 
-	buffer.reset();
+			emit profileModified();
 
-	if (information.hasError())
+			return;
+		}
+
+		m_profileSummary.updateEntityTag = QString::fromLatin1(reply->rawHeader(QByteArrayLiteral("ETag")));
+		m_profileSummary.updateLastModified = QString::fromLatin1(reply->rawHeader(QByteArrayLiteral("Last-Modified")));
+	}
+
+	const std::shared_ptr<RulesStorage> storage(m_rulesStorage);
+	const ProfileSummary profileSummary(m_profileSummary);
+	const QString path(getPath());
+	const QString cachePath(getRulesCachePath());
+	const QString diffName(m_diffPath.section(QLatin1Char('#'), 1));
+	const QByteArray data(reply->readAll());
+
+	m_updateWatcher = new QFutureWatcher<UpdateResult>(this);
+	m_updateWatcher->setFuture(QtConcurrent::run([=]()
 	{
-		raiseError(information.errorString, information.error);
+		return applyUpdate(storage, profileSummary, path, cachePath, diffName, data, isFetchingDiff);
+	}));
 
+	connect(m_updateWatcher, &QFutureWatcher<UpdateResult>::finished, this, &AdblockContentFiltersProfile::finishUpdate);
+}
+
+void AdblockContentFiltersProfile::finishUpdate()
+{
+	if (!m_updateWatcher)
+	{
 		return;
 	}
 
-	QDir().mkpath(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking")));
+	const UpdateResult result(m_updateWatcher->result());
 
-	QSaveFile file(getPath());
+	m_updateWatcher->disconnect(this);
+	m_updateWatcher->deleteLater();
+	m_updateWatcher = nullptr;
 
-	if (!file.open(QIODevice::WriteOnly))
+	if (result.hasFailedDiff)
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to apply differential update of content blocking profile, downloading full list"), Console::OtherCategory, Console::WarningLevel, getPath());
+
+		if (!startUpdate(m_profileSummary.updateUrl, false))
+		{
+			emit profileModified();
+		}
+
+		return;
+	}
+
+	if (result.header.hasError())
 	{
-		raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), DownloadError);
+		raiseError(result.header.errorString, result.header.error);
 
 		return;
 	}
 
-	file.write(buffer.data());
+	if (!result.openErrorString.isEmpty())
+	{
+		raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(result.openErrorString), DownloadError);
+
+		return;
+	}
 
 	m_profileSummary.lastUpdate = QDateTime::currentDateTimeUtc();
 
-	if (!file.commit())
+	if (!result.commitErrorString.isEmpty())
 	{
-		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, file.fileName());
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(result.commitErrorString), Console::OtherCategory, Console::ErrorLevel, getPath());
 	}
 
-	clear();
-	loadHeader();
+	applyHeader(result.header);
 
-	if (m_wasLoaded)
+	if (result.needsReload)
 	{
 		loadRules();
 	}
@@ -647,487 +772,1559 @@ void AdblockContentFiltersProfile::handleJobFinished(bool isSuccess)
 	emit profileModified();
 }
 
-void AdblockContentFiltersProfile::setProfileSummary(const ContentFiltersProfile::ProfileSummary &profileSummary)
+AdblockContentFiltersProfile::UpdateResult AdblockContentFiltersProfile::applyUpdate(const std::shared_ptr<RulesStorage> &storage, const ContentFiltersProfile::ProfileSummary &profileSummary, const QString &path, const QString &cachePath, const QString &diffName, const QByteArray &replyData, bool isDiff)
 {
-	const bool needsReload(profileSummary.cosmeticFiltersMode != m_profileSummary.cosmeticFiltersMode || profileSummary.areWildcardsEnabled != m_profileSummary.areWildcardsEnabled);
+	UpdateResult result;
+	QByteArray previousData;
+	QFile previousFile(path);
 
-	if (profileSummary.title != m_profileSummary.title)
-	{
-		m_flags |= HasCustomTitleFlag;
-	}
-	else if (!needsReload && profileSummary.updateUrl == m_profileSummary.updateUrl && profileSummary.updateInterval == m_profileSummary.updateInterval && profileSummary.category == m_profileSummary.category)
+	if (previousFile.open(QIODevice::ReadOnly))
 	{
-		return;
-	}
-
-	m_profileSummary = profileSummary;
+		previousData = previousFile.readAll();
 
-	if (needsReload)
-	{
-		clear();
+		previousFile.close();
 	}
 
-	emit profileModified();
-}
+	QByteArray data(replyData);
 
-QString AdblockContentFiltersProfile::getName() const
-{
-	return m_profileSummary.name;
-}
+	if (isDiff)
+	{
+		data = previousData;
 
-QString AdblockContentFiltersProfile::getTitle() const
-{
-	return (m_profileSummary.title.isEmpty() ? tr("(Unknown)") : m_profileSummary.title);
-}
+		if (previousData.isEmpty() || !applyDiff(replyData, diffName, &data))
+		{
+			result.hasFailedDiff = true;
 
-QString AdblockContentFiltersProfile::getPath() const
-{
-	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.txt")).arg(m_profileSummary.name);
-}
+			return result;
+		}
+	}
 
-QDateTime AdblockContentFiltersProfile::getLastUpdate() const
-{
-	return m_profileSummary.lastUpdate;
-}
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::ReadOnly | QIODevice::Text);
 
-QUrl AdblockContentFiltersProfile::getUpdateUrl() const
-{
-	return m_profileSummary.updateUrl;
-}
+	result.header = loadHeader(&buffer);
 
-ContentFiltersProfile::ProfileSummary AdblockContentFiltersProfile::getProfileSummary() const
-{
-	return m_profileSummary;
-}
+	buffer.close();
 
-ContentFiltersManager::CosmeticFiltersResult AdblockContentFiltersProfile::getCosmeticFilters(const QStringList &domains, bool isDomainOnly)
-{
-	if (!m_wasLoaded)
+	if (result.header.hasError())
 	{
-		loadRules();
+		return result;
 	}
 
-	ContentFiltersManager::CosmeticFiltersResult result;
+	QDir().mkpath(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking")));
 
-	if (!isDomainOnly)
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly))
 	{
-		result.rules = m_cosmeticFiltersRules;
+		result.openErrorString = file.errorString();
+
+		return result;
 	}
 
-	for (int i = 0; i < domains.count(); ++i)
+	file.write(data);
+
+	if (!file.commit())
 	{
-		result.rules.append(m_cosmeticFiltersDomainRules.values(domains.at(i)));
-		result.exceptions.append(m_cosmeticFiltersDomainExceptions.values(domains.at(i)));
+		result.commitErrorString = file.errorString();
 	}
 
-	return result;
-}
+	if (previousData == data)
+	{
+		return result;
+	}
 
-ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType)
-{
-	ContentFiltersManager::CheckResult result;
+	QMutexLocker locker(&storage->mutex);
 
-	if (!m_wasLoaded && !loadRules())
+	if (!storage->isRequested)
 	{
 		return result;
 	}
 
-	const Request request(baseUrl, requestUrl, resourceType);
+	const std::shared_ptr<const RulesSnapshot> snapshot(std::atomic_load(&storage->snapshot));
 
-	for (int i = 0; i < request.requestUrl.length(); ++i)
+	if (!snapshot || storage->isLoading || previousData.isEmpty())
 	{
-		const ContentFiltersManager::CheckResult currentResult(checkUrlSubstring(m_root, request.requestUrl.right(request.requestUrl.length() - i), {}, request));
+		result.needsReload = true;
 
-		if (currentResult.isBlocked)
+		return result;
+	}
+
+	++storage->generation;
+
+	const quint64 generation(storage->generation);
+
+	locker.unlock();
+
+	const auto getLines([](const QByteArray &rawData) -> QSet<QString>
+	{
+		QStringList lines(QString::fromUtf8(rawData).split(QLatin1Char('\n')));
+		QSet<QString> uniqueLines;
+		uniqueLines.reserve(lines.count());
+
+		for (int i = 1; i < lines.count(); ++i)
 		{
-			result = currentResult;
+			QString &line(lines[i]);
+
+			if (line.endsWith(QLatin1Char('\r')))
+			{
+				line.chop(1);
+			}
+
+			if (!line.isEmpty() && !line.startsWith(QLatin1Char('!')))
+			{
+				uniqueLines.insert(line);
+			}
 		}
-		else if (currentResult.isException)
+
+		return uniqueLines;
+	});
+	const QSet<QString> previousLines(getLines(previousData));
+	const QSet<QString> lines(getLines(data));
+	QStringList addedLines;
+	QStringList removedLines;
+	QSet<QString>::const_iterator iterator;
+
+	for (iterator = lines.constBegin(); iterator != lines.constEnd(); ++iterator)
+	{
+		if (!previousLines.contains(*iterator))
 		{
-			return currentResult;
+			addedLines.append(*iterator);
+		}
+	}
+
+	for (iterator = previousLines.constBegin(); iterator != previousLines.constEnd(); ++iterator)
+	{
+		if (!lines.contains(*iterator))
+		{
+			removedLines.append(*iterator);
 		}
 	}
 
+	std::shared_ptr<const RulesSnapshot> updatedSnapshot(createSnapshot(snapshot, profileSummary, addedLines, removedLines));
+
+	if (!updatedSnapshot)
+	{
+		updatedSnapshot = createSnapshot(profileSummary, path, cachePath);
+	}
+
+	locker.relock();
+
+	if (storage->generation == generation)
+	{
+		std::atomic_store(&storage->snapshot, updatedSnapshot);
+
+		ContentFiltersManager::invalidateCaches();
+	}
+
 	return result;
 }
 
-ContentFiltersManager::CheckResult AdblockContentFiltersProfile::evaluateNodeRules(const Node *node, const QString &currentRule, const Request &request) const
+void AdblockContentFiltersProfile::saveRulesCache(const RulesSnapshot *snapshot, const ContentFiltersProfile::ProfileSummary &profileSummary, const QString &path, const QByteArray &checksum)
 {
-	ContentFiltersManager::CheckResult result;
+	if (SessionsManager::isReadOnly())
+	{
+		return;
+	}
+
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_15);
+	stream << static_cast<quint32>(RulesCacheMagic) << static_cast<quint32>(RulesCacheVersion) << static_cast<qint32>(QSysInfo::ByteOrder) << checksum << static_cast<qint32>(profileSummary.cosmeticFiltersMode) << profileSummary.areWildcardsEnabled;
+	stream << snapshot->cosmeticFiltersRules << snapshot->cosmeticFiltersDomainRules << snapshot->cosmeticFiltersDomainExceptions << snapshot->rulesIndex.data;
+
+	if (stream.status() == QDataStream::Ok)
+	{
+		file.commit();
+	}
+}
+
+void AdblockContentFiltersProfile::setProfileSummary(const ContentFiltersProfile::ProfileSummary &profileSummary)
+{
+	const bool needsReload(profileSummary.cosmeticFiltersMode != m_profileSummary.cosmeticFiltersMode || profileSummary.areWildcardsEnabled != m_profileSummary.areWildcardsEnabled);
+
+	if (profileSummary.title != m_profileSummary.title)
+	{
+		m_flags |= HasCustomTitleFlag;
+	}
+	else if (!needsReload && profileSummary.updateUrl == m_profileSummary.updateUrl && profileSummary.updateInterval == m_profileSummary.updateInterval && profileSummary.category == m_profileSummary.category)
+	{
+		return;
+	}
+
+	const bool hasUpdateUrlChanged(profileSummary.updateUrl != m_profileSummary.updateUrl);
+
+	m_profileSummary = profileSummary;
+
+	if (hasUpdateUrlChanged)
+	{
+		m_profileSummary.updateEntityTag.clear();
+		m_profileSummary.updateLastModified.clear();
+	}
+
+	if (needsReload)
+	{
+		clear();
+	}
+
+	emit profileModified();
+}
+
+QString AdblockContentFiltersProfile::getName() const
+{
+	return m_profileSummary.name;
+}
+
+QString AdblockContentFiltersProfile::getTitle() const
+{
+	return (m_profileSummary.title.isEmpty() ? tr("(Unknown)") : m_profileSummary.title);
+}
+
+QString AdblockContentFiltersProfile::getPath() const
+{
+	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.txt")).arg(m_profileSummary.name);
+}
+
+QString AdblockContentFiltersProfile::getRulesCachePath() const
+{
+	return SessionsManager::getWritableDataPath(QLatin1String("contentBlocking/%1.dat")).arg(m_profileSummary.name);
+}
+
+std::shared_ptr<const AdblockContentFiltersProfile::RulesSnapshot> AdblockContentFiltersProfile::getSnapshot(bool *isPending)
+{
+	std::shared_ptr<const RulesSnapshot> snapshot(std::atomic_load(&m_rulesStorage->snapshot));
+
+	if (snapshot)
+	{
+		return snapshot;
+	}
+
+	bool needsLoading(false);
 
-	for (int i = 0; i < node->rules.count(); ++i)
 	{
-		if (!node->rules.at(i))
+		QMutexLocker locker(&m_rulesStorage->mutex);
+
+		if (!m_rulesStorage->isRequested)
 		{
-			continue;
+			m_rulesStorage->isRequested = true;
+			m_rulesStorage->isLoading = true;
+
+			needsLoading = true;
+		}
+	}
+
+	if (needsLoading)
+	{
+		if (thread() == QThread::currentThread())
+		{
+			loadRules();
+		}
+		else
+		{
+			QMetaObject::invokeMethod(this, [=]()
+			{
+				loadRules();
+			}, Qt::QueuedConnection);
 		}
+	}
 
-		ContentFiltersManager::CheckResult currentResult(checkRuleMatch(node->rules.at(i), currentRule, request));
+	if (ContentFiltersManager::getPendingRequestsPolicy() == ContentFiltersManager::WaitForProfilesPolicy)
+	{
+		QMutexLocker locker(&m_rulesStorage->mutex);
 
-		if (currentResult.isBlocked)
+		if (thread() == QThread::currentThread())
 		{
-			result = currentResult;
+			if (isPending)
+			{
+				*isPending = m_rulesStorage->isLoading;
+			}
 		}
-		else if (currentResult.isException)
+		else
 		{
-			return currentResult;
+			while (m_rulesStorage->isLoading)
+			{
+				if (!m_rulesStorage->condition.wait(&m_rulesStorage->mutex, 10000))
+				{
+					break;
+				}
+			}
 		}
 	}
 
-	return result;
+	return std::atomic_load(&m_rulesStorage->snapshot);
 }
 
-AdblockContentFiltersProfile::HeaderInformation AdblockContentFiltersProfile::loadHeader(QIODevice *rulesDevice)
+std::shared_ptr<const AdblockContentFiltersProfile::RulesSnapshot> AdblockContentFiltersProfile::createSnapshot(const ContentFiltersProfile::ProfileSummary &profileSummary, const QString &path, const QString &cachePath)
 {
-	HeaderInformation information;
-	QTextStream stream(rulesDevice);
-	stream.setCodec("UTF-8");
+	std::shared_ptr<RulesSnapshot> snapshot(std::make_shared<RulesSnapshot>());
+	QFile file(path);
 
-	const QString header(stream.readLine());
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return snapshot;
+	}
 
-	if (!header.contains(QLatin1String("[Adblock"), Qt::CaseInsensitive))
+	QByteArray checksum;
+	const qint64 size(file.size());
+	uchar *data((size > 0) ? file.map(0, size) : nullptr);
+
+	if (data)
 	{
-		information.errorString = QCoreApplication::translate("main", "Failed to update content blocking profile: invalid header");
-		information.error = ParseError;
+		checksum = QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(size)), QCryptographicHash::Md5);
 
-		return information;
+		file.unmap(data);
 	}
 
-	int lineNumber(1);
+	if (!checksum.isEmpty() && loadRulesCache(snapshot.get(), profileSummary, cachePath, checksum))
+	{
+		file.close();
+
+		snapshot->cosmeticFiltersStyleSheet = ContentFiltersManager::createStyleSheet(snapshot->cosmeticFiltersRules);
+
+		return snapshot;
+	}
+
+	QVector<RuleDefinition> definitions;
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	stream.readLine(); // skip header
 
 	while (!stream.atEnd())
 	{
-		const QString line(stream.readLine().trimmed());
+		parseRuleLine(stream.readLine(), profileSummary, snapshot.get(), &definitions);
+	}
 
-		if (line.startsWith(QLatin1String("! Title: ")))
+	file.close();
+
+	snapshot->rulesIndex.setData(compileRules(definitions));
+	snapshot->cosmeticFiltersStyleSheet = ContentFiltersManager::createStyleSheet(snapshot->cosmeticFiltersRules);
+
+	if (!checksum.isEmpty())
+	{
+		saveRulesCache(snapshot.get(), profileSummary, cachePath, checksum);
+	}
+
+	return snapshot;
+}
+
+std::shared_ptr<const AdblockContentFiltersProfile::RulesSnapshot> AdblockContentFiltersProfile::createSnapshot(const std::shared_ptr<const RulesSnapshot> &snapshot, const ContentFiltersProfile::ProfileSummary &profileSummary, const QStringList &addedLines, const QStringList &removedLines)
+{
+	std::shared_ptr<RulesSnapshot> updatedSnapshot(std::make_shared<RulesSnapshot>(*snapshot));
+	RulesSnapshot addedCosmeticFilters;
+	RulesSnapshot removedCosmeticFilters;
+	QVector<RuleDefinition> definitions;
+	bool hasNetworkChanges(false);
+
+	for (int i = 0; i < removedLines.count(); ++i)
+	{
+		parseRuleLine(removedLines.at(i), profileSummary, &removedCosmeticFilters, &definitions);
+
+		if (definitions.isEmpty())
 		{
-			information.title = line.section(QLatin1Char(':'), 1).trimmed();
+			continue;
+		}
 
-			break;
+		definitions.clear();
+
+		hasNetworkChanges = true;
+
+		if (!updatedSnapshot->addedRules.removeOne(removedLines.at(i)))
+		{
+			updatedSnapshot->removedRules.insert(removedLines.at(i));
 		}
+	}
 
-		if (lineNumber > 50)
+	for (int i = 0; i < addedLines.count(); ++i)
+	{
+		parseRuleLine(addedLines.at(i), profileSummary, &addedCosmeticFilters, &definitions);
+
+		if (definitions.isEmpty())
 		{
-			break;
+			continue;
 		}
 
-		++lineNumber;
+		definitions.clear();
+
+		hasNetworkChanges = true;
+
+		if (!updatedSnapshot->removedRules.remove(addedLines.at(i)))
+		{
+			updatedSnapshot->addedRules.append(addedLines.at(i));
+		}
 	}
 
-	return information;
+	const int rulesAmount(snapshot->rulesIndex.isEmpty() ? 0 : static_cast<int>(snapshot->rulesIndex.header->rulesAmount));
+
+	if ((updatedSnapshot->addedRules.count() + updatedSnapshot->removedRules.count()) > qMax(1000, (rulesAmount / 4)))
+	{
+		return {};
+	}
+
+	if (hasNetworkChanges)
+	{
+		RulesSnapshot cosmeticFilters;
+
+		definitions.reserve(updatedSnapshot->addedRules.count());
+
+		for (int i = 0; i < updatedSnapshot->addedRules.count(); ++i)
+		{
+			parseRuleLine(updatedSnapshot->addedRules.at(i), profileSummary, &cosmeticFilters, &definitions);
+		}
+
+		updatedSnapshot->addedRulesIndex = RulesIndex();
+
+		if (!definitions.isEmpty())
+		{
+			updatedSnapshot->addedRulesIndex.setData(compileRules(definitions));
+		}
+	}
+
+	const bool hasCosmeticFiltersChanges(!addedCosmeticFilters.cosmeticFiltersRules.isEmpty() || !removedCosmeticFilters.cosmeticFiltersRules.isEmpty() || !addedCosmeticFilters.cosmeticFiltersDomainRules.isEmpty() || !removedCosmeticFilters.cosmeticFiltersDomainRules.isEmpty() || !addedCosmeticFilters.cosmeticFiltersDomainExceptions.isEmpty() || !removedCosmeticFilters.cosmeticFiltersDomainExceptions.isEmpty());
+
+	if (!hasCosmeticFiltersChanges)
+	{
+		return updatedSnapshot;
+	}
+
+	if (!removedCosmeticFilters.cosmeticFiltersRules.isEmpty())
+	{
+		const QSet<QString> removedRules(removedCosmeticFilters.cosmeticFiltersRules.constBegin(), removedCosmeticFilters.cosmeticFiltersRules.constEnd());
+		QStringList cosmeticFiltersRules;
+		cosmeticFiltersRules.reserve(updatedSnapshot->cosmeticFiltersRules.count());
+
+		for (int i = 0; i < updatedSnapshot->cosmeticFiltersRules.count(); ++i)
+		{
+			if (!removedRules.contains(updatedSnapshot->cosmeticFiltersRules.at(i)))
+			{
+				cosmeticFiltersRules.append(updatedSnapshot->cosmeticFiltersRules.at(i));
+			}
+		}
+
+		updatedSnapshot->cosmeticFiltersRules = cosmeticFiltersRules;
+	}
+
+	updatedSnapshot->cosmeticFiltersRules.append(addedCosmeticFilters.cosmeticFiltersRules);
+
+	QMultiHash<QString, QString>::const_iterator iterator;
+
+	for (iterator = removedCosmeticFilters.cosmeticFiltersDomainRules.constBegin(); iterator != removedCosmeticFilters.cosmeticFiltersDomainRules.constEnd(); ++iterator)
+	{
+		updatedSnapshot->cosmeticFiltersDomainRules.remove(iterator.key(), iterator.value());
+	}
+
+	for (iterator = removedCosmeticFilters.cosmeticFiltersDomainExceptions.constBegin(); iterator != removedCosmeticFilters.cosmeticFiltersDomainExceptions.constEnd(); ++iterator)
+	{
+		updatedSnapshot->cosmeticFiltersDomainExceptions.remove(iterator.key(), iterator.value());
+	}
+
+	updatedSnapshot->cosmeticFiltersDomainRules.unite(addedCosmeticFilters.cosmeticFiltersDomainRules);
+	updatedSnapshot->cosmeticFiltersDomainExceptions.unite(addedCosmeticFilters.cosmeticFiltersDomainExceptions);
+	updatedSnapshot->cosmeticFiltersStyleSheet = ContentFiltersManager::createStyleSheet(updatedSnapshot->cosmeticFiltersRules);
+
+	return updatedSnapshot;
 }
 
-QHash<AdblockContentFiltersProfile::RuleType, quint32> AdblockContentFiltersProfile::loadRulesInformation(const ContentFiltersProfile::ProfileSummary &profileSummary, QIODevice *rulesDevice)
+QString AdblockContentFiltersProfile::getCosmeticFiltersStyleSheet()
 {
-	QHash<RuleType, quint32> information({{AnyRule, 0}, {ActiveRule, 0}, {CosmeticRule, 0}, {WildcardRule, 0}});
-	QTextStream stream(rulesDevice);
-	stream.setCodec("UTF-8");
-	stream.readLine();
+	const std::shared_ptr<const RulesSnapshot> snapshot(getSnapshot());
+
+	return (snapshot ? snapshot->cosmeticFiltersStyleSheet : QString());
+}
+
+QDateTime AdblockContentFiltersProfile::getLastUpdate() const
+{
+	return m_profileSummary.lastUpdate;
+}
+
+QUrl AdblockContentFiltersProfile::getUpdateUrl() const
+{
+	return m_profileSummary.updateUrl;
+}
+
+ContentFiltersProfile::ProfileSummary AdblockContentFiltersProfile::getProfileSummary() const
+{
+	return m_profileSummary;
+}
+
+ContentFiltersManager::CosmeticFiltersResult AdblockContentFiltersProfile::getCosmeticFilters(const QStringList &domains, bool isDomainOnly)
+{
+	const std::shared_ptr<const RulesSnapshot> snapshot(getSnapshot());
+
+	if (!snapshot)
+	{
+		return {};
+	}
+
+	ContentFiltersManager::CosmeticFiltersResult result;
+
+	if (!isDomainOnly)
+	{
+		result.rules = snapshot->cosmeticFiltersRules;
+	}
+
+	for (int i = 0; i < domains.count(); ++i)
+	{
+		result.rules.append(snapshot->cosmeticFiltersDomainRules.values(domains.at(i)));
+		result.exceptions.append(snapshot->cosmeticFiltersDomainExceptions.values(domains.at(i)));
+	}
+
+	return result;
+}
+
+ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType)
+{
+	bool isPending(false);
+	const std::shared_ptr<const RulesSnapshot> snapshot(getSnapshot(&isPending));
+
+	if (!snapshot)
+	{
+		ContentFiltersManager::CheckResult result;
+		result.isPending = isPending;
+
+		return result;
+	}
+
+	if (snapshot->rulesIndex.isEmpty() && snapshot->addedRulesIndex.isEmpty())
+	{
+		return {};
+	}
+
+	const Request request(baseUrl, requestUrl, resourceType);
+	const ContentFiltersManager::CheckResult result(checkRules(snapshot->rulesIndex, request, snapshot->removedRules));
+
+	if (result.isException || snapshot->addedRulesIndex.isEmpty())
+	{
+		return result;
+	}
+
+	const ContentFiltersManager::CheckResult addedRulesResult(checkRules(snapshot->addedRulesIndex, request, {}));
+
+	return ((addedRulesResult.isBlocked || addedRulesResult.isException) ? addedRulesResult : result);
+}
+
+ContentFiltersManager::CheckResult AdblockContentFiltersProfile::checkRules(const RulesIndex &rulesIndex, const Request &request, const QSet<QString> &removedRules)
+{
+	if (rulesIndex.isEmpty())
+	{
+		return {};
+	}
+
+	ContentFiltersManager::CheckResult result(evaluateRules(rulesIndex, 0, rulesIndex.header->untokenizedRulesAmount, request, removedRules));
+
+	if (result.isException)
+	{
+		return result;
+	}
+
+	const QString &url(request.requestUrl);
+	QVarLengthArray<quint32, 64> tokens;
+	int position(0);
+
+	while (position < url.length())
+	{
+		if (!isTokenCharacter(url.at(position)))
+		{
+			++position;
+
+			continue;
+		}
+
+		const int tokenStart(position);
+
+		while (position < url.length() && isTokenCharacter(url.at(position)))
+		{
+			++position;
+		}
+
+		const quint32 token(qHash(url.midRef(tokenStart, (position - tokenStart))));
+
+		if (tokens.contains(token))
+		{
+			continue;
+		}
+
+		tokens.append(token);
+
+		const RulesBucket *bucket(rulesIndex.findBucket(token));
+
+		if (!bucket)
+		{
+			continue;
+		}
+
+		const ContentFiltersManager::CheckResult currentResult(evaluateRules(rulesIndex, bucket->position, bucket->amount, request, removedRules));
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
+		}
+	}
+
+	return result;
+}
+
+ContentFiltersManager::CheckResult AdblockContentFiltersProfile::evaluateRules(const RulesIndex &rulesIndex, quint32 position, quint32 amount, const Request &request, const QSet<QString> &removedRules)
+{
+	ContentFiltersManager::CheckResult result;
+
+	for (quint32 i = position; i < (position + amount); ++i)
+	{
+		const ContentFiltersManager::CheckResult currentResult(checkRuleMatch(rulesIndex, rulesIndex.rules[rulesIndex.rulesReferences[i]], request));
+
+		if (!removedRules.isEmpty() && (currentResult.isBlocked || currentResult.isException) && removedRules.contains(currentResult.rule))
+		{
+			continue;
+		}
+
+		if (currentResult.isBlocked)
+		{
+			result = currentResult;
+		}
+		else if (currentResult.isException)
+		{
+			return currentResult;
+		}
+	}
+
+	return result;
+}
+
+QVector<quint32> AdblockContentFiltersProfile::getRuleTokens(const RuleDefinition &definition)
+{
+	const QString &pattern(definition.pattern);
+	const bool hasStartAnchor(definition.needsDomainCheck || definition.ruleMatch == StartMatch || definition.ruleMatch == ExactMatch);
+	const bool hasEndAnchor(definition.ruleMatch == EndMatch || definition.ruleMatch == ExactMatch);
+	QVector<quint32> tokens;
+	int position(0);
+
+	while (position < pattern.length())
+	{
+		if (!isTokenCharacter(pattern.at(position)))
+		{
+			++position;
+
+			continue;
+		}
+
+		const int tokenStart(position);
+
+		while (position < pattern.length() && isTokenCharacter(pattern.at(position)))
+		{
+			++position;
+		}
+
+		const bool hasStartBoundary((tokenStart == 0) ? hasStartAnchor : (pattern.at(tokenStart - 1) != QLatin1Char('*')));
+		const bool hasEndBoundary((position == pattern.length()) ? hasEndAnchor : (pattern.at(position) != QLatin1Char('*')));
+
+		if (hasStartBoundary && hasEndBoundary)
+		{
+			const quint32 token(qHash(pattern.midRef(tokenStart, (position - tokenStart))));
+
+			if (!tokens.contains(token))
+			{
+				tokens.append(token);
+			}
+		}
+	}
+
+	return tokens;
+}
+
+int AdblockContentFiltersProfile::matchSegment(const QStringRef &segment, const QString &url, int position)
+{
+	for (int i = 0; i < segment.length(); ++i)
+	{
+		const QChar character(segment.at(i));
+
+		if (character == QLatin1Char('^'))
+		{
+			if (position == url.length())
+			{
+				continue;
+			}
+
+			if (!isSeparator(url.at(position)))
+			{
+				return -1;
+			}
+		}
+		else if (position >= url.length() || url.at(position) != character)
+		{
+			return -1;
+		}
+
+		++position;
+	}
+
+	return position;
+}
+
+const AdblockContentFiltersProfile::RulesBucket* AdblockContentFiltersProfile::RulesIndex::findBucket(quint32 token) const
+{
+	if (!header)
+	{
+		return nullptr;
+	}
+
+	const RulesBucket *end(buckets + header->bucketsAmount);
+	const RulesBucket *bucket(std::lower_bound(buckets, end, token, [&](const RulesBucket &currentBucket, quint32 value)
+	{
+		return (currentBucket.token < value);
+	}));
+
+	return ((bucket != end && bucket->token == token) ? bucket : nullptr);
+}
+
+AdblockContentFiltersProfile::HeaderInformation AdblockContentFiltersProfile::loadHeader(QIODevice *rulesDevice)
+{
+	HeaderInformation information;
+	QTextStream stream(rulesDevice);
+	stream.setCodec("UTF-8");
+
+	const QString header(stream.readLine());
+
+	if (!header.contains(QLatin1String("[Adblock"), Qt::CaseInsensitive))
+	{
+		information.errorString = QCoreApplication::translate("main", "Failed to update content blocking profile: invalid header");
+		information.error = ParseError;
+
+		return information;
+	}
+
+	int lineNumber(1);
+
+	while (!stream.atEnd())
+	{
+		const QString line(stream.readLine().trimmed());
+
+		if (line.startsWith(QLatin1String("! Title: ")))
+		{
+			information.title = line.section(QLatin1Char(':'), 1).trimmed();
+		}
+		else if (line.startsWith(QLatin1String("! Diff-Path: ")))
+		{
+			information.diffPath = line.mid(13).trimmed();
+		}
+		else if (!line.isEmpty() && !line.startsWith(QLatin1Char('!')))
+		{
+			break;
+		}
+
+		if (lineNumber > 50)
+		{
+			break;
+		}
+
+		++lineNumber;
+	}
+
+	return information;
+}
+
+QHash<AdblockContentFiltersProfile::RuleType, quint32> AdblockContentFiltersProfile::loadRulesInformation(const ContentFiltersProfile::ProfileSummary &profileSummary, QIODevice *rulesDevice)
+{
+	QHash<RuleType, quint32> information({{AnyRule, 0}, {ActiveRule, 0}, {CosmeticRule, 0}, {WildcardRule, 0}});
+	QTextStream stream(rulesDevice);
+	stream.setCodec("UTF-8");
+	stream.readLine();
+
+	while (!stream.atEnd())
+	{
+		const QString line(stream.readLine().trimmed());
+
+		if (line.isEmpty() || line.startsWith(QLatin1Char('!')))
+		{
+			continue;
+		}
+
+		++information[AnyRule];
+
+		if (line.startsWith(QLatin1String("##")))
+		{
+			++information[CosmeticRule];
+
+			if (profileSummary.cosmeticFiltersMode == ContentFiltersManager::AllFilters)
+			{
+				++information[ActiveRule];
+			}
+
+			continue;
+		}
+
+		if (line.contains(QLatin1String("##")))
+		{
+			++information[CosmeticRule];
+
+			if (profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
+			{
+				++information[ActiveRule];
+			}
+
+			continue;
+		}
+
+		if (line.contains(QLatin1String("#@#")))
+		{
+			++information[CosmeticRule];
+
+			if (profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
+			{
+				++information[ActiveRule];
+			}
+
+			continue;
+		}
+
+		if (line.contains(QLatin1Char('*')))
+		{
+			++information[WildcardRule];
+
+			if (profileSummary.areWildcardsEnabled)
+			{
+				++information[ActiveRule];
+			}
+
+			continue;
+		}
+
+		++information[ActiveRule];
+	}
+
+	return information;
+}
+
+QVector<QLocale::Language> AdblockContentFiltersProfile::getLanguages() const
+{
+	return m_languages;
+}
+
+ContentFiltersProfile::ProfileCategory AdblockContentFiltersProfile::getCategory() const
+{
+	return m_profileSummary.category;
+}
+
+ContentFiltersManager::CosmeticFiltersMode AdblockContentFiltersProfile::getCosmeticFiltersMode() const
+{
+	return m_profileSummary.cosmeticFiltersMode;
+}
+
+ContentFiltersProfile::ProfileError AdblockContentFiltersProfile::getError() const
+{
+	return m_error;
+}
+
+ContentFiltersProfile::ProfileFlags AdblockContentFiltersProfile::getFlags() const
+{
+	return m_flags;
+}
+
+int AdblockContentFiltersProfile::getUpdateInterval() const
+{
+	return m_profileSummary.updateInterval;
+}
+
+int AdblockContentFiltersProfile::getUpdateProgress() const
+{
+	return (m_dataFetchJob ? m_dataFetchJob->getProgress() : -1);
+}
+
+qint64 AdblockContentFiltersProfile::getMemoryUsage() const
+{
+	const std::shared_ptr<const RulesSnapshot> snapshot(std::atomic_load(&m_rulesStorage->snapshot));
+
+	if (!snapshot)
+	{
+		return 0;
+	}
+
+	qint64 usage(snapshot->rulesIndex.data.size() + snapshot->addedRulesIndex.data.size() + (snapshot->cosmeticFiltersStyleSheet.length() * static_cast<qint64>(sizeof(QChar))));
+
+	for (int i = 0; i < snapshot->addedRules.count(); ++i)
+	{
+		usage += (snapshot->addedRules.at(i).length() * static_cast<qint64>(sizeof(QChar)));
+	}
+
+	QSet<QString>::const_iterator removedRulesIterator;
+
+	for (removedRulesIterator = snapshot->removedRules.constBegin(); removedRulesIterator != snapshot->removedRules.constEnd(); ++removedRulesIterator)
+	{
+		usage += (removedRulesIterator->length() * static_cast<qint64>(sizeof(QChar)));
+	}
+
+	for (int i = 0; i < snapshot->cosmeticFiltersRules.count(); ++i)
+	{
+		usage += (snapshot->cosmeticFiltersRules.at(i).length() * static_cast<qint64>(sizeof(QChar)));
+	}
+
+	const QVector<const QMultiHash<QString, QString>*> cosmeticFiltersDomainRules({&snapshot->cosmeticFiltersDomainRules, &snapshot->cosmeticFiltersDomainExceptions});
+
+	for (int i = 0; i < cosmeticFiltersDomainRules.count(); ++i)
+	{
+		QMultiHash<QString, QString>::const_iterator iterator;
+
+		for (iterator = cosmeticFiltersDomainRules.at(i)->constBegin(); iterator != cosmeticFiltersDomainRules.at(i)->constEnd(); ++iterator)
+		{
+			usage += ((iterator.key().length() + iterator.value().length()) * static_cast<qint64>(sizeof(QChar)));
+		}
+	}
+
+	return usage;
+}
+
+bool AdblockContentFiltersProfile::create(const ContentFiltersProfile::ProfileSummary &profileSummary, QIODevice *rulesDevice, bool canOverwriteExisting)
+{
+	const QString path(SessionsManager::getWritableDataPath(QStringLiteral("contentBlocking/%1.txt")).arg(profileSummary.name));
+
+	if (SessionsManager::isReadOnly() || (!canOverwriteExisting && QFile::exists(path)))
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Failed to create a content blocking profile: %1").arg(tr("File already exists")), Console::OtherCategory, Console::ErrorLevel, path);
+
+		return false;
+	}
+
+	if (rulesDevice)
+	{
+		QDir().mkpath(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking")));
+
+		QFile file(path);
+
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			Console::addMessage(QCoreApplication::translate("main", "Failed to create a content blocking profile: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, file.fileName());
+
+			return false;
+		}
+
+		file.write(rulesDevice->readAll());
+		file.close();
+	}
+
+	ProfileFlags flags(NoFlags);
+
+	if (!profileSummary.title.isEmpty())
+	{
+		flags |= HasCustomTitleFlag;
+	}
+
+	AdblockContentFiltersProfile *profile(new AdblockContentFiltersProfile(profileSummary, {}, flags, ContentFiltersManager::getInstance()));
+
+	ContentFiltersManager::addProfile(profile);
+
+	if (!rulesDevice && profileSummary.updateUrl.isValid())
+	{
+		profile->update();
+	}
+
+	return true;
+}
+
+bool AdblockContentFiltersProfile::create(const QUrl &url, bool canOverwriteExisting)
+{
+	if (!canOverwriteExisting && ContentFiltersManager::getProfile(url))
+	{
+		QMessageBox::critical(QApplication::activeWindow(), tr("Error"), tr("Profile with this address already exists."), QMessageBox::Close);
+
+		return false;
+	}
+
+	if (QMessageBox::question(QApplication::activeWindow(), tr("Question"), tr("Do you want to add content blocking profile from this URL?\n\n%1").arg(url.toString()), QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+	{
+		return false;
+	}
+
+	ContentFiltersProfile::ProfileSummary profileSummary;
+	profileSummary.updateUrl = url;
+
+	ContentBlockingProfileDialog dialog(profileSummary, {}, QApplication::activeWindow());
+
+	if (dialog.exec() == QDialog::Rejected)
+	{
+		return false;
+	}
+
+	profileSummary = dialog.getProfile();
+
+	QFile file(dialog.getRulesPath());
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		QMessageBox::critical(QApplication::activeWindow(), tr("Error"), tr("Failed to create content blocking profile file."), QMessageBox::Close);
+
+		return false;
+	}
+
+	profileSummary.name = Utils::createIdentifier(QFileInfo(url.path()).baseName(), ContentFiltersManager::getProfileNames());
+
+	const bool result(create(profileSummary, &file, canOverwriteExisting));
+
+	if (!result)
+	{
+		QMessageBox::critical(QApplication::activeWindow(), tr("Error"), tr("Failed to create content blocking profile file."), QMessageBox::Close);
+	}
+
+	file.close();
+	file.remove();
+
+	return result;
+}
+
+
+bool AdblockContentFiltersProfile::loadRulesCache(RulesSnapshot *snapshot, const ContentFiltersProfile::ProfileSummary &profileSummary, const QString &path, const QByteArray &checksum)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	const qint64 size(file.size());
+	uchar *data((size > 0) ? file.map(0, size) : nullptr);
+
+	if (!data)
+	{
+		return false;
+	}
+
+	const QByteArray buffer(QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(size)));
+	QDataStream stream(buffer);
+	stream.setVersion(QDataStream::Qt_5_15);
+
+	quint32 magic(0);
+	quint32 version(0);
+	qint32 byteOrder(0);
+	QByteArray cachedChecksum;
+	qint32 cosmeticFiltersMode(0);
+	bool areWildcardsEnabled(false);
+
+	stream >> magic >> version >> byteOrder >> cachedChecksum >> cosmeticFiltersMode >> areWildcardsEnabled;
+
+	if (stream.status() != QDataStream::Ok || magic != RulesCacheMagic || version != RulesCacheVersion || byteOrder != QSysInfo::ByteOrder || cachedChecksum != checksum || cosmeticFiltersMode != profileSummary.cosmeticFiltersMode || areWildcardsEnabled != profileSummary.areWildcardsEnabled)
+	{
+		file.unmap(data);
+
+		return false;
+	}
+
+	QByteArray rulesData;
+
+	// Rules index is a single flat block, so deserializing it costs one copy out of the mapping and keeps the snapshot independent from the cache file being replaced
+	stream >> snapshot->cosmeticFiltersRules >> snapshot->cosmeticFiltersDomainRules >> snapshot->cosmeticFiltersDomainExceptions >> rulesData;
+
+	file.unmap(data);
+
+	if (stream.status() != QDataStream::Ok || !snapshot->rulesIndex.setData(rulesData))
+	{
+		*snapshot = RulesSnapshot();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool AdblockContentFiltersProfile::update(const QUrl &url)
+{
+	return startUpdate(url, true);
+}
+
+bool AdblockContentFiltersProfile::startUpdate(const QUrl &url, bool canUseDiff)
+{
+	if (m_dataFetchJob || m_updateWatcher || thread() != QThread::currentThread())
+	{
+		return false;
+	}
+
+	const QUrl updateUrl(url.isValid() ? url : m_profileSummary.updateUrl);
+
+	if (!updateUrl.isValid())
+	{
+		if (updateUrl.isEmpty())
+		{
+			raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL is empty"), DownloadError);
+		}
+		else
+		{
+			raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL (%1) is invalid").arg(updateUrl.toString()), DownloadError);
+		}
+
+		return false;
+	}
+
+	QMap<QByteArray, QByteArray> headers;
+
+	m_isFetchingDiff = false;
+
+	if (updateUrl == m_profileSummary.updateUrl && QFile::exists(getPath()))
+	{
+		if (canUseDiff && !m_diffPath.isEmpty())
+		{
+			m_isFetchingDiff = true;
+		}
+		else
+		{
+			if (!m_profileSummary.updateEntityTag.isEmpty())
+			{
+				headers[QByteArrayLiteral("If-None-Match")] = m_profileSummary.updateEntityTag.toLatin1();
+			}
+
+			if (!m_profileSummary.updateLastModified.isEmpty())
+			{
+				headers[QByteArrayLiteral("If-Modified-Since")] = m_profileSummary.updateLastModified.toLatin1();
+			}
+		}
+	}
+
+	m_dataFetchJob = new DataFetchJob((m_isFetchingDiff ? updateUrl.resolved(QUrl(m_diffPath.section(QLatin1Char('#'), 0, 0))) : updateUrl), this);
+	m_dataFetchJob->setHeaders(headers);
+
+	connect(m_dataFetchJob, &Job::jobFinished, this, &AdblockContentFiltersProfile::handleJobFinished);
+	connect(m_dataFetchJob, &Job::progressChanged, this, &AdblockContentFiltersProfile::updateProgressChanged);
+
+	m_dataFetchJob->start();
+
+	emit profileModified();
+
+	return true;
+}
+
+bool AdblockContentFiltersProfile::applyDiff(const QByteArray &diff, const QString &name, QByteArray *data)
+{
+	const QList<QByteArray> diffLines(diff.split('\n'));
+	QByteArray checksum;
+	int position(0);
+	int end(diffLines.count());
+	bool hasBlocks(false);
+	bool isFound(false);
+
+	for (int i = 0; i < diffLines.count(); ++i)
+	{
+		if (!diffLines.at(i).startsWith("diff "))
+		{
+			continue;
+		}
+
+		const QList<QByteArray> fields(diffLines.at(i).trimmed().split(' '));
+		QByteArray blockName;
+		int amount(-1);
+
+		hasBlocks = true;
+
+		for (int j = 1; j < fields.count(); ++j)
+		{
+			const int separator(fields.at(j).indexOf(':'));
+
+			if (separator < 0)
+			{
+				continue;
+			}
+
+			const QByteArray key(fields.at(j).left(separator));
+			const QByteArray value(fields.at(j).mid(separator + 1));
+
+			if (key == "name")
+			{
+				blockName = value;
+			}
+			else if (key == "checksum")
+			{
+				checksum = value;
+			}
+			else if (key == "lines")
+			{
+				amount = value.toInt();
+			}
+		}
+
+		if (name.isEmpty() || QString::fromUtf8(blockName) == name)
+		{
+			position = (i + 1);
+			end = ((amount >= 0) ? qMin(diffLines.count(), (position + amount)) : diffLines.count());
+			isFound = true;
+
+			break;
+		}
+
+		checksum.clear();
+	}
+
+	if (hasBlocks && !isFound)
+	{
+		return false;
+	}
+
+	const QList<QByteArray> lines(data->split('\n'));
+	QList<QByteArray> patchedLines;
+	patchedLines.reserve(lines.count());
+
+	int current(0);
 
-	while (!stream.atEnd())
+	for (int i = position; i < end; ++i)
 	{
-		const QString line(stream.readLine().trimmed());
+		const QByteArray command(diffLines.at(i).trimmed());
 
-		if (line.isEmpty() || line.startsWith(QLatin1Char('!')))
+		if (command.isEmpty())
 		{
 			continue;
 		}
 
-		++information[AnyRule];
+		const QList<QByteArray> arguments(command.mid(1).split(' '));
 
-		if (line.startsWith(QLatin1String("##")))
+		if (arguments.count() != 2)
 		{
-			++information[CosmeticRule];
+			return false;
+		}
 
-			if (profileSummary.cosmeticFiltersMode == ContentFiltersManager::AllFilters)
-			{
-				++information[ActiveRule];
-			}
+		bool isLineValid(false);
+		bool isAmountValid(false);
+		const int line(arguments.at(0).toInt(&isLineValid));
+		const int amount(arguments.at(1).toInt(&isAmountValid));
 
-			continue;
+		if (!isLineValid || !isAmountValid || amount < 0)
+		{
+			return false;
 		}
 
-		if (line.contains(QLatin1String("##")))
+		if (command.at(0) == 'a')
 		{
-			++information[CosmeticRule];
-
-			if (profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
+			if (line < current || line > lines.count() || (i + amount) >= end)
 			{
-				++information[ActiveRule];
+				return false;
 			}
 
-			continue;
-		}
+			patchedLines.append(lines.mid(current, (line - current)));
+			patchedLines.append(diffLines.mid((i + 1), amount));
 
-		if (line.contains(QLatin1String("#@#")))
+			current = line;
+			i += amount;
+		}
+		else if (command.at(0) == 'd')
 		{
-			++information[CosmeticRule];
-
-			if (profileSummary.cosmeticFiltersMode != ContentFiltersManager::NoFilters)
+			if (line < 1 || (line - 1) < current || (line - 1 + amount) > lines.count())
 			{
-				++information[ActiveRule];
+				return false;
 			}
 
-			continue;
-		}
+			patchedLines.append(lines.mid(current, (line - 1 - current)));
 
-		if (line.contains(QLatin1Char('*')))
+			current = (line - 1 + amount);
+		}
+		else
 		{
-			++information[WildcardRule];
+			return false;
+		}
+	}
 
-			if (profileSummary.areWildcardsEnabled)
-			{
-				++information[ActiveRule];
-			}
+	patchedLines.append(lines.mid(current));
 
-			continue;
-		}
+	const QByteArray patchedData(patchedLines.join('\n'));
 
-		++information[ActiveRule];
+	if (!checksum.isEmpty() && !QCryptographicHash::hash(patchedData, QCryptographicHash::Sha1).toHex().startsWith(checksum.toLower()))
+	{
+		return false;
 	}
 
-	return information;
-}
+	*data = patchedData;
 
-QVector<QLocale::Language> AdblockContentFiltersProfile::getLanguages() const
-{
-	return m_languages;
+	return true;
 }
 
-ContentFiltersProfile::ProfileCategory AdblockContentFiltersProfile::getCategory() const
+bool AdblockContentFiltersProfile::remove()
 {
-	return m_profileSummary.category;
-}
+	const QString path(getPath());
 
-ContentFiltersManager::CosmeticFiltersMode AdblockContentFiltersProfile::getCosmeticFiltersMode() const
-{
-	return m_profileSummary.cosmeticFiltersMode;
-}
+	if (m_dataFetchJob)
+	{
+		m_dataFetchJob->cancel();
+		m_dataFetchJob->deleteLater();
+		m_dataFetchJob = nullptr;
+	}
 
-ContentFiltersProfile::ProfileError AdblockContentFiltersProfile::getError() const
-{
-	return m_error;
-}
+	if (m_updateWatcher)
+	{
+		m_updateWatcher->waitForFinished();
+		m_updateWatcher->disconnect(this);
+		m_updateWatcher->deleteLater();
+		m_updateWatcher = nullptr;
+	}
 
-ContentFiltersProfile::ProfileFlags AdblockContentFiltersProfile::getFlags() const
-{
-	return m_flags;
-}
+	QFile::remove(getRulesCachePath());
 
-int AdblockContentFiltersProfile::getUpdateInterval() const
-{
-	return m_profileSummary.updateInterval;
-}
+	if (QFile::exists(path))
+	{
+		return QFile::remove(path);
+	}
 
-int AdblockContentFiltersProfile::getUpdateProgress() const
-{
-	return (m_dataFetchJob ? m_dataFetchJob->getProgress() : -1);
+	return true;
 }
 
-bool AdblockContentFiltersProfile::create(const ContentFiltersProfile::ProfileSummary &profileSummary, QIODevice *rulesDevice, bool canOverwriteExisting)
+bool AdblockContentFiltersProfile::matchPattern(const QStringRef &pattern, const QString &url, int position, bool isStartAnchored, bool isEndAnchored, int *matchStart, int *matchEnd)
 {
-	const QString path(SessionsManager::getWritableDataPath(QStringLiteral("contentBlocking/%1.txt")).arg(profileSummary.name));
+	int segmentStart(0);
+	bool isFirst(true);
 
-	if (SessionsManager::isReadOnly() || (!canOverwriteExisting && QFile::exists(path)))
+	while (true)
 	{
-		Console::addMessage(QCoreApplication::translate("main", "Failed to create a content blocking profile: %1").arg(tr("File already exists")), Console::OtherCategory, Console::ErrorLevel, path);
-
-		return false;
-	}
+		int segmentEnd(pattern.indexOf(QLatin1Char('*'), segmentStart));
+		const bool isLast(segmentEnd < 0);
 
-	if (rulesDevice)
-	{
-		QDir().mkpath(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking")));
+		if (isLast)
+		{
+			segmentEnd = pattern.length();
+		}
 
-		QFile file(path);
+		const QStringRef segment(pattern.mid(segmentStart, (segmentEnd - segmentStart)));
+		const bool isAnchored(isFirst && isStartAnchored);
+		const bool needsEnd(isLast && isEndAnchored);
+		int segmentPosition(position);
+		int end(-1);
 
-		if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+		while (segmentPosition <= url.length())
 		{
-			Console::addMessage(QCoreApplication::translate("main", "Failed to create a content blocking profile: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, file.fileName());
+			if (!isAnchored && !segment.isEmpty() && segment.at(0) != QLatin1Char('^'))
+			{
+				segmentPosition = url.indexOf(segment.at(0), segmentPosition);
 
-			return false;
+				if (segmentPosition < 0)
+				{
+					break;
+				}
+			}
+
+			end = matchSegment(segment, url, segmentPosition);
+
+			if (end >= 0 && (!needsEnd || end == url.length()))
+			{
+				break;
+			}
+
+			end = -1;
+
+			if (isAnchored)
+			{
+				break;
+			}
+
+			++segmentPosition;
 		}
 
-		file.write(rulesDevice->readAll());
-		file.close();
-	}
+		if (end < 0)
+		{
+			return false;
+		}
 
-	ProfileFlags flags(NoFlags);
+		if (isFirst)
+		{
+			*matchStart = segmentPosition;
 
-	if (!profileSummary.title.isEmpty())
-	{
-		flags |= HasCustomTitleFlag;
-	}
+			isFirst = false;
+		}
 
-	AdblockContentFiltersProfile *profile(new AdblockContentFiltersProfile(profileSummary, {}, flags, ContentFiltersManager::getInstance()));
+		position = end;
 
-	ContentFiltersManager::addProfile(profile);
+		if (isLast)
+		{
+			break;
+		}
 
-	if (!rulesDevice && profileSummary.updateUrl.isValid())
-	{
-		profile->update();
+		segmentStart = (segmentEnd + 1);
 	}
 
+	*matchEnd = position;
+
 	return true;
 }
 
-bool AdblockContentFiltersProfile::create(const QUrl &url, bool canOverwriteExisting)
+bool AdblockContentFiltersProfile::matchRule(const RulesIndex &rulesIndex, const Rule &rule, const Request &request)
 {
-	if (!canOverwriteExisting && ContentFiltersManager::getProfile(url))
-	{
-		QMessageBox::critical(QApplication::activeWindow(), tr("Error"), tr("Profile with this address already exists."), QMessageBox::Close);
+	const QStringRef pattern(rulesIndex.getString(rule.pattern));
+	const bool isEndAnchored(rule.ruleMatch == EndMatch || rule.ruleMatch == ExactMatch);
+	int matchStart(0);
+	int matchEnd(0);
 
-		return false;
+	if (!rule.needsDomainCheck)
+	{
+		return matchPattern(pattern, request.requestUrl, 0, (rule.ruleMatch == StartMatch || rule.ruleMatch == ExactMatch), isEndAnchored, &matchStart, &matchEnd);
 	}
 
-	if (QMessageBox::question(QApplication::activeWindow(), tr("Question"), tr("Do you want to add content blocking profile from this URL?\n\n%1").arg(url.toString()), QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+	if (request.hostPosition < 0)
 	{
 		return false;
 	}
 
-	ContentFiltersProfile::ProfileSummary profileSummary;
-	profileSummary.updateUrl = url;
-
-	ContentBlockingProfileDialog dialog(profileSummary, {}, QApplication::activeWindow());
+	int labelPosition(0);
 
-	if (dialog.exec() == QDialog::Rejected)
+	while (labelPosition >= 0)
 	{
-		return false;
-	}
-
-	profileSummary = dialog.getProfile();
+		if (matchPattern(pattern, request.requestUrl, (request.hostPosition + labelPosition), true, isEndAnchored, &matchStart, &matchEnd))
+		{
+			int domainEnd(matchStart);
 
-	QFile file(dialog.getRulesPath());
+			while (domainEnd < matchEnd)
+			{
+				const QChar character(request.requestUrl.at(domainEnd));
 
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-	{
-		QMessageBox::critical(QApplication::activeWindow(), tr("Error"), tr("Failed to create content blocking profile file."), QMessageBox::Close);
+				if (character == QLatin1Char(':') || character == QLatin1Char('?') || character == QLatin1Char('&') || character == QLatin1Char('/') || character == QLatin1Char('='))
+				{
+					break;
+				}
 
-		return false;
-	}
+				++domainEnd;
+			}
 
-	profileSummary.name = Utils::createIdentifier(QFileInfo(url.path()).baseName(), ContentFiltersManager::getProfileNames());
+			if (request.requestSubdomains.contains(request.requestUrl.mid(matchStart, (domainEnd - matchStart))))
+			{
+				return true;
+			}
+		}
 
-	const bool result(create(profileSummary, &file, canOverwriteExisting));
+		labelPosition = request.requestHost.indexOf(QLatin1Char('.'), labelPosition);
 
-	if (!result)
-	{
-		QMessageBox::critical(QApplication::activeWindow(), tr("Error"), tr("Failed to create content blocking profile file."), QMessageBox::Close);
+		if (labelPosition >= 0)
+		{
+			++labelPosition;
+		}
 	}
 
-	file.close();
-	file.remove();
-
-	return result;
+	return false;
 }
 
-bool AdblockContentFiltersProfile::loadRules()
+bool AdblockContentFiltersProfile::RulesIndex::setData(const QByteArray &value)
 {
-	const QString path(getPath());
-
-	m_error = NoError;
+	header = nullptr;
+	rules = nullptr;
+	buckets = nullptr;
+	rulesReferences = nullptr;
+	domains = nullptr;
+	strings.clear();
+	data = value;
 
-	if (!QFile::exists(path) && !m_profileSummary.updateUrl.isEmpty())
+	if (data.size() < static_cast<int>(sizeof(Header)))
 	{
-		update();
+		data.clear();
 
 		return false;
 	}
 
-	m_wasLoaded = true;
+	const Header *dataHeader(reinterpret_cast<const Header*>(data.constData()));
+	const qint64 size(static_cast<qint64>(sizeof(Header)) + (static_cast<qint64>(dataHeader->rulesAmount) * sizeof(Rule)) + (static_cast<qint64>(dataHeader->bucketsAmount) * sizeof(RulesBucket)) + (static_cast<qint64>(dataHeader->rulesReferencesAmount) * sizeof(quint32)) + (static_cast<qint64>(dataHeader->domainsAmount) * sizeof(DomainReference)) + (static_cast<qint64>(dataHeader->stringsLength) * sizeof(QChar)));
 
-	if (m_domainExpression.pattern().isEmpty())
+	if (size != data.size() || dataHeader->untokenizedRulesAmount > dataHeader->rulesReferencesAmount)
 	{
-		m_domainExpression = QRegularExpression(QLatin1String("[:\?&/=]"));
-		m_domainExpression.optimize();
+		data.clear();
+
+		return false;
 	}
 
-	QFile file(path);
-	file.open(QIODevice::ReadOnly | QIODevice::Text);
+	const char *position(data.constData() + sizeof(Header));
+	const Rule *dataRules(reinterpret_cast<const Rule*>(position));
 
-	QTextStream stream(&file);
-	stream.setCodec("UTF-8");
-	stream.readLine(); // skip header
+	position += (dataHeader->rulesAmount * sizeof(Rule));
 
-	m_root = new Node();
+	const RulesBucket *dataBuckets(reinterpret_cast<const RulesBucket*>(position));
 
-	while (!stream.atEnd())
-	{
-		parseRuleLine(stream.readLine());
-	}
+	position += (dataHeader->bucketsAmount * sizeof(RulesBucket));
 
-	file.close();
+	const quint32 *dataRulesReferences(reinterpret_cast<const quint32*>(position));
 
-	return true;
-}
+	position += (dataHeader->rulesReferencesAmount * sizeof(quint32));
 
-bool AdblockContentFiltersProfile::update(const QUrl &url)
-{
-	if (m_dataFetchJob || thread() != QThread::currentThread())
-	{
-		return false;
-	}
+	const DomainReference *dataDomains(reinterpret_cast<const DomainReference*>(position));
 
-	const QUrl updateUrl(url.isValid() ? url : m_profileSummary.updateUrl);
+	position += (dataHeader->domainsAmount * sizeof(DomainReference));
 
-	if (!updateUrl.isValid())
+	const auto isStringValid([&](const StringReference &reference) -> bool
 	{
-		if (updateUrl.isEmpty())
-		{
-			raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL is empty"), DownloadError);
-		}
-		else
-		{
-			raiseError(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL (%1) is invalid").arg(updateUrl.toString()), DownloadError);
-		}
-
-		return false;
-	}
-
-	m_dataFetchJob = new DataFetchJob(updateUrl, this);
-
-	connect(m_dataFetchJob, &Job::jobFinished, this, &AdblockContentFiltersProfile::handleJobFinished);
-	connect(m_dataFetchJob, &Job::progressChanged, this, &AdblockContentFiltersProfile::updateProgressChanged);
+		return ((static_cast<qint64>(reference.position) + reference.length) <= dataHeader->stringsLength);
+	});
+	bool isValid(true);
 
-	m_dataFetchJob->start();
+	for (quint32 i = 0; (isValid && i < dataHeader->rulesAmount); ++i)
+	{
+		const Rule &rule(dataRules[i]);
 
-	emit profileModified();
+		isValid = (isStringValid(rule.rule) && isStringValid(rule.pattern) && (static_cast<qint64>(rule.domainsPosition) + rule.blockedDomainsAmount + rule.allowedDomainsAmount) <= dataHeader->domainsAmount);
+	}
 
-	return true;
-}
+	for (quint32 i = 0; (isValid && i < dataHeader->bucketsAmount); ++i)
+	{
+		isValid = ((static_cast<qint64>(dataBuckets[i].position) + dataBuckets[i].amount) <= dataHeader->rulesReferencesAmount);
+	}
 
-bool AdblockContentFiltersProfile::remove()
-{
-	const QString path(getPath());
+	for (quint32 i = 0; (isValid && i < dataHeader->rulesReferencesAmount); ++i)
+	{
+		isValid = (dataRulesReferences[i] < dataHeader->rulesAmount);
+	}
 
-	if (m_dataFetchJob)
+	for (quint32 i = 0; (isValid && i < dataHeader->domainsAmount); ++i)
 	{
-		m_dataFetchJob->cancel();
-		m_dataFetchJob->deleteLater();
-		m_dataFetchJob = nullptr;
+		isValid = isStringValid(dataDomains[i].domain);
 	}
 
-	if (QFile::exists(path))
+	if (!isValid)
 	{
-		return QFile::remove(path);
+		data.clear();
+
+		return false;
 	}
 
+	header = dataHeader;
+	rules = dataRules;
+	buckets = dataBuckets;
+	rulesReferences = dataRulesReferences;
+	domains = dataDomains;
+	strings = QString::fromRawData(reinterpret_cast<const QChar*>(position), static_cast<int>(dataHeader->stringsLength));
+
 	return true;
 }
 
-bool AdblockContentFiltersProfile::resolveDomainExceptions(const QString &url, const QStringList &ruleList) const
+bool AdblockContentFiltersProfile::resolveDomainExceptions(const RulesIndex &rulesIndex, const Request &request, quint32 position, quint32 amount)
 {
-	for (int i = 0; i < ruleList.count(); ++i)
+	const DomainReference *begin(rulesIndex.domains + position);
+	const DomainReference *end(begin + amount);
+
+	for (int i = 0; i < request.baseHostSuffixes.count(); ++i)
 	{
-		if (url.contains(ruleList.at(i)))
+		const quint32 hash(request.baseHostSuffixes.at(i).first);
+		const DomainReference *domain(std::lower_bound(begin, end, hash, [&](const DomainReference &reference, quint32 value)
+		{
+			return (reference.hash < value);
+		}));
+
+		while (domain != end && domain->hash == hash)
 		{
-			return true;
+			if (rulesIndex.getString(domain->domain) == request.baseHost.midRef(request.baseHostSuffixes.at(i).second))
+			{
+				return true;
+			}
+
+			++domain;
 		}
 	}
 
 	return false;
 }
 
+bool AdblockContentFiltersProfile::isSeparator(QChar character)
+{
+	return !(character.isLetterOrNumber() || character == QLatin1Char('_') || character == QLatin1Char('-') || character == QLatin1Char('.') || character == QLatin1Char('%'));
+}
+
+bool AdblockContentFiltersProfile::isTokenCharacter(QChar character)
+{
+	return (character.isLetterOrNumber() || character == QLatin1Char('%'));
+}
+
 bool AdblockContentFiltersProfile::areWildcardsEnabled() const
 {
 	return m_profileSummary.areWildcardsEnabled;
@@ -1142,7 +2339,7 @@ bool AdblockContentFiltersProfile::isFraud(const QUrl &url)
 
 bool AdblockContentFiltersProfile::isUpdating() const
 {
-	return (m_dataFetchJob != nullptr);
+	return (m_dataFetchJob != nullptr || m_updateWatcher != nullptr);
 }
 
 }
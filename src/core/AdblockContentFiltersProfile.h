@@ -24,7 +24,12 @@
 
 #include "ContentFiltersManager.h"
 
-#include <QtCore/QRegularExpression>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QWaitCondition>
+
+#include <memory>
 
 namespace Otter
 {
@@ -47,6 +52,7 @@ public:
 	struct HeaderInformation final
 	{
 		QString title;
+		QString diffPath;
 		QString errorString;
 		QUrl updateUrl;
 		ProfileError error = NoError;
@@ -60,6 +66,7 @@ public:
 	explicit AdblockContentFiltersProfile(const ProfileSummary &profileSummary, const QStringList &languages, ProfileFlags flags, QObject *parent = nullptr);
 
 	void clear() override;
+	void load() override;
 	void setProfileSummary(const ProfileSummary &profileSummary) override;
 	QString getName() const override;
 	QString getTitle() const override;
@@ -68,6 +75,7 @@ public:
 	QDateTime getLastUpdate() const override;
 	ProfileSummary getProfileSummary() const override;
 	ContentFiltersManager::CosmeticFiltersResult getCosmeticFilters(const QStringList &domains, bool isDomainOnly) override;
+	QString getCosmeticFiltersStyleSheet() override;
 	ContentFiltersManager::CheckResult checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType) override;
 	static HeaderInformation loadHeader(QIODevice *rulesDevice);
 	static QHash<RuleType, quint32> loadRulesInformation(const ProfileSummary &profileSummary, QIODevice *rulesDevice);
@@ -78,6 +86,7 @@ public:
 	ProfileFlags getFlags() const override;
 	int getUpdateInterval() const override;
 	int getUpdateProgress() const override;
+	qint64 getMemoryUsage() const override;
 	static bool create(const ProfileSummary &profileSummary, QIODevice *rulesDevice = nullptr, bool canOverwriteExisting = false);
 	static bool create(const QUrl &url, bool canOverwriteExisting = false);
 	bool update(const QUrl &url = {}) override;
@@ -106,6 +115,12 @@ protected:
 
 	Q_DECLARE_FLAGS(RuleOptions, RuleOption)
 
+	enum RulesCacheInformation : quint32
+	{
+		RulesCacheMagic = 0x4f414443,
+		RulesCacheVersion = 4
+	};
+
 	enum RuleMatch
 	{
 		ContainsMatch = 0,
@@ -114,23 +129,117 @@ protected:
 		ExactMatch
 	};
 
-	struct Node final
+	struct RuleDefinition final
+	{
+		QString rule;
+		QString pattern;
+		QStringList blockedDomains;
+		QStringList allowedDomains;
+		RuleOptions ruleOptions = NoOption;
+		RuleOptions ruleExceptions = NoOption;
+		RuleMatch ruleMatch = ContainsMatch;
+		bool isException = false;
+		bool needsDomainCheck = false;
+	};
+
+	struct StringReference final
+	{
+		quint32 position = 0;
+		quint32 length = 0;
+	};
+
+	struct DomainReference final
+	{
+		StringReference domain;
+		quint32 hash = 0;
+	};
+
+	struct Rule final
+	{
+		StringReference rule;
+		StringReference pattern;
+		quint32 domainsPosition = 0;
+		quint16 blockedDomainsAmount = 0;
+		quint16 allowedDomainsAmount = 0;
+		quint16 ruleOptions = NoOption;
+		quint16 ruleExceptions = NoOption;
+		quint8 ruleMatch = ContainsMatch;
+		quint8 isException = false;
+		quint8 needsDomainCheck = false;
+		quint8 padding = 0;
+	};
+
+	struct RulesBucket final
+	{
+		quint32 token = 0;
+		quint32 position = 0;
+		quint32 amount = 0;
+	};
+
+	struct RulesIndex final
 	{
-		struct Rule final
+		struct Header final
 		{
-			QString rule;
-			QStringList blockedDomains;
-			QStringList allowedDomains;
-			RuleOptions ruleOptions = NoOption;
-			RuleOptions ruleExceptions = NoOption;
-			RuleMatch ruleMatch = ContainsMatch;
-			bool isException = false;
-			bool needsDomainCheck = false;
+			quint32 rulesAmount = 0;
+			quint32 bucketsAmount = 0;
+			quint32 untokenizedRulesAmount = 0;
+			quint32 rulesReferencesAmount = 0;
+			quint32 domainsAmount = 0;
+			quint32 stringsLength = 0;
 		};
 
-		QChar value = 0;
-		QVarLengthArray<Node*, 1> children;
-		QVarLengthArray<Rule*, 1> rules;
+		QByteArray data;
+		QString strings;
+		const Header *header = nullptr;
+		const Rule *rules = nullptr;
+		const RulesBucket *buckets = nullptr;
+		const quint32 *rulesReferences = nullptr;
+		const DomainReference *domains = nullptr;
+
+		bool setData(const QByteArray &value);
+
+		QStringRef getString(const StringReference &reference) const
+		{
+			return QStringRef(&strings, static_cast<int>(reference.position), static_cast<int>(reference.length));
+		}
+
+		const RulesBucket* findBucket(quint32 token) const;
+
+		bool isEmpty() const
+		{
+			return (!header || header->rulesAmount == 0);
+		}
+	};
+
+	struct RulesSnapshot final
+	{
+		RulesIndex rulesIndex;
+		RulesIndex addedRulesIndex;
+		QStringList addedRules;
+		QSet<QString> removedRules;
+		QString cosmeticFiltersStyleSheet;
+		QStringList cosmeticFiltersRules;
+		QMultiHash<QString, QString> cosmeticFiltersDomainRules;
+		QMultiHash<QString, QString> cosmeticFiltersDomainExceptions;
+	};
+
+	struct RulesStorage final
+	{
+		std::shared_ptr<const RulesSnapshot> snapshot;
+		QMutex mutex;
+		QWaitCondition condition;
+		quint64 generation = 0;
+		bool isLoading = false;
+		bool isRequested = false;
+	};
+
+	struct UpdateResult final
+	{
+		HeaderInformation header;
+		QString openErrorString;
+		QString commitErrorString;
+		bool hasFailedDiff = false;
+		bool needsReload = false;
 	};
 
 	struct Request final
@@ -138,7 +247,10 @@ protected:
 		QString baseHost;
 		QString requestHost;
 		QString requestUrl;
+		QStringList requestSubdomains;
+		QVector<QPair<quint32, int> > baseHostSuffixes;
 		NetworkManager::ResourceType resourceType = NetworkManager::OtherType;
+		int hostPosition = -1;
 
 		explicit Request(const QUrl &baseUrlValue, const QUrl &requestUrlValue, NetworkManager::ResourceType resourceTypeValue) : baseHost(baseUrlValue.host()), requestHost(requestUrlValue.host()), requestUrl(requestUrlValue.toString()), resourceType(resourceTypeValue)
 		{
@@ -146,35 +258,73 @@ protected:
 			{
 				requestUrl = requestUrl.mid(2);
 			}
+
+			requestSubdomains = ContentFiltersManager::createSubdomainList(requestHost);
+
+			int suffixPosition(0);
+
+			while (suffixPosition >= 0 && suffixPosition < baseHost.length())
+			{
+				baseHostSuffixes.append({qHash(baseHost.midRef(suffixPosition)), suffixPosition});
+
+				suffixPosition = baseHost.indexOf(QLatin1Char('.'), suffixPosition);
+
+				if (suffixPosition >= 0)
+				{
+					++suffixPosition;
+				}
+			}
+
+			if (!requestHost.isEmpty())
+			{
+				const int schemeSeparator(requestUrl.indexOf(QLatin1String("://")));
+
+				hostPosition = requestUrl.indexOf(requestHost, ((schemeSeparator >= 0) ? (schemeSeparator + 3) : 0));
+			}
 		}
 	};
 
 	void loadHeader();
-	void parseRuleLine(const QString &rule);
-	void parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list);
-	void deleteNode(Node *node) const;
-	ContentFiltersManager::CheckResult checkUrlSubstring(const Node *node, const QString &subString, QString currentRule, const Request &request) const;
-	ContentFiltersManager::CheckResult checkRuleMatch(const Node::Rule *rule, const QString &currentRule, const Request &request) const;
-	ContentFiltersManager::CheckResult evaluateNodeRules(const Node *node, const QString &currentRule, const Request &request) const;
-	bool loadRules();
-	bool resolveDomainExceptions(const QString &url, const QStringList &ruleList) const;
+	void loadRules();
+	void applyHeader(const HeaderInformation &information);
+	bool startUpdate(const QUrl &url, bool canUseDiff);
+	static bool applyDiff(const QByteArray &diff, const QString &name, QByteArray *data);
+	static void parseRuleLine(const QString &rule, const ProfileSummary &profileSummary, RulesSnapshot *snapshot, QVector<RuleDefinition> *definitions);
+	static void parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list);
+	static UpdateResult applyUpdate(const std::shared_ptr<RulesStorage> &storage, const ProfileSummary &profileSummary, const QString &path, const QString &cachePath, const QString &diffName, const QByteArray &replyData, bool isDiff);
+	static void saveRulesCache(const RulesSnapshot *snapshot, const ProfileSummary &profileSummary, const QString &path, const QByteArray &checksum);
+	QString getRulesCachePath() const;
+	static QByteArray compileRules(const QVector<RuleDefinition> &definitions);
+	static ContentFiltersManager::CheckResult checkRuleMatch(const RulesIndex &rulesIndex, const Rule &rule, const Request &request);
+	static ContentFiltersManager::CheckResult checkRules(const RulesIndex &rulesIndex, const Request &request, const QSet<QString> &removedRules);
+	static ContentFiltersManager::CheckResult evaluateRules(const RulesIndex &rulesIndex, quint32 position, quint32 amount, const Request &request, const QSet<QString> &removedRules);
+	static QVector<quint32> getRuleTokens(const RuleDefinition &definition);
+	std::shared_ptr<const RulesSnapshot> getSnapshot(bool *isPending = nullptr);
+	static std::shared_ptr<const RulesSnapshot> createSnapshot(const ProfileSummary &profileSummary, const QString &path, const QString &cachePath);
+	static std::shared_ptr<const RulesSnapshot> createSnapshot(const std::shared_ptr<const RulesSnapshot> &snapshot, const ProfileSummary &profileSummary, const QStringList &addedLines, const QStringList &removedLines);
+	static int matchSegment(const QStringRef &segment, const QString &url, int position);
+	static bool matchPattern(const QStringRef &pattern, const QString &url, int position, bool isStartAnchored, bool isEndAnchored, int *matchStart, int *matchEnd);
+	static bool matchRule(const RulesIndex &rulesIndex, const Rule &rule, const Request &request);
+	static bool isSeparator(QChar character);
+	static bool isTokenCharacter(QChar character);
+	static bool loadRulesCache(RulesSnapshot *snapshot, const ProfileSummary &profileSummary, const QString &path, const QByteArray &checksum);
+	static bool resolveDomainExceptions(const RulesIndex &rulesIndex, const Request &request, quint32 position, quint32 amount);
 
 protected slots:
 	void raiseError(const QString &message, ProfileError error);
 	void handleJobFinished(bool isSuccess);
+	void finishUpdate();
 
 private:
-	Node *m_root;
 	DataFetchJob *m_dataFetchJob;
+	QFutureWatcher<UpdateResult> *m_updateWatcher;
 	ProfileSummary m_profileSummary;
-	QRegularExpression m_domainExpression;
-	QStringList m_cosmeticFiltersRules;
+	QString m_diffPath;
+	std::shared_ptr<RulesStorage> m_rulesStorage;
 	QVector<QLocale::Language> m_languages;
-	QMultiHash<QString, QString> m_cosmeticFiltersDomainRules;
-	QMultiHash<QString, QString> m_cosmeticFiltersDomainExceptions;
 	ProfileError m_error;
 	ProfileFlags m_flags;
-	bool m_wasLoaded;
+	bool m_isFetchingDiff;
 
 	static QHash<QString, RuleOption> m_options;
 	static QHash<NetworkManager::ResourceType, RuleOption> m_resourceTypes;
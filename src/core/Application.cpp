@@ -22,6 +22,7 @@
 #include "AddonsManager.h"
 #include "BookmarksManager.h"
 #include "Console.h"
+#include "FaviconsManager.h"
 #include "FeedsManager.h"
 #include "GesturesManager.h"
 #include "HandlersManager.h"
@@ -419,6 +420,8 @@ Application::Application(int &argc, char **argv) : QApplication(argc, argv),
 
 	BookmarksManager::createInstance();
 
+	FaviconsManager::createInstance();
+
 	FeedsManager::createInstance();
 
 	GesturesManager::createInstance();
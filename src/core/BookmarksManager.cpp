@@ -22,18 +22,25 @@
 #include "Application.h"
 #include "SessionsManager.h"
 
+#include <QtCore/QDataStream>
 #include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTimerEvent>
 
 namespace Otter
 {
 
 BookmarksManager* BookmarksManager::m_instance(nullptr);
 BookmarksModel* BookmarksManager::m_model(nullptr);
+QHash<quint64, BookmarksManager::VisitsRecord> BookmarksManager::m_visits;
 qulonglong BookmarksManager::m_lastUsedFolder(0);
 
 BookmarksManager::BookmarksManager(QObject *parent) : QObject(parent),
-	m_saveTimer(0)
+	m_saveTimer(0),
+	m_visitsSaveTimer(0)
 {
+	connect(QCoreApplication::instance(), &Application::aboutToQuit, this, &BookmarksManager::saveVisits);
 }
 
 void BookmarksManager::timerEvent(QTimerEvent *event)
@@ -44,10 +51,11 @@ void BookmarksManager::timerEvent(QTimerEvent *event)
 
 		m_saveTimer = 0;
 
-		if (m_model)
-		{
-			m_model->save(SessionsManager::getWritableDataPath(QLatin1String("bookmarks.xbel")));
-		}
+		saveBookmarks();
+	}
+	else if (event->timerId() == m_visitsSaveTimer)
+	{
+		saveVisits();
 	}
 }
 
@@ -71,6 +79,55 @@ void BookmarksManager::ensureInitialized()
 		m_model = new BookmarksModel(SessionsManager::getWritableDataPath(QLatin1String("bookmarks.xbel")), BookmarksModel::BookmarksMode, m_instance);
 
 		connect(m_model, &BookmarksModel::modelModified, m_instance, &BookmarksManager::scheduleSave);
+
+		loadVisits();
+	}
+}
+
+void BookmarksManager::loadVisits()
+{
+	QFile file(SessionsManager::getWritableDataPath(QLatin1String("bookmarksVisits.dat")));
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_6);
+
+	quint32 magic(0);
+	quint32 version(0);
+	quint32 amount(0);
+
+	stream >> magic >> version >> amount;
+
+	if (magic != VisitsCacheMagic || version != VisitsCacheVersion)
+	{
+		return;
+	}
+
+	for (quint32 i = 0; i < amount && stream.status() == QDataStream::Ok; ++i)
+	{
+		quint64 identifier(0);
+		VisitsRecord record;
+		qint32 visits(0);
+
+		stream >> identifier >> visits >> record.timeVisited;
+
+		record.visits = visits;
+
+		BookmarksModel::Bookmark *bookmark(m_model->getBookmark(identifier));
+
+		if (stream.status() != QDataStream::Ok || !bookmark)
+		{
+			continue;
+		}
+
+		bookmark->setItemData(record.visits, BookmarksModel::VisitsRole);
+		bookmark->setItemData(QDateTime::fromMSecsSinceEpoch(record.timeVisited, Qt::UTC), BookmarksModel::TimeVisitedRole);
+
+		m_visits[identifier] = record;
 	}
 }
 
@@ -85,10 +142,7 @@ void BookmarksManager::scheduleSave()
 			m_saveTimer = 0;
 		}
 
-		if (m_model)
-		{
-			m_model->save(SessionsManager::getWritableDataPath(QLatin1String("bookmarks.xbel")));
-		}
+		saveBookmarks();
 	}
 	else if (m_saveTimer == 0)
 	{
@@ -96,6 +150,75 @@ void BookmarksManager::scheduleSave()
 	}
 }
 
+void BookmarksManager::scheduleVisitsSave()
+{
+	if (Application::isAboutToQuit())
+	{
+		saveVisits();
+	}
+	else if (m_visitsSaveTimer == 0)
+	{
+		m_visitsSaveTimer = startTimer(5000);
+	}
+}
+
+void BookmarksManager::saveBookmarks()
+{
+	if (!m_model || !m_model->save(SessionsManager::getWritableDataPath(QLatin1String("bookmarks.xbel"))))
+	{
+		return;
+	}
+
+	if (m_visitsSaveTimer != 0)
+	{
+		killTimer(m_visitsSaveTimer);
+
+		m_visitsSaveTimer = 0;
+	}
+
+	if (!m_visits.isEmpty())
+	{
+		m_visits.clear();
+
+		QFile::remove(SessionsManager::getWritableDataPath(QLatin1String("bookmarksVisits.dat")));
+	}
+}
+
+void BookmarksManager::saveVisits()
+{
+	if (m_visitsSaveTimer != 0)
+	{
+		killTimer(m_visitsSaveTimer);
+
+		m_visitsSaveTimer = 0;
+	}
+
+	if (m_visits.isEmpty() || SessionsManager::isReadOnly())
+	{
+		return;
+	}
+
+	QSaveFile file(SessionsManager::getWritableDataPath(QLatin1String("bookmarksVisits.dat")));
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_6);
+	stream << static_cast<quint32>(VisitsCacheMagic) << static_cast<quint32>(VisitsCacheVersion) << static_cast<quint32>(m_visits.count());
+
+	QHash<quint64, VisitsRecord>::const_iterator iterator;
+
+	for (iterator = m_visits.constBegin(); iterator != m_visits.constEnd(); ++iterator)
+	{
+		stream << iterator.key() << static_cast<qint32>(iterator->visits) << iterator->timeVisited;
+	}
+
+	file.commit();
+}
+
 void BookmarksManager::updateVisits(const QUrl &url)
 {
 	ensureInitialized();
@@ -106,15 +229,20 @@ void BookmarksManager::updateVisits(const QUrl &url)
 	}
 
 	const QVector<BookmarksModel::Bookmark*> bookmarks(m_model->getBookmarks(url));
+	const QDateTime currentDateTime(QDateTime::currentDateTimeUtc());
 
 	for (int i = 0; i < bookmarks.count(); ++i)
 	{
 		BookmarksModel::Bookmark *bookmark(bookmarks.at(i));
 		bookmark->setData((bookmark->getVisits() + 1), BookmarksModel::VisitsRole);
-		bookmark->setData(QDateTime::currentDateTimeUtc(), BookmarksModel::TimeVisitedRole);
+		bookmark->setData(currentDateTime, BookmarksModel::TimeVisitedRole);
+
+		VisitsRecord &record(m_visits[bookmark->getIdentifier()]);
+		record.visits = bookmark->getVisits();
+		record.timeVisited = currentDateTime.toMSecsSinceEpoch();
 	}
 
-	m_instance->scheduleSave();
+	m_instance->scheduleVisitsSave();
 }
 
 void BookmarksManager::setLastUsedFolder(BookmarksModel::Bookmark *bookmark)
@@ -23,6 +23,7 @@
 
 #include "BookmarksModel.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QObject>
 
 namespace Otter
@@ -49,19 +50,37 @@ public:
 	static bool hasKeyword(const QString &keyword);
 
 protected:
+	enum VisitsCacheInformation : quint32
+	{
+		VisitsCacheMagic = 0x4f425653,
+		VisitsCacheVersion = 1
+	};
+
+	struct VisitsRecord final
+	{
+		qint64 timeVisited = 0;
+		int visits = 0;
+	};
+
 	explicit BookmarksManager(QObject *parent);
 
 	void timerEvent(QTimerEvent *event) override;
+	void scheduleVisitsSave();
+	void saveBookmarks();
 	static void ensureInitialized();
+	static void loadVisits();
 
 protected slots:
 	void scheduleSave();
+	void saveVisits();
 
 private:
 	int m_saveTimer;
+	int m_visitsSaveTimer;
 
 	static BookmarksManager *m_instance;
 	static BookmarksModel *m_model;
+	static QHash<quint64, VisitsRecord> m_visits;
 	static qulonglong m_lastUsedFolder;
 };
 
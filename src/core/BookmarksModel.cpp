@@ -1622,10 +1622,13 @@ bool BookmarksModel::setData(const QModelIndex &index, const QVariant &value, in
 		case KeywordRole:
 		case TimeAddedRole:
 		case TimeModifiedRole:
+			emit bookmarkModified(bookmark);
+			emit modelModified();
+
+			break;
 		case TimeVisitedRole:
 		case VisitsRole:
 			emit bookmarkModified(bookmark);
-			emit modelModified();
 
 			break;
 		default:
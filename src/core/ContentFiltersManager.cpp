@@ -25,6 +25,7 @@
 #include "JsonSettings.h"
 #include "SettingsManager.h"
 #include "SessionsManager.h"
+#include "../ui/MainWindow.h"
 
 #include <QtCore/QDir>
 #include <QtCore/QJsonArray>
@@ -37,14 +38,38 @@ namespace Otter
 ContentFiltersManager* ContentFiltersManager::m_instance(nullptr);
 QVector<ContentFiltersProfile*> ContentFiltersManager::m_contentBlockingProfiles;
 QVector<ContentFiltersProfile*> ContentFiltersManager::m_fraudCheckingProfiles;
+std::shared_ptr<const ContentFiltersManager::ProfilesSnapshot> ContentFiltersManager::m_profilesSnapshot;
+QHash<quint64, ContentFiltersManager::VerdictCache*> ContentFiltersManager::m_verdictCaches;
+QHash<QString, QString> ContentFiltersManager::m_genericStyleSheets;
+QCache<QString, ContentFiltersManager::CosmeticFiltersStyleSheet> ContentFiltersManager::m_styleSheets(1000);
+QMutex ContentFiltersManager::m_cachesMutex;
+QAtomicInt ContentFiltersManager::m_cachesGeneration(0);
+int ContentFiltersManager::m_styleSheetsGeneration(0);
+QAtomicInt ContentFiltersManager::m_pendingRequestsPolicy(AllowPendingRequestsPolicy);
+QFile* ContentFiltersManager::m_recordingFile(nullptr);
+QMutex ContentFiltersManager::m_recordingMutex;
+QAtomicInt ContentFiltersManager::m_isRecording(0);
 
 ContentFiltersManager::ContentFiltersManager(QObject *parent) : QObject(parent),
 	m_saveTimer(0)
 {
+	handleOptionChanged(SettingsManager::ContentBlocking_PendingRequestsPolicyOption, SettingsManager::getOption(SettingsManager::ContentBlocking_PendingRequestsPolicyOption));
+	handleOptionChanged(SettingsManager::ContentBlocking_RecordRequestsPathOption, SettingsManager::getOption(SettingsManager::ContentBlocking_RecordRequestsPathOption));
+
 	QTimer::singleShot(1000, this, [&]()
 	{
 		initialize();
 	});
+
+	connect(SettingsManager::getInstance(), &SettingsManager::optionChanged, this, &ContentFiltersManager::handleOptionChanged);
+
+	if (Application::getInstance())
+	{
+		connect(Application::getInstance(), &Application::windowAdded, this, [&](MainWindow *mainWindow)
+		{
+			connect(mainWindow, &MainWindow::windowRemoved, this, &ContentFiltersManager::removeVerdictCache);
+		});
+	}
 }
 
 void ContentFiltersManager::createInstance()
@@ -153,6 +178,8 @@ void ContentFiltersManager::initialize()
 
 		profileSummary.lastUpdate = QDateTime::fromString(profileObject.value(QLatin1String("lastUpdate")).toString(), Qt::ISODate);
 		profileSummary.lastUpdate.setTimeSpec(Qt::UTC);
+		profileSummary.updateEntityTag = profileObject.value(QLatin1String("updateEntityTag")).toString();
+		profileSummary.updateLastModified = profileObject.value(QLatin1String("updateLastModified")).toString();
 		profileSummary.category = categoryTitles.value(profileObject.value(QLatin1String("category")).toString());
 		profileSummary.updateInterval = profileObject.value(QLatin1String("updateInterval")).toInt();
 		profileSummary.areWildcardsEnabled = profileObject.value(QLatin1String("areWildcardsEnabled")).toBool();
@@ -172,6 +199,8 @@ void ContentFiltersManager::initialize()
 
 		connect(profile, &ContentFiltersProfile::profileModified, profile, [=]()
 		{
+			invalidateCaches();
+
 			m_instance->scheduleSave();
 
 			emit m_instance->profileModified(profile->getName());
@@ -179,6 +208,20 @@ void ContentFiltersManager::initialize()
 	}
 
 	m_contentBlockingProfiles.squeeze();
+
+	publishProfiles();
+
+	const QStringList enabledProfiles(SettingsManager::getOption(SettingsManager::ContentBlocking_ProfilesOption).toStringList());
+
+	for (int i = 0; i < m_contentBlockingProfiles.count(); ++i)
+	{
+		ContentFiltersProfile *profile(m_contentBlockingProfiles.at(i));
+
+		if (enabledProfiles.contains(profile->getName()))
+		{
+			profile->load();
+		}
+	}
 }
 
 void ContentFiltersManager::timerEvent(QTimerEvent *event)
@@ -212,6 +255,61 @@ void ContentFiltersManager::scheduleSave()
 	}
 }
 
+void ContentFiltersManager::handleOptionChanged(int identifier, const QVariant &value)
+{
+	switch (identifier)
+	{
+		case SettingsManager::ContentBlocking_PendingRequestsPolicyOption:
+			m_pendingRequestsPolicy.storeRelease((value.toString() == QLatin1String("wait")) ? WaitForProfilesPolicy : AllowPendingRequestsPolicy);
+
+			break;
+		case SettingsManager::ContentBlocking_RecordRequestsPathOption:
+			{
+				QMutexLocker locker(&m_recordingMutex);
+				const QString path(value.toString());
+
+				m_isRecording.storeRelease(0);
+
+				if (m_recordingFile)
+				{
+					m_recordingFile->close();
+					m_recordingFile->deleteLater();
+					m_recordingFile = nullptr;
+				}
+
+				if (path.isEmpty())
+				{
+					break;
+				}
+
+				m_recordingFile = new QFile(path, this);
+
+				if (m_recordingFile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+				{
+					m_isRecording.storeRelease(1);
+				}
+				else
+				{
+					Console::addMessage(tr("Failed to open content blocking requests recording file: %1").arg(m_recordingFile->errorString()), Console::OtherCategory, Console::ErrorLevel, path);
+				}
+			}
+
+			break;
+		default:
+			break;
+	}
+}
+
+void ContentFiltersManager::recordRequest(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType)
+{
+	QMutexLocker locker(&m_recordingMutex);
+
+	if (m_recordingFile && m_recordingFile->isOpen())
+	{
+		m_recordingFile->write(QString::number(resourceType).toLatin1() + '\t' + baseUrl.toEncoded() + '\t' + requestUrl.toEncoded() + '\n');
+	}
+}
+
 void ContentFiltersManager::save()
 {
 	const QHash<ContentFiltersProfile::ProfileCategory, QString> categories({{ContentFiltersProfile::AdvertisementsCategory, QLatin1String("advertisements")}, {ContentFiltersProfile::AnnoyanceCategory, QLatin1String("annoyance")}, {ContentFiltersProfile::PrivacyCategory, QLatin1String("privacy")}, {ContentFiltersProfile::SocialCategory, QLatin1String("social")}, {ContentFiltersProfile::RegionalCategory, QLatin1String("regional")}, {ContentFiltersProfile::OtherCategory, QLatin1String("other")}});
@@ -258,6 +356,18 @@ void ContentFiltersManager::save()
 			profileObject.insert(QLatin1String("lastUpdate"), lastUpdate.toString(Qt::ISODate));
 		}
 
+		const ContentFiltersProfile::ProfileSummary profileSummary(profile->getProfileSummary());
+
+		if (!profileSummary.updateEntityTag.isEmpty())
+		{
+			profileObject.insert(QLatin1String("updateEntityTag"), profileSummary.updateEntityTag);
+		}
+
+		if (!profileSummary.updateLastModified.isEmpty())
+		{
+			profileObject.insert(QLatin1String("updateLastModified"), profileSummary.updateLastModified);
+		}
+
 		if (profile->getFlags().testFlag(ContentFiltersProfile::HasCustomTitleFlag))
 		{
 			profileObject.insert(QLatin1String("title"), profile->getTitle());
@@ -289,6 +399,37 @@ void ContentFiltersManager::save()
 	settings.save();
 }
 
+void ContentFiltersManager::publishProfiles(const QVector<ContentFiltersProfile*> &retiredProfiles)
+{
+	const std::shared_ptr<const ProfilesSnapshot> previousSnapshot(std::atomic_load(&m_profilesSnapshot));
+	ProfilesSnapshot *snapshot(new ProfilesSnapshot());
+	snapshot->profiles = m_contentBlockingProfiles;
+
+	std::atomic_store(&m_profilesSnapshot, std::shared_ptr<const ProfilesSnapshot>(snapshot, [](const ProfilesSnapshot *releasedSnapshot)
+	{
+		for (int i = 0; i < releasedSnapshot->retiredProfiles.count(); ++i)
+		{
+			releasedSnapshot->retiredProfiles.at(i)->deleteLater();
+		}
+
+		delete releasedSnapshot;
+	}));
+
+	if (previousSnapshot)
+	{
+		previousSnapshot->retiredProfiles = retiredProfiles;
+	}
+	else
+	{
+		for (int i = 0; i < retiredProfiles.count(); ++i)
+		{
+			retiredProfiles.at(i)->deleteLater();
+		}
+	}
+
+	invalidateCaches();
+}
+
 void ContentFiltersManager::addProfile(ContentFiltersProfile *profile)
 {
 	if (!profile)
@@ -296,31 +437,33 @@ void ContentFiltersManager::addProfile(ContentFiltersProfile *profile)
 		return;
 	}
 
-	bool isReplacing(false);
+	QVector<ContentFiltersProfile*> retiredProfiles;
 
 	for (int i = 0; i < m_contentBlockingProfiles.count(); ++i)
 	{
 		if (m_contentBlockingProfiles.at(i)->getName() == profile->getName())
 		{
-			isReplacing = true;
+			retiredProfiles.append(m_contentBlockingProfiles.at(i));
 
-			m_contentBlockingProfiles.at(i)->deleteLater();
 			m_contentBlockingProfiles.replace(i, profile);
 
 			break;
 		}
 	}
 
-	if (!isReplacing)
+	if (retiredProfiles.isEmpty())
 	{
 		m_contentBlockingProfiles.append(profile);
 	}
 
+	publishProfiles(retiredProfiles);
+
 	m_instance->scheduleSave();
 
 	emit m_instance->profileAdded(profile->getName());
 
 	connect(profile, &ContentFiltersProfile::profileModified, m_instance, &ContentFiltersManager::scheduleSave);
+	connect(profile, &ContentFiltersProfile::profileModified, m_instance, &ContentFiltersManager::invalidateCaches);
 }
 
 void ContentFiltersManager::removeProfile(ContentFiltersProfile *profile, bool removeFile)
@@ -354,11 +497,28 @@ void ContentFiltersManager::removeProfile(ContentFiltersProfile *profile, bool r
 
 	m_contentBlockingProfiles.removeAll(profile);
 
-	profile->deleteLater();
+	publishProfiles({profile});
 
 	emit m_instance->profileRemoved(name);
 }
 
+void ContentFiltersManager::invalidateCaches()
+{
+	m_cachesGeneration.fetchAndAddOrdered(1);
+}
+
+void ContentFiltersManager::removeVerdictCache(quint64 windowIdentifier)
+{
+	QMutexLocker locker(&m_cachesMutex);
+
+	delete m_verdictCaches.take(windowIdentifier);
+}
+
+void ContentFiltersManager::setPendingRequestsPolicy(PendingRequestsPolicy policy)
+{
+	m_pendingRequestsPolicy.storeRelease(policy);
+}
+
 ContentFiltersManager* ContentFiltersManager::getInstance()
 {
 	return m_instance;
@@ -418,6 +578,18 @@ ContentFiltersManager::CheckResult ContentFiltersManager::checkUrl(const QVector
 		return {};
 	}
 
+	const std::shared_ptr<const ProfilesSnapshot> snapshot(std::atomic_load(&m_profilesSnapshot));
+
+	if (!snapshot)
+	{
+		return {};
+	}
+
+	if (m_isRecording.loadAcquire() == 1)
+	{
+		recordRequest(baseUrl, requestUrl, resourceType);
+	}
+
 	CheckResult result;
 	result.isFraud = ((resourceType == NetworkManager::MainFrameType || resourceType == NetworkManager::SubFrameType) ? isFraud(requestUrl) : false);
 
@@ -425,12 +597,12 @@ ContentFiltersManager::CheckResult ContentFiltersManager::checkUrl(const QVector
 	{
 		const int profile(profiles.at(i));
 
-		if (profile < 0 || profile >= m_contentBlockingProfiles.count())
+		if (profile < 0 || profile >= snapshot->profiles.count())
 		{
 			continue;
 		}
 
-		CheckResult currentResult(m_contentBlockingProfiles.at(profile)->checkUrl(baseUrl, requestUrl, resourceType));
+		CheckResult currentResult(snapshot->profiles.at(profile)->checkUrl(baseUrl, requestUrl, resourceType));
 		currentResult.profile = profile;
 		currentResult.isFraud = result.isFraud;
 
@@ -442,6 +614,75 @@ ContentFiltersManager::CheckResult ContentFiltersManager::checkUrl(const QVector
 		{
 			return currentResult;
 		}
+		else if (currentResult.isPending && !result.isBlocked)
+		{
+			result.isPending = true;
+		}
+	}
+
+	return result;
+}
+
+ContentFiltersManager::CheckResult ContentFiltersManager::checkUrl(const QVector<int> &profiles, const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType, quint64 windowIdentifier)
+{
+	if (profiles.isEmpty() || windowIdentifier == 0)
+	{
+		return checkUrl(profiles, baseUrl, requestUrl, resourceType);
+	}
+
+	QString key(QString::number(resourceType) + QLatin1Char('|') + baseUrl.host() + QLatin1Char('|'));
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		key.append(QString::number(profiles.at(i)) + QLatin1Char(','));
+	}
+
+	key.append(QLatin1Char('|') + requestUrl.url());
+
+	const int generation(m_cachesGeneration.loadAcquire());
+
+	{
+		QMutexLocker locker(&m_cachesMutex);
+		VerdictCache *cache(m_verdictCaches.value(windowIdentifier));
+
+		if (!cache)
+		{
+			cache = new VerdictCache();
+			cache->verdicts.setMaxCost(1000);
+
+			m_verdictCaches[windowIdentifier] = cache;
+		}
+
+		if (cache->generation != generation)
+		{
+			cache->verdicts.clear();
+			cache->generation = generation;
+		}
+
+		const CheckResult *result(cache->verdicts.object(key));
+
+		if (result)
+		{
+			++cache->hits;
+
+			if (m_isRecording.loadAcquire() == 1)
+			{
+				recordRequest(baseUrl, requestUrl, resourceType);
+			}
+
+			return *result;
+		}
+
+		++cache->misses;
+	}
+
+	const CheckResult result(checkUrl(profiles, baseUrl, requestUrl, resourceType));
+	QMutexLocker locker(&m_cachesMutex);
+	VerdictCache *cache(m_verdictCaches.value(windowIdentifier));
+
+	if (cache && !result.isPending && cache->generation == generation && m_cachesGeneration.loadAcquire() == generation)
+	{
+		cache->verdicts.insert(key, new CheckResult(result));
 	}
 
 	return result;
@@ -454,7 +695,14 @@ ContentFiltersManager::CosmeticFiltersResult ContentFiltersManager::getCosmeticF
 		return {};
 	}
 
-	const CosmeticFiltersMode mode(checkUrl(profiles, requestUrl, requestUrl, NetworkManager::OtherType).comesticFiltersMode);
+	const std::shared_ptr<const ProfilesSnapshot> snapshot(std::atomic_load(&m_profilesSnapshot));
+
+	if (!snapshot)
+	{
+		return {};
+	}
+
+	const CosmeticFiltersMode mode(getCosmeticFiltersMode(snapshot.get(), profiles, requestUrl));
 
 	if (mode == NoFilters)
 	{
@@ -468,9 +716,9 @@ ContentFiltersManager::CosmeticFiltersResult ContentFiltersManager::getCosmeticF
 	{
 		const int index(profiles.at(i));
 
-		if (index >= 0 && index < m_contentBlockingProfiles.count())
+		if (index >= 0 && index < snapshot->profiles.count())
 		{
-			const CosmeticFiltersResult profileResult(m_contentBlockingProfiles.at(index)->getCosmeticFilters(domains, (mode == DomainOnlyFilters)));
+			const CosmeticFiltersResult profileResult(snapshot->profiles.at(index)->getCosmeticFilters(domains, (mode == DomainOnlyFilters)));
 
 			result.rules.append(profileResult.rules);
 			result.exceptions.append(profileResult.exceptions);
@@ -480,6 +728,190 @@ ContentFiltersManager::CosmeticFiltersResult ContentFiltersManager::getCosmeticF
 	return result;
 }
 
+ContentFiltersManager::CosmeticFiltersStyleSheet ContentFiltersManager::getCosmeticFiltersStyleSheet(const QVector<int> &profiles, const QUrl &requestUrl)
+{
+	if (profiles.isEmpty())
+	{
+		return {};
+	}
+
+	const std::shared_ptr<const ProfilesSnapshot> snapshot(std::atomic_load(&m_profilesSnapshot));
+
+	if (!snapshot)
+	{
+		return {};
+	}
+
+	QString genericKey;
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		genericKey.append(QString::number(profiles.at(i)) + QLatin1Char(','));
+	}
+
+	const CosmeticFiltersMode mode(getCosmeticFiltersMode(snapshot.get(), profiles, requestUrl));
+
+	if (mode == NoFilters)
+	{
+		return {};
+	}
+
+	const QString host(requestUrl.host());
+	const QString hostKey(genericKey + QLatin1Char('|') + QString::number(mode) + QLatin1Char('|') + requestUrl.scheme() + QLatin1Char('|') + host);
+	const int generation(m_cachesGeneration.loadAcquire());
+
+	{
+		QMutexLocker locker(&m_cachesMutex);
+
+		if (m_styleSheetsGeneration != generation)
+		{
+			m_genericStyleSheets.clear();
+			m_styleSheets.clear();
+
+			m_styleSheetsGeneration = generation;
+		}
+
+		const CosmeticFiltersStyleSheet *styleSheet(m_styleSheets.object(hostKey));
+
+		if (styleSheet)
+		{
+			return *styleSheet;
+		}
+	}
+
+	const QStringList domains(createSubdomainList(host));
+	QStringList rules;
+	QStringList exceptions;
+	CosmeticFiltersStyleSheet styleSheet;
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		const int index(profiles.at(i));
+
+		if (index >= 0 && index < snapshot->profiles.count())
+		{
+			const CosmeticFiltersResult profileResult(snapshot->profiles.at(index)->getCosmeticFilters(domains, true));
+
+			rules.append(profileResult.rules);
+			exceptions.append(profileResult.exceptions);
+		}
+	}
+
+	if (mode == AllFilters && exceptions.isEmpty())
+	{
+		QMutexLocker locker(&m_cachesMutex);
+
+		if (m_genericStyleSheets.contains(genericKey))
+		{
+			styleSheet.genericStyleSheet = m_genericStyleSheets.value(genericKey);
+		}
+		else
+		{
+			locker.unlock();
+
+			for (int i = 0; i < profiles.count(); ++i)
+			{
+				const int index(profiles.at(i));
+
+				if (index >= 0 && index < snapshot->profiles.count())
+				{
+					styleSheet.genericStyleSheet.append(snapshot->profiles.at(index)->getCosmeticFiltersStyleSheet());
+				}
+			}
+
+			locker.relock();
+
+			if (m_styleSheetsGeneration == generation)
+			{
+				m_genericStyleSheets[genericKey] = styleSheet.genericStyleSheet;
+			}
+		}
+	}
+	else if (mode == AllFilters)
+	{
+		rules.clear();
+
+		for (int i = 0; i < profiles.count(); ++i)
+		{
+			const int index(profiles.at(i));
+
+			if (index >= 0 && index < snapshot->profiles.count())
+			{
+				rules.append(snapshot->profiles.at(index)->getCosmeticFilters(domains, false).rules);
+			}
+		}
+	}
+
+	for (int i = 0; i < exceptions.count(); ++i)
+	{
+		rules.removeAll(exceptions.at(i));
+	}
+
+	styleSheet.domainStyleSheet = createStyleSheet(rules);
+
+	QMutexLocker locker(&m_cachesMutex);
+
+	if (m_styleSheetsGeneration == generation)
+	{
+		m_styleSheets.insert(hostKey, new CosmeticFiltersStyleSheet(styleSheet), qMax(1, (styleSheet.domainStyleSheet.length() / 1024)));
+	}
+
+	return styleSheet;
+}
+
+ContentFiltersManager::CosmeticFiltersMode ContentFiltersManager::getCosmeticFiltersMode(const ProfilesSnapshot *snapshot, const QVector<int> &profiles, const QUrl &requestUrl)
+{
+	const QString scheme(requestUrl.scheme());
+
+	if (scheme != QLatin1String("http") && scheme != QLatin1String("https"))
+	{
+		return AllFilters;
+	}
+
+	CosmeticFiltersMode mode(AllFilters);
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		const int index(profiles.at(i));
+
+		if (index < 0 || index >= snapshot->profiles.count())
+		{
+			continue;
+		}
+
+		const CheckResult result(snapshot->profiles.at(index)->checkUrl(requestUrl, requestUrl, NetworkManager::OtherType));
+
+		if (result.isException)
+		{
+			return result.comesticFiltersMode;
+		}
+
+		if (result.isBlocked)
+		{
+			mode = result.comesticFiltersMode;
+		}
+	}
+
+	return mode;
+}
+
+QString ContentFiltersManager::createStyleSheet(const QStringList &selectors)
+{
+	QString styleSheet;
+
+	for (int i = 0; i < selectors.count(); ++i)
+	{
+		const QString &selector(selectors.at(i));
+
+		if (!selector.isEmpty() && !selector.contains(QLatin1Char('{')) && !selector.contains(QLatin1Char('}')) && !selector.contains(QLatin1Char('<')))
+		{
+			styleSheet.append(selector + QLatin1String("{display:none !important}\n"));
+		}
+	}
+
+	return styleSheet;
+}
+
 QStringList ContentFiltersManager::createSubdomainList(const QString &domain)
 {
 	QStringList subdomainList;
@@ -550,6 +982,30 @@ QVector<int> ContentFiltersManager::getProfileIdentifiers(const QStringList &nam
 	return identifiers;
 }
 
+ContentFiltersManager::VerdictCacheStatistics ContentFiltersManager::getVerdictCacheStatistics(quint64 windowIdentifier)
+{
+	QMutexLocker locker(&m_cachesMutex);
+	VerdictCacheStatistics statistics;
+	QHash<quint64, VerdictCache*>::const_iterator iterator;
+
+	for (iterator = m_verdictCaches.constBegin(); iterator != m_verdictCaches.constEnd(); ++iterator)
+	{
+		if (windowIdentifier == 0 || iterator.key() == windowIdentifier)
+		{
+			statistics.hits += iterator.value()->hits;
+			statistics.misses += iterator.value()->misses;
+			statistics.amount += iterator.value()->verdicts.count();
+		}
+	}
+
+	return statistics;
+}
+
+ContentFiltersManager::PendingRequestsPolicy ContentFiltersManager::getPendingRequestsPolicy()
+{
+	return static_cast<PendingRequestsPolicy>(m_pendingRequestsPolicy.loadAcquire());
+}
+
 bool ContentFiltersManager::isFraud(const QUrl &url)
 {
 	for (int i = 0; i < m_fraudCheckingProfiles.count(); ++i)
@@ -23,8 +23,14 @@
 
 #include "NetworkManager.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
 #include <QtCore/QUrl>
 
+#include <memory>
+
 namespace Otter
 {
 
@@ -42,6 +48,12 @@ public:
 		AllFilters
 	};
 
+	enum PendingRequestsPolicy
+	{
+		AllowPendingRequestsPolicy = 0,
+		WaitForProfilesPolicy
+	};
+
 	struct CheckResult final
 	{
 		QString rule;
@@ -50,6 +62,7 @@ public:
 		bool isBlocked = false;
 		bool isException = false;
 		bool isFraud = false;
+		bool isPending = false;
 	};
 
 	struct CosmeticFiltersResult final
@@ -58,6 +71,19 @@ public:
 		QStringList exceptions;
 	};
 
+	struct CosmeticFiltersStyleSheet final
+	{
+		QString genericStyleSheet;
+		QString domainStyleSheet;
+	};
+
+	struct VerdictCacheStatistics final
+	{
+		quint64 hits = 0;
+		quint64 misses = 0;
+		int amount = 0;
+	};
+
 	static void createInstance();
 	static void initialize();
 	static void addProfile(ContentFiltersProfile *profile);
@@ -66,35 +92,73 @@ public:
 	static ContentFiltersProfile* getProfile(const QString &name);
 	static ContentFiltersProfile* getProfile(const QUrl &url);
 	static ContentFiltersProfile* getProfile(int identifier);
+	static void invalidateCaches();
+	static void removeVerdictCache(quint64 windowIdentifier);
+	static void setPendingRequestsPolicy(PendingRequestsPolicy policy);
 	static CheckResult checkUrl(const QVector<int> &profiles, const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
+	static CheckResult checkUrl(const QVector<int> &profiles, const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType, quint64 windowIdentifier);
 	static CosmeticFiltersResult getCosmeticFilters(const QVector<int> &profiles, const QUrl &requestUrl);
+	static CosmeticFiltersStyleSheet getCosmeticFiltersStyleSheet(const QVector<int> &profiles, const QUrl &requestUrl);
+	static QString createStyleSheet(const QStringList &selectors);
 	static QStringList createSubdomainList(const QString &domain);
 	static QStringList getProfileNames();
 	static QVector<ContentFiltersProfile*> getContentBlockingProfiles();
 	static QVector<ContentFiltersProfile*> getFraudCheckingProfiles();
 	static QVector<int> getProfileIdentifiers(const QStringList &names);
+	static VerdictCacheStatistics getVerdictCacheStatistics(quint64 windowIdentifier = 0);
+	static PendingRequestsPolicy getPendingRequestsPolicy();
 	static bool isFraud(const QUrl &url);
 
 protected:
+	struct ProfilesSnapshot final
+	{
+		QVector<ContentFiltersProfile*> profiles;
+		mutable QVector<ContentFiltersProfile*> retiredProfiles;
+	};
+
+	struct VerdictCache final
+	{
+		QCache<QString, CheckResult> verdicts;
+		int generation = 0;
+		quint64 hits = 0;
+		quint64 misses = 0;
+	};
+
 	explicit ContentFiltersManager(QObject *parent);
 
 	void timerEvent(QTimerEvent *event) override;
 	void save();
+	static void recordRequest(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType);
+	static void publishProfiles(const QVector<ContentFiltersProfile*> &retiredProfiles = {});
+	static CosmeticFiltersMode getCosmeticFiltersMode(const ProfilesSnapshot *snapshot, const QVector<int> &profiles, const QUrl &requestUrl);
 
 protected slots:
 	void scheduleSave();
+	void handleOptionChanged(int identifier, const QVariant &value);
 
 private:
 	int m_saveTimer;
 
 	static ContentFiltersManager *m_instance;
+	static QAtomicInt m_pendingRequestsPolicy;
+	static QFile *m_recordingFile;
+	static QMutex m_recordingMutex;
+	static QAtomicInt m_isRecording;
 	static QVector<ContentFiltersProfile*> m_contentBlockingProfiles;
 	static QVector<ContentFiltersProfile*> m_fraudCheckingProfiles;
+	static std::shared_ptr<const ProfilesSnapshot> m_profilesSnapshot;
+	static QHash<quint64, VerdictCache*> m_verdictCaches;
+	static QHash<QString, QString> m_genericStyleSheets;
+	static QCache<QString, CosmeticFiltersStyleSheet> m_styleSheets;
+	static int m_styleSheetsGeneration;
+	static QMutex m_cachesMutex;
+	static QAtomicInt m_cachesGeneration;
 
 signals:
 	void profileAdded(const QString &profile);
 	void profileModified(const QString &profile);
 	void profileRemoved(const QString &profile);
+	void profileLoaded(const QString &profile);
 };
 
 class ContentFiltersProfile : public QObject
@@ -132,6 +196,8 @@ public:
 	{
 		QString name;
 		QString title;
+		QString updateEntityTag;
+		QString updateLastModified;
 		QDateTime lastUpdate;
 		QUrl updateUrl;
 		ProfileCategory category = OtherCategory;
@@ -143,6 +209,7 @@ public:
 	explicit ContentFiltersProfile(QObject *parent = nullptr);
 
 	virtual void clear() = 0;
+	virtual void load() = 0;
 	virtual void setProfileSummary(const ProfileSummary &profileSummary) = 0;
 	virtual QString getName() const = 0;
 	virtual QString getTitle() const = 0;
@@ -152,6 +219,7 @@ public:
 	virtual ProfileSummary getProfileSummary() const = 0;
 	virtual ContentFiltersManager::CheckResult checkUrl(const QUrl &baseUrl, const QUrl &requestUrl, NetworkManager::ResourceType resourceType) = 0;
 	virtual ContentFiltersManager::CosmeticFiltersResult getCosmeticFilters(const QStringList &domains, bool isDomainOnly) = 0;
+	virtual QString getCosmeticFiltersStyleSheet() = 0;
 	virtual QVector<QLocale::Language> getLanguages() const = 0;
 	virtual ProfileCategory getCategory() const = 0;
 	virtual ContentFiltersManager::CosmeticFiltersMode getCosmeticFiltersMode() const = 0;
@@ -159,6 +227,7 @@ public:
 	virtual ProfileFlags getFlags() const = 0;
 	virtual int getUpdateInterval() const = 0;
 	virtual int getUpdateProgress() const = 0;
+	virtual qint64 getMemoryUsage() const = 0;
 	virtual bool update(const QUrl &url = {}) = 0;
 	virtual bool remove() = 0;
 	virtual bool areWildcardsEnabled() const = 0;
@@ -0,0 +1,702 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2023 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "FaviconsManager.h"
+#include "Application.h"
+#include "Console.h"
+#include "SessionsManager.h"
+#include "Utils.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+#include <QtCore/QTimerEvent>
+
+namespace Otter
+{
+
+FaviconsManager* FaviconsManager::m_instance(nullptr);
+QHash<QByteArray, FaviconsManager::IconBlob> FaviconsManager::m_blobs;
+QHash<QString, QByteArray> FaviconsManager::m_hosts;
+QHash<QString, QByteArray> FaviconsManager::m_urls;
+QHash<QString, int> FaviconsManager::m_hostUrlsAmounts;
+QCache<QByteArray, QPixmap> FaviconsManager::m_pixmaps(500);
+QByteArray FaviconsManager::m_journal;
+int FaviconsManager::m_journalRecordsAmount(0);
+bool FaviconsManager::m_isLoaded(false);
+bool FaviconsManager::m_needsCompaction(false);
+
+FaviconsManager::FaviconsManager(QObject *parent) : QObject(parent),
+	m_saveTimer(0)
+{
+	connect(QCoreApplication::instance(), &Application::aboutToQuit, this, [&]()
+	{
+		save();
+
+		m_pixmaps.clear();
+	});
+}
+
+void FaviconsManager::createInstance()
+{
+	if (!m_instance)
+	{
+		m_instance = new FaviconsManager(QCoreApplication::instance());
+	}
+}
+
+void FaviconsManager::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() == m_saveTimer)
+	{
+		killTimer(m_saveTimer);
+
+		m_saveTimer = 0;
+
+		save();
+	}
+}
+
+void FaviconsManager::scheduleSave()
+{
+	if (Application::isAboutToQuit())
+	{
+		save();
+	}
+	else if (m_saveTimer == 0)
+	{
+		m_saveTimer = startTimer(1000);
+	}
+}
+
+void FaviconsManager::save()
+{
+	if (m_saveTimer != 0)
+	{
+		killTimer(m_saveTimer);
+
+		m_saveTimer = 0;
+	}
+
+	if (!m_isLoaded || SessionsManager::isReadOnly())
+	{
+		return;
+	}
+
+	if (m_needsCompaction || m_journalRecordsAmount > qMax(1000, (m_urls.count() + m_hosts.count())))
+	{
+		compact();
+
+		return;
+	}
+
+	QFile packFile(SessionsManager::getWritableDataPath(QLatin1String("favicons.pack")));
+	QHash<QByteArray, IconBlob>::iterator iterator;
+
+	for (iterator = m_blobs.begin(); iterator != m_blobs.end(); ++iterator)
+	{
+		if (iterator->offset >= 0)
+		{
+			continue;
+		}
+
+		if (!packFile.isOpen() && !packFile.open(QIODevice::Append))
+		{
+			Console::addMessage(tr("Failed to save favicons: %1").arg(packFile.errorString()), Console::OtherCategory, Console::ErrorLevel, packFile.fileName());
+
+			return;
+		}
+
+		const qint64 offset(packFile.size());
+
+		if (packFile.write(iterator->data) != iterator->data.size())
+		{
+			Console::addMessage(tr("Failed to save favicons: %1").arg(packFile.errorString()), Console::OtherCategory, Console::ErrorLevel, packFile.fileName());
+
+			return;
+		}
+
+		iterator->offset = offset;
+		iterator->size = iterator->data.size();
+		iterator->data.clear();
+
+		appendJournalRecord(AddBlobAction, {}, iterator.key(), iterator->offset, iterator->size);
+	}
+
+	packFile.close();
+
+	if (m_journal.isEmpty())
+	{
+		return;
+	}
+
+	QFile journalFile(SessionsManager::getWritableDataPath(QLatin1String("favicons.journal")));
+
+	if (!journalFile.open(QIODevice::Append))
+	{
+		Console::addMessage(tr("Failed to save favicons: %1").arg(journalFile.errorString()), Console::OtherCategory, Console::ErrorLevel, journalFile.fileName());
+
+		return;
+	}
+
+	if (journalFile.write(m_journal) != m_journal.size())
+	{
+		Console::addMessage(tr("Failed to save favicons: %1").arg(journalFile.errorString()), Console::OtherCategory, Console::ErrorLevel, journalFile.fileName());
+
+		m_needsCompaction = true;
+
+		return;
+	}
+
+	m_journal.clear();
+}
+
+void FaviconsManager::compact()
+{
+	QSet<QByteArray> hashes;
+	hashes.reserve(m_urls.count() + m_hosts.count());
+
+	for (QHash<QString, QByteArray>::const_iterator iterator = m_urls.constBegin(); iterator != m_urls.constEnd(); ++iterator)
+	{
+		hashes.insert(iterator.value());
+	}
+
+	for (QHash<QString, QByteArray>::const_iterator iterator = m_hosts.constBegin(); iterator != m_hosts.constEnd(); ++iterator)
+	{
+		hashes.insert(iterator.value());
+	}
+
+	const QString packPath(SessionsManager::getWritableDataPath(QLatin1String("favicons.pack")));
+	QFile previousPackFile(packPath);
+	QSaveFile packFile(packPath);
+
+	if (!packFile.open(QIODevice::WriteOnly))
+	{
+		Console::addMessage(tr("Failed to save favicons: %1").arg(packFile.errorString()), Console::OtherCategory, Console::ErrorLevel, packPath);
+
+		return;
+	}
+
+	previousPackFile.open(QIODevice::ReadOnly);
+
+	QHash<QByteArray, IconBlob> blobs;
+	blobs.reserve(hashes.count());
+
+	for (QSet<QByteArray>::const_iterator iterator = hashes.constBegin(); iterator != hashes.constEnd(); ++iterator)
+	{
+		const QHash<QByteArray, IconBlob>::const_iterator blobIterator(m_blobs.constFind(*iterator));
+
+		if (blobIterator == m_blobs.constEnd())
+		{
+			continue;
+		}
+
+		QByteArray data(blobIterator->data);
+
+		if (data.isEmpty() && previousPackFile.isOpen() && previousPackFile.seek(blobIterator->offset))
+		{
+			data = previousPackFile.read(blobIterator->size);
+		}
+
+		if (data.isEmpty() || QCryptographicHash::hash(data, QCryptographicHash::Sha1) != *iterator)
+		{
+			continue;
+		}
+
+		IconBlob blob;
+		blob.offset = packFile.pos();
+		blob.size = data.size();
+
+		if (packFile.write(data) != data.size())
+		{
+			Console::addMessage(tr("Failed to save favicons: %1").arg(packFile.errorString()), Console::OtherCategory, Console::ErrorLevel, packPath);
+
+			packFile.cancelWriting();
+
+			return;
+		}
+
+		blobs[*iterator] = blob;
+	}
+
+	previousPackFile.close();
+
+	if (!packFile.commit())
+	{
+		Console::addMessage(tr("Failed to save favicons: %1").arg(packFile.errorString()), Console::OtherCategory, Console::ErrorLevel, packPath);
+
+		return;
+	}
+
+	m_blobs = blobs;
+	m_journal.clear();
+	m_journalRecordsAmount = 0;
+	m_needsCompaction = true;
+
+	QHash<QString, QByteArray>::iterator iterator(m_hosts.begin());
+
+	while (iterator != m_hosts.end())
+	{
+		iterator = (m_blobs.contains(iterator.value()) ? (iterator + 1) : m_hosts.erase(iterator));
+	}
+
+	iterator = m_urls.begin();
+
+	while (iterator != m_urls.end())
+	{
+		if (m_blobs.contains(iterator.value()))
+		{
+			++iterator;
+
+			continue;
+		}
+
+		const QString host(QUrl(iterator.key()).host());
+
+		if (m_hostUrlsAmounts.contains(host) && --m_hostUrlsAmounts[host] <= 0)
+		{
+			m_hostUrlsAmounts.remove(host);
+		}
+
+		iterator = m_urls.erase(iterator);
+	}
+
+	QSaveFile indexFile(SessionsManager::getWritableDataPath(QLatin1String("favicons.index")));
+
+	if (!indexFile.open(QIODevice::WriteOnly))
+	{
+		Console::addMessage(tr("Failed to save favicons: %1").arg(indexFile.errorString()), Console::OtherCategory, Console::ErrorLevel, indexFile.fileName());
+
+		return;
+	}
+
+	QDataStream stream(&indexFile);
+	stream.setVersion(QDataStream::Qt_5_6);
+	stream << static_cast<quint32>(IndexMagic) << static_cast<quint32>(IndexVersion) << static_cast<quint32>(m_blobs.count());
+
+	for (QHash<QByteArray, IconBlob>::const_iterator blobIterator = m_blobs.constBegin(); blobIterator != m_blobs.constEnd(); ++blobIterator)
+	{
+		stream << blobIterator.key() << blobIterator->offset << static_cast<qint32>(blobIterator->size);
+	}
+
+	stream << m_hosts << m_urls;
+
+	if (!indexFile.commit())
+	{
+		Console::addMessage(tr("Failed to save favicons: %1").arg(indexFile.errorString()), Console::OtherCategory, Console::ErrorLevel, indexFile.fileName());
+
+		return;
+	}
+
+	QFile::remove(SessionsManager::getWritableDataPath(QLatin1String("favicons.journal")));
+
+	m_needsCompaction = false;
+}
+
+void FaviconsManager::appendJournalRecord(JournalAction action, const QString &key, const QByteArray &hash, qint64 offset, int size)
+{
+	QDataStream stream(&m_journal, QIODevice::Append);
+	stream.setVersion(QDataStream::Qt_5_6);
+	stream << static_cast<quint8>(action) << key << hash << offset << static_cast<qint32>(size);
+
+	++m_journalRecordsAmount;
+}
+
+void FaviconsManager::ensureLoaded()
+{
+	if (m_isLoaded)
+	{
+		return;
+	}
+
+	m_isLoaded = true;
+
+	QFile indexFile(SessionsManager::getWritableDataPath(QLatin1String("favicons.index")));
+
+	if (indexFile.open(QIODevice::ReadOnly))
+	{
+		QDataStream stream(&indexFile);
+		stream.setVersion(QDataStream::Qt_5_6);
+
+		quint32 magic(0);
+		quint32 version(0);
+		quint32 amount(0);
+
+		stream >> magic >> version >> amount;
+
+		if (magic == IndexMagic && version == IndexVersion)
+		{
+			m_blobs.reserve(static_cast<int>(amount));
+
+			for (quint32 i = 0; i < amount; ++i)
+			{
+				QByteArray hash;
+				IconBlob blob;
+				qint32 size(0);
+
+				stream >> hash >> blob.offset >> size;
+
+				blob.size = size;
+
+				m_blobs[hash] = blob;
+			}
+
+			stream >> m_hosts >> m_urls;
+
+			if (stream.status() != QDataStream::Ok)
+			{
+				m_blobs.clear();
+				m_hosts.clear();
+				m_urls.clear();
+			}
+		}
+
+		indexFile.close();
+	}
+
+	QFile journalFile(SessionsManager::getWritableDataPath(QLatin1String("favicons.journal")));
+
+	if (journalFile.open(QIODevice::ReadOnly))
+	{
+		QDataStream stream(&journalFile);
+		stream.setVersion(QDataStream::Qt_5_6);
+
+		while (!stream.atEnd())
+		{
+			quint8 action(0);
+			QString key;
+			QByteArray hash;
+			qint64 offset(-1);
+			qint32 size(0);
+
+			stream >> action >> key >> hash >> offset >> size;
+
+			if (stream.status() != QDataStream::Ok)
+			{
+				m_needsCompaction = true;
+
+				break;
+			}
+
+			++m_journalRecordsAmount;
+
+			switch (action)
+			{
+				case AddBlobAction:
+					{
+						IconBlob blob;
+						blob.offset = offset;
+						blob.size = size;
+
+						m_blobs[hash] = blob;
+					}
+
+					break;
+				case SetUrlAction:
+					m_urls[key] = hash;
+
+					break;
+				case SetHostAction:
+					m_hosts[key] = hash;
+
+					break;
+				case RemoveUrlAction:
+					m_urls.remove(key);
+
+					break;
+				case RemoveHostAction:
+					m_hosts.remove(key);
+
+					break;
+				case ClearAction:
+					m_blobs.clear();
+					m_hosts.clear();
+					m_urls.clear();
+
+					break;
+				default:
+					break;
+			}
+		}
+
+		journalFile.close();
+	}
+
+	const qint64 packSize(QFileInfo(SessionsManager::getWritableDataPath(QLatin1String("favicons.pack"))).size());
+	QHash<QByteArray, IconBlob>::iterator blobIterator(m_blobs.begin());
+
+	while (blobIterator != m_blobs.end())
+	{
+		blobIterator = ((blobIterator->offset >= 0 && blobIterator->size > 0 && (blobIterator->offset + blobIterator->size) <= packSize) ? (blobIterator + 1) : m_blobs.erase(blobIterator));
+	}
+
+	QHash<QString, QByteArray>::iterator iterator(m_hosts.begin());
+
+	while (iterator != m_hosts.end())
+	{
+		iterator = (m_blobs.contains(iterator.value()) ? (iterator + 1) : m_hosts.erase(iterator));
+	}
+
+	iterator = m_urls.begin();
+
+	while (iterator != m_urls.end())
+	{
+		if (!m_blobs.contains(iterator.value()))
+		{
+			iterator = m_urls.erase(iterator);
+
+			continue;
+		}
+
+		const QString host(QUrl(iterator.key()).host());
+
+		if (!host.isEmpty())
+		{
+			++m_hostUrlsAmounts[host];
+		}
+
+		++iterator;
+	}
+}
+
+void FaviconsManager::clearIcons()
+{
+	ensureLoaded();
+
+	m_blobs.clear();
+	m_hosts.clear();
+	m_urls.clear();
+	m_hostUrlsAmounts.clear();
+	m_pixmaps.clear();
+
+	appendJournalRecord(ClearAction);
+
+	m_needsCompaction = true;
+
+	if (m_instance)
+	{
+		m_instance->save();
+	}
+}
+
+void FaviconsManager::removeIcon(const QUrl &url)
+{
+	ensureLoaded();
+
+	const QString urlKey(getUrlKey(url));
+
+	if (m_urls.remove(urlKey) == 0)
+	{
+		return;
+	}
+
+	appendJournalRecord(RemoveUrlAction, urlKey);
+
+	const QString host(url.host());
+
+	if (m_hostUrlsAmounts.contains(host) && --m_hostUrlsAmounts[host] <= 0)
+	{
+		m_hostUrlsAmounts.remove(host);
+
+		if (m_hosts.remove(host) > 0)
+		{
+			appendJournalRecord(RemoveHostAction, host);
+		}
+	}
+
+	if (m_instance)
+	{
+		m_instance->scheduleSave();
+	}
+}
+
+void FaviconsManager::setIcon(const QUrl &url, const QIcon &icon)
+{
+	if (icon.isNull() || Utils::isUrlEmpty(url))
+	{
+		return;
+	}
+
+	ensureLoaded();
+
+	const QPixmap pixmap(icon.pixmap(icon.actualSize(QSize(32, 32))));
+
+	if (pixmap.isNull())
+	{
+		return;
+	}
+
+	QByteArray data;
+	QBuffer buffer(&data);
+	buffer.open(QIODevice::WriteOnly);
+
+	if (!pixmap.save(&buffer, "PNG"))
+	{
+		return;
+	}
+
+	const QByteArray hash(QCryptographicHash::hash(data, QCryptographicHash::Sha1));
+	const QString urlKey(getUrlKey(url));
+	const QString host(url.host());
+	bool isModified(false);
+
+	if (!m_blobs.contains(hash))
+	{
+		IconBlob blob;
+		blob.data = data;
+		blob.size = data.size();
+
+		m_blobs[hash] = blob;
+
+		isModified = true;
+	}
+
+	if (!m_pixmaps.contains(hash) && !Application::isAboutToQuit())
+	{
+		m_pixmaps.insert(hash, new QPixmap(pixmap));
+	}
+
+	if (!host.isEmpty() && !m_urls.contains(urlKey))
+	{
+		++m_hostUrlsAmounts[host];
+	}
+
+	if (m_urls.value(urlKey) != hash)
+	{
+		m_urls[urlKey] = hash;
+
+		appendJournalRecord(SetUrlAction, urlKey, hash);
+
+		isModified = true;
+	}
+
+	if (!host.isEmpty() && m_hosts.value(host) != hash)
+	{
+		m_hosts[host] = hash;
+
+		appendJournalRecord(SetHostAction, host, hash);
+
+		isModified = true;
+	}
+
+	if (isModified && m_instance)
+	{
+		m_instance->scheduleSave();
+	}
+}
+
+FaviconsManager* FaviconsManager::getInstance()
+{
+	return m_instance;
+}
+
+QIcon FaviconsManager::loadIcon(const QByteArray &hash)
+{
+	const QPixmap *cachedPixmap(m_pixmaps.object(hash));
+
+	if (cachedPixmap)
+	{
+		return QIcon(*cachedPixmap);
+	}
+
+	if (!m_blobs.contains(hash))
+	{
+		return {};
+	}
+
+	const IconBlob &blob(m_blobs[hash]);
+	QByteArray data(blob.data);
+
+	if (data.isEmpty() && blob.offset >= 0)
+	{
+		QFile packFile(SessionsManager::getWritableDataPath(QLatin1String("favicons.pack")));
+
+		if (!packFile.open(QIODevice::ReadOnly) || !packFile.seek(blob.offset))
+		{
+			return {};
+		}
+
+		data = packFile.read(blob.size);
+
+		if (QCryptographicHash::hash(data, QCryptographicHash::Sha1) != hash)
+		{
+			m_blobs.remove(hash);
+
+			return {};
+		}
+	}
+
+	QPixmap pixmap;
+
+	if (!pixmap.loadFromData(data, "PNG"))
+	{
+		return {};
+	}
+
+	if (!Application::isAboutToQuit())
+	{
+		m_pixmaps.insert(hash, new QPixmap(pixmap));
+	}
+
+	return QIcon(pixmap);
+}
+
+QIcon FaviconsManager::getIcon(const QUrl &url)
+{
+	ensureLoaded();
+
+	const QString urlKey(getUrlKey(url));
+
+	if (m_urls.contains(urlKey))
+	{
+		return loadIcon(m_urls.value(urlKey));
+	}
+
+	return getIcon(url.host());
+}
+
+QIcon FaviconsManager::getIcon(const QString &host)
+{
+	ensureLoaded();
+
+	if (host.isEmpty() || !m_hosts.contains(host))
+	{
+		return {};
+	}
+
+	return loadIcon(m_hosts.value(host));
+}
+
+QString FaviconsManager::getUrlKey(const QUrl &url)
+{
+	return Utils::normalizeUrl(url).toString(QUrl::RemoveFragment);
+}
+
+bool FaviconsManager::hasIcon(const QUrl &url)
+{
+	ensureLoaded();
+
+	return (m_urls.contains(getUrlKey(url)) || m_hosts.contains(url.host()));
+}
+
+}
@@ -0,0 +1,99 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2023 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_FAVICONSMANAGER_H
+#define OTTER_FAVICONSMANAGER_H
+
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QUrl>
+#include <QtGui/QIcon>
+#include <QtGui/QPixmap>
+
+namespace Otter
+{
+
+class FaviconsManager final : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum IndexInformation : quint32
+	{
+		IndexMagic = 0x4f464156,
+		IndexVersion = 1
+	};
+
+	enum JournalAction : quint8
+	{
+		AddBlobAction = 0,
+		SetUrlAction,
+		SetHostAction,
+		RemoveUrlAction,
+		RemoveHostAction,
+		ClearAction
+	};
+
+	static void createInstance();
+	static void clearIcons();
+	static void removeIcon(const QUrl &url);
+	static void setIcon(const QUrl &url, const QIcon &icon);
+	static FaviconsManager* getInstance();
+	static QIcon getIcon(const QUrl &url);
+	static QIcon getIcon(const QString &host);
+	static bool hasIcon(const QUrl &url);
+
+protected:
+	struct IconBlob final
+	{
+		QByteArray data;
+		qint64 offset = -1;
+		int size = 0;
+	};
+
+	explicit FaviconsManager(QObject *parent);
+
+	void timerEvent(QTimerEvent *event) override;
+	void scheduleSave();
+	void save();
+	void compact();
+	static void appendJournalRecord(JournalAction action, const QString &key = {}, const QByteArray &hash = {}, qint64 offset = -1, int size = 0);
+	static void ensureLoaded();
+	static QIcon loadIcon(const QByteArray &hash);
+	static QString getUrlKey(const QUrl &url);
+
+private:
+	int m_saveTimer;
+
+	static FaviconsManager *m_instance;
+	static QHash<QByteArray, IconBlob> m_blobs;
+	static QHash<QString, QByteArray> m_hosts;
+	static QHash<QString, QByteArray> m_urls;
+	static QHash<QString, int> m_hostUrlsAmounts;
+	static QCache<QByteArray, QPixmap> m_pixmaps;
+	static QByteArray m_journal;
+	static int m_journalRecordsAmount;
+	static bool m_isLoaded;
+	static bool m_needsCompaction;
+};
+
+}
+
+#endif
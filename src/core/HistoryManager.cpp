@@ -21,6 +21,7 @@
 #include "HistoryManager.h"
 #include "AddonsManager.h"
 #include "Application.h"
+#include "FaviconsManager.h"
 #include "SessionsManager.h"
 #include "SettingsManager.h"
 #include "ThemesManager.h"
@@ -45,6 +46,7 @@ HistoryManager::HistoryManager(QObject *parent) : QObject(parent),
 	handleOptionChanged(SettingsManager::History_StoreFaviconsOption);
 
 	connect(SettingsManager::getInstance(), &SettingsManager::optionChanged, this, &HistoryManager::handleOptionChanged);
+	connect(QCoreApplication::instance(), &Application::aboutToQuit, this, &HistoryManager::save);
 }
 
 void HistoryManager::createInstance()
@@ -69,22 +71,7 @@ void HistoryManager::timerEvent(QTimerEvent *event)
 	{
 		killTimer(m_dayTimer);
 
-		if (!m_browsingHistoryModel)
-		{
-			getBrowsingHistoryModel();
-		}
-
-		if (!m_typedHistoryModel)
-		{
-			getTypedHistoryModel();
-		}
-
-		const int period(SettingsManager::getOption(SettingsManager::History_BrowsingLimitPeriodOption).toInt());
-
-		m_browsingHistoryModel->clearOldestEntries(period);
-		m_typedHistoryModel->clearOldestEntries(period);
-
-		scheduleSave();
+		expireEntries();
 
 		emit dayChanged();
 
@@ -113,15 +100,41 @@ void HistoryManager::scheduleSave()
 
 void HistoryManager::save()
 {
+	if (m_saveTimer != 0)
+	{
+		killTimer(m_saveTimer);
+
+		m_saveTimer = 0;
+	}
+
 	if (m_browsingHistoryModel)
 	{
-		m_browsingHistoryModel->save(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.json")));
+		m_browsingHistoryModel->save();
 	}
 
 	if (m_typedHistoryModel)
 	{
-		m_typedHistoryModel->save(SessionsManager::getWritableDataPath(QLatin1String("typedHistory.json")));
+		m_typedHistoryModel->save();
+	}
+}
+
+void HistoryManager::expireEntries()
+{
+	if (!m_browsingHistoryModel)
+	{
+		getBrowsingHistoryModel();
+	}
+
+	if (!m_typedHistoryModel)
+	{
+		getTypedHistoryModel();
 	}
+
+	const int limit(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt());
+	const int period(SettingsManager::getOption(SettingsManager::History_BrowsingLimitPeriodOption).toInt());
+
+	m_browsingHistoryModel->expireEntries(limit, period);
+	m_typedHistoryModel->expireEntries(limit, period);
 }
 
 void HistoryManager::clearHistory(uint period)
@@ -152,7 +165,7 @@ void HistoryManager::removeEntry(quint64 identifier)
 		getBrowsingHistoryModel();
 	}
 
-	m_browsingHistoryModel->removeEntry(identifier);
+	m_browsingHistoryModel->removeEntries({identifier});
 }
 
 void HistoryManager::removeEntries(const QVector<quint64> &identifiers)
@@ -167,10 +180,22 @@ void HistoryManager::removeEntries(const QVector<quint64> &identifiers)
 		getBrowsingHistoryModel();
 	}
 
-	for (int i = 0; i < identifiers.count(); ++i)
+	m_browsingHistoryModel->removeEntries(identifiers);
+}
+
+void HistoryManager::removeDomainEntries(const QString &host)
+{
+	if (!m_isEnabled)
+	{
+		return;
+	}
+
+	if (!m_browsingHistoryModel)
 	{
-		m_browsingHistoryModel->removeEntry(identifiers.at(i));
+		getBrowsingHistoryModel();
 	}
+
+	m_browsingHistoryModel->removeDomainEntries(host);
 }
 
 void HistoryManager::updateEntry(quint64 identifier, const QUrl &url, const QString &title, const QIcon &icon)
@@ -180,28 +205,29 @@ void HistoryManager::updateEntry(quint64 identifier, const QUrl &url, const QStr
 		return;
 	}
 
+	if (!m_browsingHistoryModel)
+	{
+		getBrowsingHistoryModel();
+	}
+
 	if (!SettingsManager::getOption(SettingsManager::History_RememberBrowsingOption, Utils::extractHost(url)).toBool())
 	{
-		removeEntry(identifier);
+		m_browsingHistoryModel->removeEntry(identifier);
 
 		return;
 	}
 
-	if (!m_browsingHistoryModel)
+	if (m_isStoringFavicons)
 	{
-		getBrowsingHistoryModel();
+		FaviconsManager::setIcon(url, icon);
 	}
 
-	HistoryModel::Entry *entry(m_browsingHistoryModel->getEntry(identifier));
-
-	if (entry)
-	{
-		entry->setData(url, HistoryModel::UrlRole);
-		entry->setData(title, HistoryModel::TitleRole);
-		entry->setIcon(icon);
+	m_browsingHistoryModel->updateEntry(identifier, url, title);
+}
 
-		m_instance->scheduleSave();
-	}
+void HistoryManager::handleEntryRemoved(const HistoryModel::Entry &entry)
+{
+	m_removedUrls.append(entry.getUrl());
 }
 
 void HistoryManager::handleOptionChanged(int identifier)
@@ -215,32 +241,7 @@ void HistoryManager::handleOptionChanged(int identifier)
 			break;
 		case SettingsManager::History_BrowsingLimitAmountGlobalOption:
 		case SettingsManager::History_BrowsingLimitPeriodOption:
-			if (!m_browsingHistoryModel)
-			{
-				getBrowsingHistoryModel();
-			}
-
-			if (!m_typedHistoryModel)
-			{
-				getTypedHistoryModel();
-			}
-
-			if (identifier == SettingsManager::History_BrowsingLimitAmountGlobalOption)
-			{
-				const int limit(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt());
-
-				m_browsingHistoryModel->clearExcessEntries(limit);
-				m_typedHistoryModel->clearExcessEntries(limit);
-			}
-			else
-			{
-				const int period(SettingsManager::getOption(SettingsManager::History_BrowsingLimitPeriodOption).toInt());
-
-				m_browsingHistoryModel->clearOldestEntries(period);
-				m_typedHistoryModel->clearOldestEntries(period);
-			}
-
-			scheduleSave();
+			expireEntries();
 
 			break;
 		case SettingsManager::History_StoreFaviconsOption:
@@ -252,6 +253,19 @@ void HistoryManager::handleOptionChanged(int identifier)
 	}
 }
 
+void HistoryManager::removeIcons()
+{
+	for (int i = 0; i < m_removedUrls.count(); ++i)
+	{
+		if (!m_browsingHistoryModel->hasEntry(m_removedUrls.at(i)))
+		{
+			FaviconsManager::removeIcon(m_removedUrls.at(i));
+		}
+	}
+
+	m_removedUrls.clear();
+}
+
 HistoryManager* HistoryManager::getInstance()
 {
 	return m_instance;
@@ -264,6 +278,9 @@ HistoryModel* HistoryManager::getBrowsingHistoryModel()
 		m_browsingHistoryModel = new HistoryModel(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.json")), HistoryModel::BrowsingHistory, m_instance);
 
 		connect(m_browsingHistoryModel, &HistoryModel::modelModified, m_instance, &HistoryManager::scheduleSave);
+		connect(m_browsingHistoryModel, &HistoryModel::modelModified, m_instance, &HistoryManager::removeIcons);
+		connect(m_browsingHistoryModel, &HistoryModel::entryRemoved, m_instance, &HistoryManager::handleEntryRemoved);
+		connect(m_browsingHistoryModel, &HistoryModel::cleared, m_instance, &FaviconsManager::clearIcons);
 	}
 
 	return m_browsingHistoryModel;
@@ -281,6 +298,16 @@ HistoryModel* HistoryManager::getTypedHistoryModel()
 	return m_typedHistoryModel;
 }
 
+HistoryModel::UrlStatistics HistoryManager::getUrlStatistics(const QUrl &url)
+{
+	if (!m_browsingHistoryModel)
+	{
+		getBrowsingHistoryModel();
+	}
+
+	return m_browsingHistoryModel->getUrlStatistics(url);
+}
+
 QDateTime HistoryManager::getLastVisitTime(const QUrl &url)
 {
 	if (!m_browsingHistoryModel)
@@ -293,11 +320,9 @@ QDateTime HistoryManager::getLastVisitTime(const QUrl &url)
 
 QIcon HistoryManager::getIcon(const QString &host)
 {
-	Q_UNUSED(host)
-
-///TODO
+	const QIcon icon(FaviconsManager::getIcon(host));
 
-	return ThemesManager::createIcon(QLatin1String("text-html"));
+	return (icon.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : icon);
 }
 
 QIcon HistoryManager::getIcon(const QUrl &url)
@@ -322,12 +347,12 @@ QIcon HistoryManager::getIcon(const QUrl &url)
 		}
 	}
 
-///TODO
+	const QIcon icon(FaviconsManager::getIcon(url));
 
-	return ThemesManager::createIcon(QLatin1String("text-html"));
+	return (icon.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : icon);
 }
 
-HistoryModel::Entry* HistoryManager::getEntry(quint64 identifier)
+HistoryModel::Entry HistoryManager::getEntry(quint64 identifier)
 {
 	if (!m_browsingHistoryModel)
 	{
@@ -371,7 +396,12 @@ quint64 HistoryManager::addEntry(const QUrl &url, const QString &title, const QI
 		getBrowsingHistoryModel();
 	}
 
-	const quint64 identifier(m_browsingHistoryModel->addEntry(url, title, icon, QDateTime::currentDateTimeUtc())->getIdentifier());
+	if (m_isStoringFavicons)
+	{
+		FaviconsManager::setIcon(url, icon);
+	}
+
+	const quint64 identifier(m_browsingHistoryModel->addEntry(url, title, QDateTime::currentDateTimeUtc(), 0, isTypedIn));
 
 	if (isTypedIn)
 	{
@@ -380,18 +410,10 @@ quint64 HistoryManager::addEntry(const QUrl &url, const QString &title, const QI
 			getTypedHistoryModel();
 		}
 
-		m_typedHistoryModel->addEntry(url, title, icon, QDateTime::currentDateTimeUtc());
+		m_typedHistoryModel->addEntry(url, title, QDateTime::currentDateTimeUtc());
 	}
 
-	const int limit(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt());
-
-	if (limit > 0 && m_browsingHistoryModel->rowCount() > limit)
-	{
-		for (int i = (m_browsingHistoryModel->rowCount() - 1); i >= limit; --i)
-		{
-			m_browsingHistoryModel->removeEntry(m_browsingHistoryModel->index(i, 0).data(HistoryModel::IdentifierRole).toULongLong());
-		}
-	}
+	m_browsingHistoryModel->expireEntries(SettingsManager::getOption(SettingsManager::History_BrowsingLimitAmountGlobalOption).toInt(), SettingsManager::getOption(SettingsManager::History_BrowsingLimitPeriodOption).toInt());
 
 	return identifier;
 }
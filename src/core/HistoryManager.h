@@ -38,14 +38,16 @@ public:
 	static void clearHistory(uint period = 0);
 	static void removeEntry(quint64 identifier);
 	static void removeEntries(const QVector<quint64> &identifiers);
+	static void removeDomainEntries(const QString &host);
 	static void updateEntry(quint64 identifier, const QUrl &url, const QString &title = {}, const QIcon &icon = {});
 	static HistoryManager* getInstance();
 	static HistoryModel* getBrowsingHistoryModel();
 	static HistoryModel* getTypedHistoryModel();
+	static HistoryModel::UrlStatistics getUrlStatistics(const QUrl &url);
 	static QDateTime getLastVisitTime(const QUrl &url);
 	static QIcon getIcon(const QString &host);
 	static QIcon getIcon(const QUrl &url);
-	static HistoryModel::Entry* getEntry(quint64 identifier);
+	static HistoryModel::Entry getEntry(quint64 identifier);
 	static QVector<HistoryModel::HistoryEntryMatch> findEntries(const QString &prefix, bool isTypedInOnly = false);
 	static quint64 addEntry(const QUrl &url, const QString &title = {}, const QIcon &icon = {}, bool isTypedIn = false);
 	static bool hasEntry(const QUrl &url);
@@ -56,11 +58,15 @@ protected:
 	void timerEvent(QTimerEvent *event) override;
 	void scheduleSave();
 	void save();
+	void expireEntries();
 
 protected slots:
+	void handleEntryRemoved(const HistoryModel::Entry &entry);
 	void handleOptionChanged(int identifier);
+	void removeIcons();
 
 private:
+	QVector<QUrl> m_removedUrls;
 	int m_dayTimer;
 	int m_saveTimer;
 
@@ -19,395 +19,2433 @@
 **************************************************************************/
 
 #include "HistoryModel.h"
+#include "Application.h"
 #include "Console.h"
+#include "FaviconsManager.h"
 #include "JsonSettings.h"
 #include "SessionsManager.h"
 #include "ThemesManager.h"
 #include "Utils.h"
 
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCore/QCoreApplication>
 #include <QtCore/QFile>
 #include <QtCore/QJsonArray>
-#include <QtCore/QJsonObject>
+#include <QtCore/QSet>
+#include <QtCore/QTimerEvent>
 
-namespace Otter
-{
-
-HistoryModel::Entry::Entry() = default;
-
-void HistoryModel::Entry::setData(const QVariant &value, int role)
-{
-	if (model() && qobject_cast<HistoryModel*>(model()))
-	{
-		model()->setData(index(), value, role);
-	}
-	else
-	{
-		QStandardItem::setData(value, role);
-	}
-}
+#include <algorithm>
 
-void HistoryModel::Entry::setItemData(const QVariant &value, int role)
+namespace Otter
 {
-	QStandardItem::setData(value, role);
-}
 
 QString HistoryModel::Entry::getTitle() const
 {
-	return (data(TitleRole).isNull() ? QCoreApplication::translate("Otter::HistoryEntryItem", "(Untitled)") : data(TitleRole).toString());
+	return (m_title.isEmpty() ? QCoreApplication::translate("Otter::HistoryEntryItem", "(Untitled)") : m_title);
 }
 
 QUrl HistoryModel::Entry::getUrl() const
 {
-	return data(UrlRole).toUrl();
+	return m_url;
 }
 
 QDateTime HistoryModel::Entry::getTimeVisited() const
 {
-	return data(TimeVisitedRole).toDateTime();
+	return m_timeVisited;
 }
 
 QIcon HistoryModel::Entry::getIcon() const
 {
-	const QVariant iconData(data(Qt::DecorationRole));
+	const QIcon icon(FaviconsManager::getIcon(m_url));
 
-	return (iconData.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : iconData.value<QIcon>());
+	return (icon.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : icon);
 }
 
 quint64 HistoryModel::Entry::getIdentifier() const
 {
-	return data(IdentifierRole).toULongLong();
+	return m_identifier;
 }
 
 bool HistoryModel::Entry::isValid() const
 {
-	return (!data(IdentifierRole).isNull() && data(IdentifierRole).toULongLong() != 0);
+	return (m_identifier != 0);
+}
+
+HistoryModel::HistoryModel(const QString &path, HistoryType type, QObject *parent) : QAbstractListModel(parent),
+	m_path(path),
+	m_compactionWatcher(nullptr),
+	m_expiryWatcher(nullptr),
+	m_loadWatcher(nullptr),
+	m_type(type),
+	m_lastIdentifier(0),
+	m_journalSequence(0),
+	m_journalRecordsAmount(0),
+	m_bufferedRecordsAmount(0),
+	m_compactionTimer(0),
+	m_expiryTimer(0),
+	m_expiryIndex(0),
+	m_expiryLimit(0),
+	m_expiryPeriod(-1),
+	m_positionOffset(0),
+	m_rowsAmount(0),
+	m_rankingTime(0),
+	m_hasPrefixIndex(false),
+	m_hasRankedRecords(false),
+	m_hasTokenIndex(false),
+	m_needsExpiry(false),
+	m_isLoading(true)
+{
+	m_loadWatcher = new QFutureWatcher<LoadResult>(this);
+	m_loadWatcher->setFuture(QtConcurrent::run(&HistoryModel::loadSnapshot, path, getJournalPath()));
+
+	connect(m_loadWatcher, &QFutureWatcher<LoadResult>::finished, this, &HistoryModel::finishLoading);
+
+	if (type == TypedHistory)
+	{
+		waitForLoaded();
+	}
 }
 
-HistoryModel::HistoryModel(const QString &path, HistoryType type, QObject *parent) : QStandardItemModel(parent),
-	m_type(type)
+HistoryModel::LoadResult HistoryModel::loadSnapshot(const QString &path, const QString &journalPath)
 {
+	LoadResult result;
+	QVector<SnapshotEntry> entries;
 	QFile file(path);
+	quint64 snapshotSequence(0);
 
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	if (file.open(QIODevice::ReadOnly))
 	{
-		Console::addMessage(tr("Failed to open history file: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, path);
+		file.close();
 
-		return;
-	}
+		const JsonSettings settings(path);
+		const QJsonArray historyArray(settings.array());
+		const QStringList comments(settings.getComment().split(QLatin1Char('\n')));
+
+		for (int i = 0; i < comments.count(); ++i)
+		{
+			if (comments.at(i).section(QLatin1Char(':'), 0, 0).trimmed() == QLatin1String("Journal"))
+			{
+				snapshotSequence = comments.at(i).section(QLatin1Char(':'), 1).trimmed().toULongLong();
+			}
+		}
 
-	const QJsonArray historyArray(QJsonDocument::fromJson(file.readAll()).array());
+		result.journalSequence = snapshotSequence;
 
-	file.close();
+		entries.reserve(historyArray.count());
 
-	for (int i = 0; i < historyArray.count(); ++i)
-	{
-		const QJsonObject entryObject(historyArray.at(i).toObject());
-		QDateTime dateTime(QDateTime::fromString(entryObject.value(QLatin1String("time")).toString(), Qt::ISODate));
-		dateTime.setTimeSpec(Qt::UTC);
+		for (int i = 0; i < historyArray.count(); ++i)
+		{
+			const QJsonObject entryObject(historyArray.at(i).toObject());
+			SnapshotEntry entry;
+			entry.url = entryObject.value(QLatin1String("url")).toString();
+			entry.title = entryObject.value(QLatin1String("title")).toString();
+			entry.timeVisited = readTime(entryObject.value(QLatin1String("time")).toString());
+			entry.identifier = static_cast<quint64>(entryObject.value(QLatin1String("identifier")).toDouble());
+			entry.isTypedIn = entryObject.value(QLatin1String("typed")).toBool();
 
-		addEntry(QUrl(entryObject.value(QLatin1String("url")).toString()), entryObject.value(QLatin1String("title")).toString(), {}, dateTime);
+			result.lastIdentifier = qMax(result.lastIdentifier, entry.identifier);
+
+			entries.append(entry);
+		}
+	}
+	else if (!QFile::exists(journalPath))
+	{
+		result.errorString = file.errorString();
+		result.hasError = true;
 	}
 
-	setSortRole(TimeVisitedRole);
-	sort(0, Qt::DescendingOrder);
-}
+	QHash<quint64, int> positions;
+	positions.reserve(entries.count());
 
-void HistoryModel::clearExcessEntries(int limit)
-{
-	if (limit > 0 && rowCount() > limit)
+	for (int i = 0; i < entries.count(); ++i)
 	{
-		for (int i = (rowCount() - 1); i >= limit; --i)
+		if (entries.at(i).identifier == 0 || positions.contains(entries.at(i).identifier))
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			++result.lastIdentifier;
+
+			entries[i].identifier = result.lastIdentifier;
 		}
+
+		positions[entries.at(i).identifier] = i;
 	}
-}
 
-void HistoryModel::clearRecentEntries(uint period)
-{
-	if (period == 0)
+	QFile journalFile(journalPath);
+
+	if (journalFile.open(QIODevice::ReadOnly))
 	{
-		clear();
+		while (!journalFile.atEnd())
+		{
+			const QJsonObject record(QJsonDocument::fromJson(journalFile.readLine()).object());
+			const QString action(record.value(QLatin1String("action")).toString());
+			const quint64 identifier(static_cast<quint64>(record.value(QLatin1String("identifier")).toDouble()));
+			const quint64 sequence(static_cast<quint64>(record.value(QLatin1String("sequence")).toDouble()));
 
-		m_urls.clear();
-		m_identifiers.clear();
+			if (record.isEmpty())
+			{
+				continue;
+			}
 
-		emit cleared();
+			++result.journalRecordsAmount;
 
-		return;
+			result.journalSequence = qMax(result.journalSequence, sequence);
+
+			if (snapshotSequence > 0 && sequence <= snapshotSequence)
+			{
+				continue;
+			}
+
+			if (action == QLatin1String("clear"))
+			{
+				entries.clear();
+				positions.clear();
+
+				continue;
+			}
+
+			if (action == QLatin1String("remove") && record.contains(QLatin1String("identifiers")))
+			{
+				const QJsonArray identifiers(record.value(QLatin1String("identifiers")).toArray());
+
+				result.journalRecordsAmount += (identifiers.count() - 1);
+
+				for (int i = 0; i < identifiers.count(); ++i)
+				{
+					const quint64 removedIdentifier(static_cast<quint64>(identifiers.at(i).toDouble()));
+
+					if (positions.contains(removedIdentifier))
+					{
+						entries[positions.take(removedIdentifier)].identifier = 0;
+					}
+				}
+
+				continue;
+			}
+
+			if (identifier == 0)
+			{
+				continue;
+			}
+
+			if (action == QLatin1String("add"))
+			{
+				if (!positions.contains(identifier))
+				{
+					SnapshotEntry entry;
+					entry.url = record.value(QLatin1String("url")).toString();
+					entry.title = record.value(QLatin1String("title")).toString();
+					entry.timeVisited = readTime(record.value(QLatin1String("time")).toString());
+					entry.identifier = identifier;
+					entry.isTypedIn = record.value(QLatin1String("typed")).toBool();
+
+					positions[identifier] = entries.count();
+
+					result.lastIdentifier = qMax(result.lastIdentifier, identifier);
+
+					entries.append(entry);
+				}
+			}
+			else if (positions.contains(identifier))
+			{
+				const int position(positions.value(identifier));
+
+				if (action == QLatin1String("remove"))
+				{
+					entries[position].identifier = 0;
+
+					positions.remove(identifier);
+				}
+				else if (action == QLatin1String("update"))
+				{
+					if (record.contains(QLatin1String("url")))
+					{
+						entries[position].url = record.value(QLatin1String("url")).toString();
+					}
+
+					if (record.contains(QLatin1String("title")))
+					{
+						entries[position].title = record.value(QLatin1String("title")).toString();
+					}
+				}
+			}
+		}
+
+		journalFile.close();
 	}
 
-	for (int i = (rowCount() - 1); i >= 0; --i)
+	QVector<SnapshotEntry> visits;
+	visits.reserve(positions.count());
+
+	for (int i = 0; i < entries.count(); ++i)
 	{
-		if (index(i, 0).data(TimeVisitedRole).toDateTime().secsTo(QDateTime::currentDateTimeUtc()) < (period * 3600))
+		if (entries.at(i).identifier > 0)
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			visits.append(entries.at(i));
 		}
 	}
-}
 
-void HistoryModel::clearOldestEntries(int period)
-{
-	if (period < 0)
+	entries.clear();
+
+	std::stable_sort(visits.begin(), visits.end(), [](const SnapshotEntry &first, const SnapshotEntry &second)
 	{
-		return;
-	}
+		return (first.timeVisited < second.timeVisited);
+	});
 
-	const QDateTime currentDateTime(QDateTime::currentDateTimeUtc());
+	result.visitTimes.reserve(visits.count());
+	result.visitIdentifiers.reserve(visits.count());
+	result.visitUrls.reserve(visits.count());
+	result.visitTitles.reserve(visits.count());
+	result.visitTypedFlags.reserve(visits.count());
+	result.identifierPositions.reserve(visits.count());
 
-	for (int i = (rowCount() - 1); i >= 0; --i)
+	for (int i = 0; i < visits.count(); ++i)
 	{
-		if (index(i, 0).data(TimeVisitedRole).toDateTime().daysTo(currentDateTime) > period)
+		const SnapshotEntry &visit(visits.at(i));
+		const QUrl url(visit.url);
+		int urlIndex(result.urlIndexes.value(url, -1));
+
+		if (urlIndex < 0)
+		{
+			UrlRecord record;
+			record.url = url;
+			record.normalizedUrl = Utils::normalizeUrl(url);
+			record.prefixKey = record.normalizedUrl.toString().toLower();
+			record.firstVisitTime = visit.timeVisited;
+			record.firstVisitIdentifier = visit.identifier;
+
+			urlIndex = result.urlRecords.count();
+
+			result.urlRecords.append(record);
+			result.urlIndexes[url] = urlIndex;
+			result.normalizedUrls[record.normalizedUrl].append(urlIndex);
+		}
+
+		UrlRecord &urlRecord(result.urlRecords[urlIndex]);
+		urlRecord.title = visit.title;
+		urlRecord.lastVisitTime = visit.timeVisited;
+		urlRecord.lastVisitIdentifier = visit.identifier;
+
+		++urlRecord.visitsAmount;
+
+		if (visit.isTypedIn)
+		{
+			++urlRecord.typedAmount;
+		}
+
+		int titleIndex(result.titleIndexes.value(visit.title, -1));
+
+		if (titleIndex < 0)
 		{
-			removeEntry(index(i, 0).data(IdentifierRole).toULongLong());
+			TitleRecord record;
+			record.title = visit.title;
+
+			titleIndex = result.titleRecords.count();
+
+			result.titleRecords.append(record);
+			result.titleIndexes[visit.title] = titleIndex;
 		}
+
+		++result.titleRecords[titleIndex].visitsAmount;
+
+		result.visitTimes.append(visit.timeVisited);
+		result.visitIdentifiers.append(visit.identifier);
+		result.visitUrls.append(urlIndex);
+		result.visitTitles.append(titleIndex);
+		result.visitTypedFlags.append(visit.isTypedIn);
+		result.identifierPositions[visit.identifier] = i;
 	}
+
+	result.prefixIndex = createPrefixIndex(result.urlRecords, false);
+	result.schemePrefixIndex = createPrefixIndex(result.urlRecords, true);
+	result.tokenIndex = createTokenIndex(result.urlRecords, result.titleRecords);
+
+	return result;
 }
 
-void HistoryModel::removeEntry(quint64 identifier)
+void HistoryModel::finishLoading()
 {
-	Entry *entry(getEntry(identifier));
-
-	if (!entry)
+	if (!m_loadWatcher)
 	{
 		return;
 	}
 
-	const QUrl url(Utils::normalizeUrl(entry->getUrl()));
-
-	if (m_urls.contains(url))
-	{
-		m_urls[url].removeAll(entry);
+	const LoadResult result(m_loadWatcher->result());
 
-		if (m_urls[url].isEmpty())
-		{
-			m_urls.remove(url);
-		}
-	}
+	m_loadWatcher->disconnect(this);
+	m_loadWatcher->deleteLater();
+	m_loadWatcher = nullptr;
 
-	if (identifier > 0 && m_identifiers.contains(identifier))
+	if (result.hasError)
 	{
-		m_identifiers.remove(identifier);
+		Console::addMessage(tr("Failed to open history file: %1").arg(result.errorString), Console::OtherCategory, Console::ErrorLevel, m_path);
 	}
 
-	emit entryRemoved(entry);
+	m_lastIdentifier = qMax(m_lastIdentifier, result.lastIdentifier);
+	m_journalSequence = qMax(m_journalSequence, result.journalSequence);
+	m_journalRecordsAmount = result.journalRecordsAmount;
+
+	beginResetModel();
+
+	m_visitTimes = result.visitTimes;
+	m_visitIdentifiers = result.visitIdentifiers;
+	m_visitUrls = result.visitUrls;
+	m_visitTitles = result.visitTitles;
+	m_visitTypedFlags = result.visitTypedFlags;
+	m_urlRecords = result.urlRecords;
+	m_titleRecords = result.titleRecords;
+	m_urlIndexes = result.urlIndexes;
+	m_titleIndexes = result.titleIndexes;
+	m_normalizedUrls = result.normalizedUrls;
+	m_identifierPositions = result.identifierPositions;
+	m_prefixIndex = result.prefixIndex;
+	m_schemePrefixIndex = result.schemePrefixIndex;
+	m_tokenIndex = result.tokenIndex;
+	m_rankedRecords.clear();
+	m_recordScores.clear();
+	m_freeUrlRecords.clear();
+	m_freeTitleRecords.clear();
+	m_positionOffset = 0;
+	m_rowsAmount = ((m_type == TypedHistory) ? m_visitTimes.count() : qMin(static_cast<int>(InitialPageSize), m_visitTimes.count()));
+	m_hasPrefixIndex = true;
+	m_hasRankedRecords = false;
+	m_hasTokenIndex = true;
+
+	endResetModel();
+
+	m_isLoading = false;
+
+	emit loaded();
+}
 
-	removeRow(entry->row());
+void HistoryModel::waitForLoaded()
+{
+	if (m_loadWatcher)
+	{
+		m_loadWatcher->waitForFinished();
 
-	emit modelModified();
+		finishLoading();
+	}
 }
 
-HistoryModel::Entry* HistoryModel::addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date, quint64 identifier)
+void HistoryModel::loadAll()
 {
-	blockSignals(true);
+	waitForLoaded();
 
-	if (m_type == TypedHistory && hasEntry(url))
+	if (m_rowsAmount < m_visitTimes.count())
 	{
-		const QVector<Entry*> entries(m_urls[Utils::normalizeUrl(url)]);
+		beginInsertRows({}, m_rowsAmount, (m_visitTimes.count() - 1));
 
-		for (int i = 0; i < entries.count(); ++i)
-		{
-			removeEntry(entries.at(i)->getIdentifier());
-		}
+		m_rowsAmount = m_visitTimes.count();
+
+		endInsertRows();
 	}
+}
 
-	Entry *entry(new Entry());
-	entry->setIcon(icon);
+void HistoryModel::fetchMore(const QModelIndex &parent)
+{
+	if (parent.isValid())
+	{
+		return;
+	}
 
-	const QModelIndex index(entry->index());
+	waitForLoaded();
 
-	insertRow(0, entry);
-	setData(index, url, UrlRole);
-	setData(index, title, TitleRole);
-	setData(index, date, TimeVisitedRole);
+	const int amount(qMin(static_cast<int>(PageSize), (m_visitTimes.count() - m_rowsAmount)));
 
-	if (identifier == 0 || m_identifiers.contains(identifier))
+	if (amount > 0)
 	{
-		identifier = (m_identifiers.isEmpty() ? 1 : (m_identifiers.lastKey() + 1));
+		beginInsertRows({}, m_rowsAmount, (m_rowsAmount + amount - 1));
+
+		m_rowsAmount += amount;
+
+		endInsertRows();
 	}
+}
 
-	setData(index, identifier, IdentifierRole);
+void HistoryModel::save()
+{
+	if (SessionsManager::isReadOnly() || m_loadWatcher)
+	{
+		return;
+	}
 
-	m_identifiers[identifier] = entry;
+	if (m_compactionWatcher)
+	{
+		if (!Application::isAboutToQuit())
+		{
+			return;
+		}
 
-	blockSignals(false);
+		m_compactionWatcher->waitForFinished();
 
-	emit entryAdded(entry);
-	emit modelModified();
+		finishCompaction();
+	}
 
-	return entry;
+	if (!Application::isAboutToQuit() && m_compactionTimer == 0 && (m_journalRecordsAmount + m_bufferedRecordsAmount) > qMax(1000, (m_visitTimes.count() / 2)))
+	{
+		compact();
+	}
+	else
+	{
+		writeJournal();
+	}
 }
 
-HistoryModel::Entry* HistoryModel::getEntry(quint64 identifier) const
+void HistoryModel::appendJournalRecord(const QJsonObject &record, int weight)
 {
-	if (m_identifiers.contains(identifier))
+	if (m_isLoading)
 	{
-		return m_identifiers[identifier];
+		return;
 	}
 
-	return nullptr;
+	QJsonObject sequencedRecord(record);
+	sequencedRecord.insert(QLatin1String("sequence"), static_cast<double>(++m_journalSequence));
+
+	m_journalBuffer.append(QJsonDocument(sequencedRecord).toJson(QJsonDocument::Compact));
+	m_journalBuffer.append('\n');
+
+	m_bufferedRecordsAmount += weight;
 }
 
-QDateTime HistoryModel::getLastVisitTime(const QUrl &url) const
+void HistoryModel::writeJournal()
 {
-	const QUrl normalizedUrl(Utils::normalizeUrl(url));
-
-	if (!m_urls.contains(normalizedUrl))
+	if (m_journalBuffer.isEmpty())
 	{
-		return {};
+		return;
 	}
 
-	const QVector<Entry*> entries(m_urls.value(normalizedUrl));
-	QDateTime lastVisitTime;
+	QFile file(getJournalPath());
 
-	for (int i = 0; i < entries.count(); ++i)
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
 	{
-		const QDateTime entryLastVisitTime(entries.at(i)->getTimeVisited());
+		Console::addMessage(tr("Failed to open history journal: %1").arg(file.errorString()), Console::OtherCategory, Console::ErrorLevel, file.fileName());
 
-		if (!lastVisitTime.isValid() || entryLastVisitTime > lastVisitTime)
-		{
-			lastVisitTime = entryLastVisitTime;
-		}
+		return;
 	}
 
-	return lastVisitTime;
+	file.write(m_journalBuffer);
+	file.close();
+
+	m_journalRecordsAmount += m_bufferedRecordsAmount;
+	m_bufferedRecordsAmount = 0;
+
+	m_journalBuffer.clear();
 }
 
-QVector<HistoryModel::HistoryEntryMatch> HistoryModel::findEntries(const QString &prefix, bool markAsTypedIn) const
+void HistoryModel::compact()
 {
-	QVector<Entry*> matchedEntries;
-	QVector<HistoryEntryMatch> allMatches;
-	QVector<HistoryEntryMatch> currentMatches;
-	QMultiMap<QDateTime, HistoryEntryMatch> matchesMap;
-	QHash<QUrl, QVector<Entry*> >::const_iterator urlsIterator;
+	writeJournal();
 
-	for (urlsIterator = m_urls.constBegin(); urlsIterator != m_urls.constEnd(); ++urlsIterator)
+	QVector<SnapshotEntry> entries;
+	entries.reserve(m_visitTimes.count());
+
+	for (int i = 0; i < m_visitTimes.count(); ++i)
 	{
-		if (urlsIterator.value().isEmpty() || matchedEntries.contains(urlsIterator.value().value(0)))
-		{
-			continue;
-		}
+		SnapshotEntry entry;
+		entry.url = m_urlRecords.at(m_visitUrls.at(i)).url.toString();
+		entry.title = m_titleRecords.at(m_visitTitles.at(i)).title;
+		entry.timeVisited = m_visitTimes.at(i);
+		entry.identifier = m_visitIdentifiers.at(i);
+		entry.isTypedIn = m_visitTypedFlags.at(i);
+
+		entries.append(entry);
+	}
+
+	const QString path(m_path);
+	const QString journalPath(getJournalPath());
+	const quint64 sequence(m_journalSequence);
 
-		const QString result(Utils::matchUrl(urlsIterator.key(), prefix));
+	m_compactionWatcher = new QFutureWatcher<bool>(this);
+	m_compactionWatcher->setFuture(QtConcurrent::run([=]() -> bool
+	{
+		QJsonArray historyArray;
 
-		if (!result.isEmpty())
+		for (int i = 0; i < entries.count(); ++i)
 		{
-			HistoryEntryMatch match;
-			match.entry = urlsIterator.value().value(0);
-			match.match = result;
+			const SnapshotEntry &entry(entries.at(i));
+
+			QJsonObject entryObject({{QLatin1String("url"), entry.url}, {QLatin1String("title"), entry.title}, {QLatin1String("time"), ((entry.timeVisited == 0) ? QString() : QDateTime::fromMSecsSinceEpoch(entry.timeVisited, Qt::UTC).toString(Qt::ISODate))}, {QLatin1String("identifier"), static_cast<double>(entry.identifier)}});
 
-			if (markAsTypedIn)
+			if (entry.isTypedIn)
 			{
-				match.isTypedIn = true;
+				entryObject.insert(QLatin1String("typed"), true);
 			}
 
-			matchesMap.insert(match.entry->data(TimeVisitedRole).toDateTime(), match);
+			historyArray.append(entryObject);
+		}
+
+		JsonSettings settings;
+		settings.setArray(historyArray);
+		settings.setComment(QLatin1String("Journal: ") + QString::number(sequence));
 
-			matchedEntries.append(match.entry);
+		if (!settings.save(path))
+		{
+			return false;
 		}
-	}
 
-	currentMatches = matchesMap.values().toVector();
+		QFile::remove(journalPath);
 
-	matchesMap.clear();
+		return true;
+	}));
 
-	allMatches.reserve(currentMatches.count());
+	connect(m_compactionWatcher, &QFutureWatcher<bool>::finished, this, &HistoryModel::finishCompaction);
+}
 
-	for (int i = (currentMatches.count() - 1); i >= 0; --i)
+void HistoryModel::compactAndWait()
+{
+	if (SessionsManager::isReadOnly() || m_loadWatcher)
 	{
-		allMatches.append(currentMatches.at(i));
+		return;
 	}
 
-	return allMatches;
-}
+	if (m_compactionWatcher)
+	{
+		m_compactionWatcher->waitForFinished();
 
-HistoryModel::HistoryType HistoryModel::getType() const
-{
-	return m_type;
+		finishCompaction();
+	}
+
+	compact();
+
+	m_compactionWatcher->waitForFinished();
+
+	finishCompaction();
 }
 
-bool HistoryModel::save(const QString &path) const
+void HistoryModel::finishCompaction()
 {
-	if (SessionsManager::isReadOnly())
+	if (!m_compactionWatcher)
 	{
-		return false;
+		return;
 	}
 
-	QJsonArray historyArray;
+	if (m_compactionWatcher->result())
+	{
+		m_journalRecordsAmount = 0;
+
+		if (m_compactionTimer != 0)
+		{
+			killTimer(m_compactionTimer);
 
-	for (int i = 0; i < rowCount(); ++i)
+			m_compactionTimer = 0;
+		}
+	}
+	else
 	{
-		const QModelIndex index(this->index(i, 0));
+		Console::addMessage(tr("Failed to save history snapshot"), Console::OtherCategory, Console::ErrorLevel, m_path);
 
-		if (index.isValid())
+		if (m_compactionTimer == 0)
 		{
-			historyArray.prepend({{{QLatin1String("url"), index.data(UrlRole).toUrl().toString()}, {QLatin1String("title"), index.data(TitleRole).toString()}, {QLatin1String("time"), index.data(TimeVisitedRole).toDateTime().toString(Qt::ISODate)}}});
+			m_compactionTimer = startTimer(CompactionRetryInterval);
 		}
 	}
 
-	JsonSettings settings;
-	settings.setArray(historyArray);
+	m_compactionWatcher->disconnect(this);
+	m_compactionWatcher->deleteLater();
+	m_compactionWatcher = nullptr;
+
+	writeJournal();
+}
+
+void HistoryModel::clearRecentEntries(uint period)
+{
+	waitForLoaded();
+
+	if (period == 0)
+	{
+		beginResetModel();
+
+		m_visitTimes.clear();
+		m_visitIdentifiers.clear();
+		m_visitUrls.clear();
+		m_visitTitles.clear();
+		m_visitTypedFlags.clear();
+		m_urlRecords.clear();
+		m_titleRecords.clear();
+		m_freeUrlRecords.clear();
+		m_freeTitleRecords.clear();
+		m_urlIndexes.clear();
+		m_titleIndexes.clear();
+		m_normalizedUrls.clear();
+		m_identifierPositions.clear();
+		m_expiredIdentifiers.clear();
+		m_prefixIndex.clear();
+		m_schemePrefixIndex.clear();
+		m_rankedRecords.clear();
+		m_recordScores.clear();
+		m_tokenIndex.clear();
+
+		m_expiryIndex = 0;
+		m_positionOffset = 0;
+		m_rowsAmount = 0;
+		m_hasRankedRecords = false;
+
+		endResetModel();
+
+		appendJournalRecord(QJsonObject({{QLatin1String("action"), QLatin1String("clear")}}));
+		compactAndWait();
+
+		emit cleared();
+		emit modelModified();
+
+		return;
+	}
+
+	const qint64 threshold(QDateTime::currentMSecsSinceEpoch() - (static_cast<qint64>(period) * 3600000));
+	const int position(static_cast<int>(std::upper_bound(m_visitTimes.constBegin(), m_visitTimes.constEnd(), threshold) - m_visitTimes.constBegin()));
 
-	return settings.save(path);
+	if (position < m_visitTimes.count())
+	{
+		removeVisits(position, (m_visitTimes.count() - position));
+		compactAndWait();
+	}
 }
 
-bool HistoryModel::setData(const QModelIndex &index, const QVariant &value, int role)
+void HistoryModel::timerEvent(QTimerEvent *event)
 {
-	Entry *entry(static_cast<Entry*>(itemFromIndex(index)));
+	if (event->timerId() == m_compactionTimer)
+	{
+		killTimer(m_compactionTimer);
+
+		m_compactionTimer = 0;
+
+		save();
+
+		return;
+	}
 
-	if (!entry)
+	if (event->timerId() != m_expiryTimer)
 	{
-		return QStandardItemModel::setData(index, value, role);
+		return;
 	}
 
-	if (role == UrlRole && value.toUrl() != index.data(UrlRole).toUrl())
+	int amount(0);
+
+	while (m_expiryIndex < m_expiredIdentifiers.count() && amount < ExpiryBatchSize)
 	{
-		const QUrl oldUrl(Utils::normalizeUrl(index.data(UrlRole).toUrl()));
-		const QUrl newUrl(Utils::normalizeUrl(value.toUrl()));
+		const int position(getVisitPosition(m_expiredIdentifiers.at(m_expiryIndex)));
 
-		if (!oldUrl.isEmpty() && m_urls.contains(oldUrl))
+		if (position >= 0 && position != amount)
 		{
-			m_urls[oldUrl].removeAll(entry);
-
-			if (m_urls[oldUrl].isEmpty())
-			{
-				m_urls.remove(oldUrl);
-			}
+			break;
 		}
 
-		if (!newUrl.isEmpty())
+		if (position == amount)
 		{
-			if (!m_urls.contains(newUrl))
-			{
-				m_urls[newUrl] = {};
-			}
-
-			m_urls[newUrl].append(entry);
+			++amount;
 		}
+
+		++m_expiryIndex;
 	}
 
-	entry->setItemData(value, role);
+	removeVisits(0, amount);
 
-	switch (role)
+	if (amount == 0 && m_expiryIndex < m_expiredIdentifiers.count())
 	{
-		case TitleRole:
-		case UrlRole:
-		case IdentifierRole:
-		case TimeVisitedRole:
-			emit entryModified(entry);
-			emit modelModified();
+		const int position(getVisitPosition(m_expiredIdentifiers.at(m_expiryIndex)));
 
-			break;
-		default:
-			break;
+		if (position >= 0)
+		{
+			removeVisits(position, 1);
+		}
+
+		++m_expiryIndex;
+	}
+
+	if (m_expiryIndex < m_expiredIdentifiers.count())
+	{
+		return;
 	}
 
-	return true;
+	killTimer(m_expiryTimer);
+
+	m_expiryTimer = 0;
+	m_expiryIndex = 0;
+
+	m_expiredIdentifiers.clear();
+
+	if (m_needsExpiry)
+	{
+		m_needsExpiry = false;
+
+		expireEntries(m_expiryLimit, m_expiryPeriod);
+	}
 }
 
-bool HistoryModel::hasEntry(const QUrl &url) const
+void HistoryModel::expireEntries(int limit, int period)
 {
-	return m_urls.contains(Utils::normalizeUrl(url));
+	m_expiryLimit = limit;
+	m_expiryPeriod = period;
+
+	if (m_expiryWatcher || m_expiryTimer != 0)
+	{
+		m_needsExpiry = true;
+
+		return;
+	}
+
+	waitForLoaded();
+
+	const qint64 currentTime(QDateTime::currentMSecsSinceEpoch());
+
+	if (m_visitTimes.isEmpty() || ((limit <= 0 || m_visitTimes.count() <= limit) && !isExpired(m_visitTimes.first(), period, currentTime)))
+	{
+		return;
+	}
+
+	const QVector<qint64> times(m_visitTimes);
+	const QVector<quint64> identifiers(m_visitIdentifiers);
+
+	m_expiryWatcher = new QFutureWatcher<QVector<quint64> >(this);
+	m_expiryWatcher->setFuture(QtConcurrent::run([=]() -> QVector<quint64>
+	{
+		int amount((limit > 0 && times.count() > limit) ? (times.count() - limit) : 0);
+
+		while (amount < times.count() && isExpired(times.at(amount), period, currentTime))
+		{
+			++amount;
+		}
+
+		return identifiers.mid(0, amount);
+	}));
+
+	connect(m_expiryWatcher, &QFutureWatcher<QVector<quint64> >::finished, this, &HistoryModel::finishExpiry);
+}
+
+void HistoryModel::finishExpiry()
+{
+	if (!m_expiryWatcher)
+	{
+		return;
+	}
+
+	m_expiredIdentifiers = m_expiryWatcher->result();
+	m_expiryIndex = 0;
+
+	m_expiryWatcher->disconnect(this);
+	m_expiryWatcher->deleteLater();
+	m_expiryWatcher = nullptr;
+
+	if (!m_expiredIdentifiers.isEmpty())
+	{
+		m_expiryTimer = startTimer(0);
+	}
+	else if (m_needsExpiry)
+	{
+		m_needsExpiry = false;
+
+		expireEntries(m_expiryLimit, m_expiryPeriod);
+	}
+}
+
+void HistoryModel::removeEntry(quint64 identifier)
+{
+	waitForLoaded();
+
+	const int position(getVisitPosition(identifier));
+
+	if (position >= 0)
+	{
+		removeVisits(position, 1);
+	}
+}
+
+void HistoryModel::removeEntries(const QVector<quint64> &identifiers)
+{
+	waitForLoaded();
+
+	QVector<int> positions;
+	positions.reserve(identifiers.count());
+
+	for (int i = 0; i < identifiers.count(); ++i)
+	{
+		const int position(getVisitPosition(identifiers.at(i)));
+
+		if (position >= 0)
+		{
+			positions.append(position);
+		}
+	}
+
+	std::sort(positions.begin(), positions.end());
+
+	positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+	if (!positions.isEmpty())
+	{
+		removeVisits(positions);
+		compactAndWait();
+	}
+}
+
+void HistoryModel::removeDomainEntries(const QString &host)
+{
+	waitForLoaded();
+
+	QVector<bool> matchingRecords(m_urlRecords.count(), false);
+	bool hasMatches(false);
+
+	for (int i = 0; i < m_urlRecords.count(); ++i)
+	{
+		if (m_urlRecords.at(i).visitsAmount > 0 && m_urlRecords.at(i).url.host() == host)
+		{
+			matchingRecords[i] = true;
+
+			hasMatches = true;
+		}
+	}
+
+	if (!hasMatches)
+	{
+		return;
+	}
+
+	QVector<int> positions;
+
+	for (int i = 0; i < m_visitUrls.count(); ++i)
+	{
+		if (matchingRecords.at(m_visitUrls.at(i)))
+		{
+			positions.append(i);
+		}
+	}
+
+	removeVisits(positions);
+	compactAndWait();
+}
+
+void HistoryModel::removeVisits(int position, int amount)
+{
+	if (amount <= 0)
+	{
+		return;
+	}
+
+	QVector<int> positions;
+	positions.reserve(amount);
+
+	for (int i = position; i < (position + amount); ++i)
+	{
+		positions.append(i);
+	}
+
+	removeVisits(positions);
+}
+
+void HistoryModel::removeVisits(const QVector<int> &positions)
+{
+	if (positions.isEmpty())
+	{
+		return;
+	}
+
+	const int amount(positions.count());
+	QJsonArray identifiers;
+
+	for (int i = 0; i < amount; ++i)
+	{
+		const Entry entry(createEntry(positions.at(i)));
+
+		m_identifierPositions.remove(entry.m_identifier);
+
+		identifiers.append(static_cast<double>(entry.m_identifier));
+
+		if (!m_isLoading)
+		{
+			emit entryRemoved(entry);
+		}
+	}
+
+	if (amount == 1)
+	{
+		appendJournalRecord({{QLatin1String("action"), QLatin1String("remove")}, {QLatin1String("identifier"), identifiers.at(0)}});
+	}
+	else
+	{
+		appendJournalRecord({{QLatin1String("action"), QLatin1String("remove")}, {QLatin1String("identifiers"), identifiers}}, amount);
+	}
+
+	const int position(positions.first());
+	const bool isContiguous((positions.last() - position + 1) == amount);
+	const int visibleAmount(static_cast<int>(positions.constEnd() - std::lower_bound(positions.constBegin(), positions.constEnd(), (m_visitTimes.count() - m_rowsAmount))));
+	QVector<int> records;
+
+	if (visibleAmount > 0)
+	{
+		if (isContiguous)
+		{
+			const int firstRow(m_visitTimes.count() - position - amount);
+
+			beginRemoveRows({}, firstRow, (firstRow + visibleAmount - 1));
+		}
+		else
+		{
+			beginResetModel();
+		}
+	}
+
+	if (amount > IndexRebuildThreshold)
+	{
+		m_prefixIndex.clear();
+		m_schemePrefixIndex.clear();
+		m_tokenIndex.clear();
+
+		m_hasPrefixIndex = false;
+		m_hasTokenIndex = false;
+	}
+
+	for (int i = 0; i < amount; ++i)
+	{
+		const int visit(positions.at(i));
+		const int record(m_visitUrls.at(visit));
+		UrlRecord &urlRecord(m_urlRecords[record]);
+
+		if (m_visitTypedFlags.at(visit))
+		{
+			--urlRecord.typedAmount;
+		}
+
+		if ((urlRecord.firstVisitIdentifier == m_visitIdentifiers.at(visit) || urlRecord.lastVisitIdentifier == m_visitIdentifiers.at(visit)) && urlRecord.visitsAmount > 1)
+		{
+			records.append(record);
+		}
+
+		releaseUrl(record);
+		releaseTitle(m_visitTitles.at(visit));
+	}
+
+	if (isContiguous)
+	{
+		m_visitTimes.remove(position, amount);
+		m_visitIdentifiers.remove(position, amount);
+		m_visitUrls.remove(position, amount);
+		m_visitTitles.remove(position, amount);
+		m_visitTypedFlags.remove(position, amount);
+	}
+	else
+	{
+		int target(position);
+		int removedAmount(0);
+
+		for (int i = position; i < m_visitTimes.count(); ++i)
+		{
+			if (removedAmount < amount && positions.at(removedAmount) == i)
+			{
+				++removedAmount;
+
+				continue;
+			}
+
+			m_visitTimes[target] = m_visitTimes.at(i);
+			m_visitIdentifiers[target] = m_visitIdentifiers.at(i);
+			m_visitUrls[target] = m_visitUrls.at(i);
+			m_visitTitles[target] = m_visitTitles.at(i);
+			m_visitTypedFlags[target] = m_visitTypedFlags.at(i);
+
+			++target;
+		}
+
+		m_visitTimes.resize(target);
+		m_visitIdentifiers.resize(target);
+		m_visitUrls.resize(target);
+		m_visitTitles.resize(target);
+		m_visitTypedFlags.resize(target);
+	}
+
+	if (isContiguous && position == 0)
+	{
+		m_positionOffset += amount;
+	}
+	else
+	{
+		updateIdentifierPositions(position);
+	}
+
+	updateVisitBounds(records);
+
+	if (visibleAmount > 0)
+	{
+		m_rowsAmount -= visibleAmount;
+
+		if (isContiguous)
+		{
+			endRemoveRows();
+		}
+		else
+		{
+			endResetModel();
+		}
+	}
+
+	emit modelModified();
+}
+
+void HistoryModel::releaseUrl(int index)
+{
+	UrlRecord &record(m_urlRecords[index]);
+
+	--record.visitsAmount;
+
+	if (record.visitsAmount > 0)
+	{
+		return;
+	}
+
+	m_urlIndexes.remove(record.url);
+
+	if (m_hasPrefixIndex)
+	{
+		removeFromPrefixIndex(index);
+	}
+
+	if (m_hasTokenIndex)
+	{
+		removeFromTokenIndex(record.url.toDisplayString(), index, UrlPostings);
+		removeFromTokenIndex(record.title, index, UrlTitlePostings);
+	}
+
+	if (m_normalizedUrls.contains(record.normalizedUrl))
+	{
+		m_normalizedUrls[record.normalizedUrl].removeAll(index);
+
+		if (m_normalizedUrls[record.normalizedUrl].isEmpty())
+		{
+			m_normalizedUrls.remove(record.normalizedUrl);
+		}
+	}
+
+	record = UrlRecord();
+
+	m_freeUrlRecords.append(index);
+}
+
+void HistoryModel::releaseTitle(int index)
+{
+	TitleRecord &record(m_titleRecords[index]);
+
+	--record.visitsAmount;
+
+	if (record.visitsAmount > 0)
+	{
+		return;
+	}
+
+	m_titleIndexes.remove(record.title);
+
+	if (m_hasTokenIndex)
+	{
+		removeFromTokenIndex(record.title, index, TitlePostings);
+	}
+
+	record = TitleRecord();
+
+	m_freeTitleRecords.append(index);
+}
+
+void HistoryModel::updateIdentifierPositions(int position)
+{
+	for (int i = position; i < m_visitIdentifiers.count(); ++i)
+	{
+		m_identifierPositions[m_visitIdentifiers.at(i)] = (i + m_positionOffset);
+	}
+}
+
+void HistoryModel::updateVisitBounds(const QVector<int> &records)
+{
+	if (records.isEmpty())
+	{
+		return;
+	}
+
+	QVector<bool> pendingRecords(m_urlRecords.count(), false);
+	int pendingAmount(0);
+
+	for (int i = 0; i < records.count(); ++i)
+	{
+		if (!pendingRecords.at(records.at(i)))
+		{
+			pendingRecords[records.at(i)] = true;
+
+			++pendingAmount;
+		}
+	}
+
+	QVector<bool> firstVisitRecords(pendingRecords);
+	int remainingAmount(pendingAmount);
+
+	for (int i = 0; i < m_visitUrls.count() && remainingAmount > 0; ++i)
+	{
+		const int record(m_visitUrls.at(i));
+
+		if (firstVisitRecords.at(record))
+		{
+			UrlRecord &urlRecord(m_urlRecords[record]);
+			urlRecord.firstVisitTime = m_visitTimes.at(i);
+			urlRecord.firstVisitIdentifier = m_visitIdentifiers.at(i);
+
+			firstVisitRecords[record] = false;
+
+			--remainingAmount;
+		}
+	}
+
+	remainingAmount = pendingAmount;
+
+	for (int i = (m_visitUrls.count() - 1); i >= 0 && remainingAmount > 0; --i)
+	{
+		const int record(m_visitUrls.at(i));
+
+		if (pendingRecords.at(record))
+		{
+			updateLastVisit(record, i);
+
+			pendingRecords[record] = false;
+
+			--remainingAmount;
+		}
+	}
+}
+
+void HistoryModel::registerVisit(int position)
+{
+	UrlRecord &record(m_urlRecords[m_visitUrls.at(position)]);
+	const qint64 time(m_visitTimes.at(position));
+
+	if (m_visitTypedFlags.at(position))
+	{
+		++record.typedAmount;
+	}
+
+	if (record.firstVisitIdentifier == 0 || time < record.firstVisitTime)
+	{
+		record.firstVisitTime = time;
+		record.firstVisitIdentifier = m_visitIdentifiers.at(position);
+	}
+
+	if (record.lastVisitIdentifier == 0 || time >= record.lastVisitTime)
+	{
+		updateLastVisit(m_visitUrls.at(position), position);
+	}
+
+	updateRankedRecord(m_visitUrls.at(position));
+}
+
+void HistoryModel::updateLastVisit(int record, int position)
+{
+	const QString title(m_titleRecords.at(m_visitTitles.at(position)).title);
+	UrlRecord &urlRecord(m_urlRecords[record]);
+	urlRecord.lastVisitTime = m_visitTimes.at(position);
+	urlRecord.lastVisitIdentifier = m_visitIdentifiers.at(position);
+
+	if (urlRecord.title == title)
+	{
+		return;
+	}
+
+	if (m_hasTokenIndex)
+	{
+		removeFromTokenIndex(urlRecord.title, record, UrlTitlePostings);
+		addToTokenIndex(title, record, UrlTitlePostings);
+	}
+
+	urlRecord.title = title;
+}
+
+void HistoryModel::updateRankedRecord(int record)
+{
+	if (!m_hasRankedRecords)
+	{
+		return;
+	}
+
+	if (record >= m_recordScores.count())
+	{
+		m_recordScores.resize(m_urlRecords.count());
+	}
+
+	RankedRecord entry;
+	entry.score = m_recordScores.at(record);
+	entry.record = record;
+
+	const QVector<RankedRecord>::iterator iterator(std::lower_bound(m_rankedRecords.begin(), m_rankedRecords.end(), entry, compareRankedRecords));
+
+	if (iterator != m_rankedRecords.end() && iterator->record == record)
+	{
+		m_rankedRecords.erase(iterator);
+	}
+
+	entry.score = calculateFrecency(m_urlRecords.at(record), QDateTime::currentMSecsSinceEpoch());
+
+	m_recordScores[record] = entry.score;
+
+	m_rankedRecords.insert(std::lower_bound(m_rankedRecords.begin(), m_rankedRecords.end(), entry, compareRankedRecords), entry);
+}
+
+void HistoryModel::addToPrefixIndex(int record) const
+{
+	const QStringList keys(getPrefixKeys(m_urlRecords.at(record)));
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		PrefixIndexEntry entry;
+		entry.key = keys.at(i);
+		entry.record = record;
+
+		m_prefixIndex.insert(std::lower_bound(m_prefixIndex.begin(), m_prefixIndex.end(), entry, comparePrefixIndexEntries), entry);
+	}
+
+	PrefixIndexEntry entry;
+	entry.key = m_urlRecords.at(record).prefixKey;
+	entry.record = record;
+
+	m_schemePrefixIndex.insert(std::lower_bound(m_schemePrefixIndex.begin(), m_schemePrefixIndex.end(), entry, comparePrefixIndexEntries), entry);
+}
+
+void HistoryModel::removeFromPrefixIndex(int record) const
+{
+	const auto removeEntry([&](QVector<PrefixIndexEntry> &index, const QString &key)
+	{
+		PrefixIndexEntry entry;
+		entry.key = key;
+		entry.record = record;
+
+		const QVector<PrefixIndexEntry>::iterator iterator(std::lower_bound(index.begin(), index.end(), entry, comparePrefixIndexEntries));
+
+		if (iterator != index.end() && iterator->record == record && iterator->key == entry.key)
+		{
+			index.erase(iterator);
+		}
+	});
+	const QStringList keys(getPrefixKeys(m_urlRecords.at(record)));
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		removeEntry(m_prefixIndex, keys.at(i));
+	}
+
+	removeEntry(m_schemePrefixIndex, m_urlRecords.at(record).prefixKey);
+}
+
+void HistoryModel::updateEntry(quint64 identifier, const QUrl &url, const QString &title)
+{
+	waitForLoaded();
+
+	const int position(getVisitPosition(identifier));
+
+	if (position < 0)
+	{
+		return;
+	}
+
+	const int urlIndex(internUrl(url));
+	const int titleIndex(internTitle(title));
+	const int previousUrlIndex(m_visitUrls.at(position));
+	const bool isModified(urlIndex != previousUrlIndex || titleIndex != m_visitTitles.at(position));
+	const UrlRecord &previousUrlRecord(m_urlRecords.at(previousUrlIndex));
+	const bool needsBoundsUpdate(urlIndex != previousUrlIndex && (previousUrlRecord.firstVisitIdentifier == identifier || previousUrlRecord.lastVisitIdentifier == identifier) && previousUrlRecord.visitsAmount > 1);
+
+	if (urlIndex != previousUrlIndex && m_visitTypedFlags.at(position))
+	{
+		--m_urlRecords[previousUrlIndex].typedAmount;
+	}
+
+	releaseUrl(previousUrlIndex);
+	releaseTitle(m_visitTitles.at(position));
+
+	m_visitUrls[position] = urlIndex;
+	m_visitTitles[position] = titleIndex;
+
+	if (needsBoundsUpdate)
+	{
+		updateVisitBounds({previousUrlIndex});
+	}
+
+	if (urlIndex != previousUrlIndex)
+	{
+		registerVisit(position);
+	}
+	else if (m_urlRecords.at(urlIndex).lastVisitIdentifier == identifier)
+	{
+		updateLastVisit(urlIndex, position);
+	}
+
+	if (isModified)
+	{
+		appendJournalRecord({{QLatin1String("action"), QLatin1String("update")}, {QLatin1String("identifier"), static_cast<double>(identifier)}, {QLatin1String("url"), url.toString()}, {QLatin1String("title"), title}});
+	}
+
+	const int row(m_visitTimes.count() - position - 1);
+
+	if (row < m_rowsAmount)
+	{
+		const QModelIndex index(this->index(row));
+
+		emit dataChanged(index, index);
+	}
+
+	if (!m_isLoading)
+	{
+		emit entryModified(createEntry(position));
+	}
+
+	if (isModified)
+	{
+		emit modelModified();
+	}
+}
+
+quint64 HistoryModel::addEntry(const QUrl &url, const QString &title, const QDateTime &date, quint64 identifier, bool isTypedIn)
+{
+	waitForLoaded();
+
+	if (m_type == TypedHistory && hasEntry(url))
+	{
+		const QVector<int> urls(m_normalizedUrls.value(Utils::normalizeUrl(url)));
+
+		for (int i = (m_visitUrls.count() - 1); i >= 0; --i)
+		{
+			if (urls.contains(m_visitUrls.at(i)))
+			{
+				removeVisits(i, 1);
+			}
+		}
+	}
+
+	if (identifier == 0 || m_identifierPositions.contains(identifier))
+	{
+		identifier = (m_lastIdentifier + 1);
+	}
+
+	m_lastIdentifier = qMax(m_lastIdentifier, identifier);
+
+	const qint64 time(date.isValid() ? date.toMSecsSinceEpoch() : 0);
+	const int position(static_cast<int>(std::upper_bound(m_visitTimes.constBegin(), m_visitTimes.constEnd(), time) - m_visitTimes.constBegin()));
+	const int row(m_visitTimes.count() - position);
+	const bool isVisible(row < m_rowsAmount || m_rowsAmount == m_visitTimes.count());
+
+	if (isVisible)
+	{
+		beginInsertRows({}, row, row);
+	}
+
+	m_visitTimes.insert(position, time);
+	m_visitIdentifiers.insert(position, identifier);
+	m_visitUrls.insert(position, internUrl(url));
+	m_visitTitles.insert(position, internTitle(title));
+	m_visitTypedFlags.insert(position, isTypedIn);
+
+	registerVisit(position);
+	updateIdentifierPositions(position);
+
+	if (isVisible)
+	{
+		++m_rowsAmount;
+
+		endInsertRows();
+	}
+
+	QJsonObject record({{QLatin1String("action"), QLatin1String("add")}, {QLatin1String("identifier"), static_cast<double>(identifier)}, {QLatin1String("url"), url.toString()}, {QLatin1String("title"), title}, {QLatin1String("time"), date.toString(Qt::ISODate)}});
+
+	if (isTypedIn)
+	{
+		record.insert(QLatin1String("typed"), true);
+	}
+
+	appendJournalRecord(record);
+
+	if (!m_isLoading)
+	{
+		emit entryAdded(createEntry(position));
+		emit modelModified();
+	}
+
+	return identifier;
+}
+
+HistoryModel::Entry HistoryModel::getEntry(quint64 identifier) const
+{
+	const int position(getVisitPosition(identifier));
+
+	return ((position < 0) ? Entry() : createEntry(position));
+}
+
+HistoryModel::Entry HistoryModel::createEntry(int position) const
+{
+	const UrlRecord &urlRecord(m_urlRecords.at(m_visitUrls.at(position)));
+	Entry entry;
+	entry.m_title = m_titleRecords.at(m_visitTitles.at(position)).title;
+	entry.m_url = urlRecord.url;
+	entry.m_identifier = m_visitIdentifiers.at(position);
+
+	if (m_visitTimes.at(position) != 0)
+	{
+		entry.m_timeVisited = QDateTime::fromMSecsSinceEpoch(m_visitTimes.at(position), Qt::UTC);
+	}
+
+	return entry;
+}
+
+HistoryModel::UrlStatistics HistoryModel::getUrlStatistics(const QUrl &url) const
+{
+	const QVector<int> urls(m_normalizedUrls.value(Utils::normalizeUrl(url)));
+	UrlStatistics statistics;
+	qint64 firstVisitTime(0);
+	qint64 lastVisitTime(0);
+	quint64 lastVisitIdentifier(0);
+
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		const UrlRecord &record(m_urlRecords.at(urls.at(i)));
+
+		if (i == 0 || record.firstVisitTime < firstVisitTime)
+		{
+			firstVisitTime = record.firstVisitTime;
+		}
+
+		if (i == 0 || record.lastVisitTime > lastVisitTime)
+		{
+			lastVisitTime = record.lastVisitTime;
+			lastVisitIdentifier = record.lastVisitIdentifier;
+		}
+
+		statistics.visitsAmount += record.visitsAmount;
+		statistics.typedAmount += record.typedAmount;
+	}
+
+	if (statistics.visitsAmount == 0)
+	{
+		return statistics;
+	}
+
+	const int position(getVisitPosition(lastVisitIdentifier));
+
+	if (position >= 0)
+	{
+		statistics.lastTitle = m_titleRecords.at(m_visitTitles.at(position)).title;
+	}
+
+	if (firstVisitTime != 0)
+	{
+		statistics.firstVisitTime = QDateTime::fromMSecsSinceEpoch(firstVisitTime, Qt::UTC);
+	}
+
+	if (lastVisitTime != 0)
+	{
+		statistics.lastVisitTime = QDateTime::fromMSecsSinceEpoch(lastVisitTime, Qt::UTC);
+	}
+
+	return statistics;
+}
+
+QDateTime HistoryModel::getLastVisitTime(const QUrl &url) const
+{
+	return getUrlStatistics(url).lastVisitTime;
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid() || index.row() >= m_rowsAmount)
+	{
+		return {};
+	}
+
+	const int position(getPosition(index.row()));
+
+	switch (role)
+	{
+		case TitleRole:
+			return m_titleRecords.at(m_visitTitles.at(position)).title;
+		case UrlRole:
+			return m_urlRecords.at(m_visitUrls.at(position)).url;
+		case IdentifierRole:
+			return m_visitIdentifiers.at(position);
+		case TimeVisitedRole:
+			return ((m_visitTimes.at(position) == 0) ? QDateTime() : QDateTime::fromMSecsSinceEpoch(m_visitTimes.at(position), Qt::UTC));
+		case Qt::DecorationRole:
+			{
+				const QIcon icon(FaviconsManager::getIcon(m_urlRecords.at(m_visitUrls.at(position)).url));
+
+				return (icon.isNull() ? ThemesManager::createIcon(QLatin1String("text-html")) : icon);
+			}
+		default:
+			break;
+	}
+
+	return {};
+}
+
+void HistoryModel::addToTokenIndex(const QString &text, int record, PostingsType type) const
+{
+	const QStringList tokens(getTokens(text));
+
+	for (int i = 0; i < tokens.count(); ++i)
+	{
+		TokenPostings &postings(m_tokenIndex[tokens.at(i)]);
+		QVector<int> &records((type == TitlePostings) ? postings.titleRecords : ((type == UrlTitlePostings) ? postings.urlTitleRecords : postings.urlRecords));
+		const QVector<int>::iterator iterator(std::lower_bound(records.begin(), records.end(), record));
+
+		if (iterator == records.end() || *iterator != record)
+		{
+			records.insert(iterator, record);
+		}
+	}
+}
+
+void HistoryModel::removeFromTokenIndex(const QString &text, int record, PostingsType type) const
+{
+	const QStringList tokens(getTokens(text));
+
+	for (int i = 0; i < tokens.count(); ++i)
+	{
+		QMap<QString, TokenPostings>::iterator postingsIterator(m_tokenIndex.find(tokens.at(i)));
+
+		if (postingsIterator == m_tokenIndex.end())
+		{
+			continue;
+		}
+
+		QVector<int> &records((type == TitlePostings) ? postingsIterator->titleRecords : ((type == UrlTitlePostings) ? postingsIterator->urlTitleRecords : postingsIterator->urlRecords));
+		const QVector<int>::iterator iterator(std::lower_bound(records.begin(), records.end(), record));
+
+		if (iterator != records.end() && *iterator == record)
+		{
+			records.erase(iterator);
+		}
+
+		if (postingsIterator->urlRecords.isEmpty() && postingsIterator->titleRecords.isEmpty() && postingsIterator->urlTitleRecords.isEmpty())
+		{
+			m_tokenIndex.erase(postingsIterator);
+		}
+	}
+}
+
+void HistoryModel::ensureTokenIndex() const
+{
+	if (!m_hasTokenIndex)
+	{
+		m_tokenIndex = createTokenIndex(m_urlRecords, m_titleRecords);
+		m_hasTokenIndex = true;
+	}
+}
+
+void HistoryModel::ensureRankedRecords(qint64 currentTime) const
+{
+	if (m_hasRankedRecords && (currentTime - m_rankingTime) < RankingRefreshInterval)
+	{
+		return;
+	}
+
+	m_rankedRecords.clear();
+	m_rankedRecords.reserve(m_urlRecords.count());
+	m_recordScores.fill(0, m_urlRecords.count());
+
+	for (int i = 0; i < m_urlRecords.count(); ++i)
+	{
+		if (m_urlRecords.at(i).visitsAmount > 0)
+		{
+			RankedRecord entry;
+			entry.score = calculateFrecency(m_urlRecords.at(i), currentTime);
+			entry.record = i;
+
+			m_recordScores[i] = entry.score;
+
+			m_rankedRecords.append(entry);
+		}
+	}
+
+	std::sort(m_rankedRecords.begin(), m_rankedRecords.end(), compareRankedRecords);
+
+	m_rankingTime = currentTime;
+	m_hasRankedRecords = true;
+}
+
+QVector<HistoryModel::HistoryEntryMatch> HistoryModel::findEntries(const QString &prefix, bool markAsTypedIn, int limit) const
+{
+	QVector<MatchCandidate> candidates;
+	QVector<HistoryEntryMatch> matches;
+	QSet<QUrl> matchedUrls;
+	const QString key(prefix.toLower());
+	const qint64 currentTime(QDateTime::currentMSecsSinceEpoch());
+	const bool canMatchScheme(key.contains(QLatin1Char(':')));
+	const auto appendMatches([&]()
+	{
+		int sortedAmount((limit > 0) ? qMin(((limit - matches.count()) * 2), candidates.count()) : candidates.count());
+
+		std::partial_sort(candidates.begin(), (candidates.begin() + sortedAmount), candidates.end(), compareMatchCandidates);
+
+		for (int i = 0; i < candidates.count(); ++i)
+		{
+			if (limit > 0 && matches.count() >= limit)
+			{
+				break;
+			}
+
+			if (i == sortedAmount)
+			{
+				std::sort((candidates.begin() + sortedAmount), candidates.end(), compareMatchCandidates);
+
+				sortedAmount = candidates.count();
+			}
+
+			const UrlRecord &record(m_urlRecords.at(candidates.at(i).record));
+			const int position(getVisitPosition(record.lastVisitIdentifier));
+
+			if (position < 0 || matchedUrls.contains(record.normalizedUrl))
+			{
+				continue;
+			}
+
+			matchedUrls.insert(record.normalizedUrl);
+
+			HistoryEntryMatch match;
+			match.entry = createEntry(position);
+			match.match = (candidates.at(i).isPrefixMatch ? Utils::matchUrl(record.normalizedUrl, prefix) : QString());
+			match.isPrefixMatch = candidates.at(i).isPrefixMatch;
+			match.isTypedIn = markAsTypedIn;
+
+			matches.append(match);
+		}
+	});
+
+	if (prefix.isEmpty())
+	{
+		if (limit > 0)
+		{
+			candidates = getRankedCandidates([](int record)
+			{
+				Q_UNUSED(record)
+
+				return true;
+			}, currentTime, (limit * 2), true);
+		}
+		else
+		{
+			candidates.reserve(m_urlRecords.count() - m_freeUrlRecords.count());
+
+			for (int i = 0; i < m_urlRecords.count(); ++i)
+			{
+				const UrlRecord &record(m_urlRecords.at(i));
+
+				if (record.visitsAmount > 0)
+				{
+					MatchCandidate candidate;
+					candidate.score = calculateFrecency(record, currentTime);
+					candidate.lastVisitTime = record.lastVisitTime;
+					candidate.record = i;
+					candidate.isPrefixMatch = true;
+
+					candidates.append(candidate);
+				}
+			}
+		}
+
+		appendMatches();
+
+		return matches;
+	}
+
+	if (!m_hasPrefixIndex)
+	{
+		m_prefixIndex = createPrefixIndex(m_urlRecords, false);
+		m_schemePrefixIndex = createPrefixIndex(m_urlRecords, true);
+		m_hasPrefixIndex = true;
+	}
+
+	PrefixIndexEntry entry;
+	entry.key = key;
+
+	const auto isPrefixEntry([&](const PrefixIndexEntry &indexEntry)
+	{
+		return indexEntry.key.startsWith(key);
+	});
+	const QVector<PrefixIndexEntry>::const_iterator hostBegin(std::lower_bound(m_prefixIndex.constBegin(), m_prefixIndex.constEnd(), entry, comparePrefixIndexEntries));
+	const QVector<PrefixIndexEntry>::const_iterator hostEnd(std::partition_point(hostBegin, m_prefixIndex.constEnd(), isPrefixEntry));
+	const QVector<PrefixIndexEntry>::const_iterator schemeBegin(canMatchScheme ? std::lower_bound(m_schemePrefixIndex.constBegin(), m_schemePrefixIndex.constEnd(), entry, comparePrefixIndexEntries) : m_schemePrefixIndex.constEnd());
+	const QVector<PrefixIndexEntry>::const_iterator schemeEnd(std::partition_point(schemeBegin, m_schemePrefixIndex.constEnd(), isPrefixEntry));
+
+	if (limit > 0 && ((hostEnd - hostBegin) + (schemeEnd - schemeBegin)) > RankedScanThreshold)
+	{
+		candidates = getRankedCandidates([&](int record)
+		{
+			return matchesPrefix(record, key, canMatchScheme);
+		}, currentTime, (limit * 2), true);
+	}
+	else
+	{
+		QSet<int> matchedRecords;
+		const auto appendCandidates([&](QVector<PrefixIndexEntry>::const_iterator iterator, const QVector<PrefixIndexEntry>::const_iterator &last)
+		{
+			for (; iterator != last; ++iterator)
+			{
+				if (matchedRecords.contains(iterator->record))
+				{
+					continue;
+				}
+
+				const UrlRecord &record(m_urlRecords.at(iterator->record));
+				MatchCandidate candidate;
+				candidate.score = calculateFrecency(record, currentTime);
+				candidate.lastVisitTime = record.lastVisitTime;
+				candidate.record = iterator->record;
+				candidate.isPrefixMatch = true;
+
+				candidates.append(candidate);
+
+				matchedRecords.insert(iterator->record);
+			}
+		});
+
+		appendCandidates(hostBegin, hostEnd);
+		appendCandidates(schemeBegin, schemeEnd);
+	}
+
+	appendMatches();
+
+	if (limit > 0 && matches.count() >= limit)
+	{
+		return matches;
+	}
+
+	QVector<bool> recordMatches;
+	const QVector<int> records(getMatchingRecords(getTokens(prefix), ((limit > 0) ? &recordMatches : nullptr)));
+
+	candidates.clear();
+
+	if (recordMatches.isEmpty())
+	{
+		for (int i = 0; i < records.count(); ++i)
+		{
+			const UrlRecord &record(m_urlRecords.at(records.at(i)));
+
+			if (record.visitsAmount > 0 && !matchesPrefix(records.at(i), key, canMatchScheme))
+			{
+				MatchCandidate candidate;
+				candidate.score = calculateFrecency(record, currentTime);
+				candidate.lastVisitTime = record.lastVisitTime;
+				candidate.record = records.at(i);
+
+				candidates.append(candidate);
+			}
+		}
+	}
+	else
+	{
+		candidates = getRankedCandidates([&](int record)
+		{
+			return (recordMatches.at(record) && !matchedUrls.contains(m_urlRecords.at(record).normalizedUrl) && !matchesPrefix(record, key, canMatchScheme));
+		}, currentTime, ((limit - matches.count()) * 2), false);
+	}
+
+	appendMatches();
+
+	return matches;
+}
+
+QVector<HistoryModel::MatchCandidate> HistoryModel::getRankedCandidates(const std::function<bool(int)> &isMatch, qint64 currentTime, int amount, bool isPrefixMatch) const
+{
+	ensureRankedRecords(currentTime);
+
+	QVector<MatchCandidate> candidates;
+	QVector<qint64> scores;
+	scores.reserve(amount + 1);
+
+	for (int i = 0; i < m_rankedRecords.count(); ++i)
+	{
+		const RankedRecord &rankedRecord(m_rankedRecords.at(i));
+
+		if (scores.count() >= amount && scores.first() > rankedRecord.score)
+		{
+			break;
+		}
+
+		const UrlRecord &record(m_urlRecords.at(rankedRecord.record));
+
+		if (record.visitsAmount == 0 || !isMatch(rankedRecord.record))
+		{
+			continue;
+		}
+
+		MatchCandidate candidate;
+		candidate.score = calculateFrecency(record, currentTime);
+		candidate.lastVisitTime = record.lastVisitTime;
+		candidate.record = rankedRecord.record;
+		candidate.isPrefixMatch = isPrefixMatch;
+
+		candidates.append(candidate);
+
+		scores.append(candidate.score);
+
+		std::push_heap(scores.begin(), scores.end(), std::greater<qint64>());
+
+		if (scores.count() > amount)
+		{
+			std::pop_heap(scores.begin(), scores.end(), std::greater<qint64>());
+
+			scores.removeLast();
+		}
+	}
+
+	return candidates;
+}
+
+QVector<int> HistoryModel::getMatchingRows(const QString &query) const
+{
+	const QVector<TermMatches> termMatches(getTermMatches(getTokens(query)));
+	QVector<int> rows;
+
+	if (termMatches.isEmpty())
+	{
+		return rows;
+	}
+
+	for (int i = 0; i < m_rowsAmount; ++i)
+	{
+		const int position(getPosition(i));
+		const int urlRecord(m_visitUrls.at(position));
+		const int titleRecord(m_visitTitles.at(position));
+		bool isMatch(true);
+
+		for (int j = 0; j < termMatches.count(); ++j)
+		{
+			if (!termMatches.at(j).urlRecords.at(urlRecord) && !termMatches.at(j).titleRecords.at(titleRecord))
+			{
+				isMatch = false;
+
+				break;
+			}
+		}
+
+		if (isMatch)
+		{
+			rows.append(i);
+		}
+	}
+
+	return rows;
+}
+
+QVector<HistoryModel::TermMatches> HistoryModel::getTermMatches(const QStringList &terms) const
+{
+	if (terms.isEmpty())
+	{
+		return {};
+	}
+
+	ensureTokenIndex();
+
+	QVector<TermMatches> termMatches;
+	termMatches.reserve(terms.count());
+
+	for (int i = 0; i < terms.count(); ++i)
+	{
+		TermMatches matches;
+		matches.urlRecords.fill(false, m_urlRecords.count());
+		matches.titleRecords.fill(false, m_titleRecords.count());
+
+		bool hasMatch(false);
+		QMap<QString, TokenPostings>::const_iterator iterator(m_tokenIndex.lowerBound(terms.at(i)));
+
+		for (; iterator != m_tokenIndex.constEnd() && iterator.key().startsWith(terms.at(i)); ++iterator)
+		{
+			for (int j = 0; j < iterator->urlRecords.count(); ++j)
+			{
+				matches.urlRecords[iterator->urlRecords.at(j)] = true;
+			}
+
+			for (int j = 0; j < iterator->titleRecords.count(); ++j)
+			{
+				matches.titleRecords[iterator->titleRecords.at(j)] = true;
+			}
+
+			hasMatch = true;
+		}
+
+		if (!hasMatch)
+		{
+			return {};
+		}
+
+		termMatches.append(matches);
+	}
+
+	return termMatches;
+}
+
+QVector<int> HistoryModel::getMatchingRecords(const QStringList &terms, QVector<bool> *recordMatches) const
+{
+	if (terms.isEmpty())
+	{
+		return {};
+	}
+
+	ensureTokenIndex();
+
+	QVector<QVector<const QVector<int>*> > termPostings;
+	termPostings.reserve(terms.count());
+
+	int rarestTerm(0);
+	int rarestAmount(0);
+
+	for (int i = 0; i < terms.count(); ++i)
+	{
+		QVector<const QVector<int>*> postings;
+		int amount(0);
+		QMap<QString, TokenPostings>::const_iterator iterator(m_tokenIndex.lowerBound(terms.at(i)));
+
+		for (; iterator != m_tokenIndex.constEnd() && iterator.key().startsWith(terms.at(i)); ++iterator)
+		{
+			if (!iterator->urlRecords.isEmpty())
+			{
+				postings.append(&iterator->urlRecords);
+
+				amount += iterator->urlRecords.count();
+			}
+
+			if (!iterator->urlTitleRecords.isEmpty())
+			{
+				postings.append(&iterator->urlTitleRecords);
+
+				amount += iterator->urlTitleRecords.count();
+			}
+		}
+
+		if (postings.isEmpty())
+		{
+			return {};
+		}
+
+		if (i == 0 || amount < rarestAmount)
+		{
+			rarestTerm = i;
+			rarestAmount = amount;
+		}
+
+		termPostings.append(postings);
+	}
+
+	if (recordMatches && rarestAmount > RankedScanThreshold)
+	{
+		recordMatches->fill(true, m_urlRecords.count());
+
+		for (int i = 0; i < termPostings.count(); ++i)
+		{
+			QVector<bool> termMatches(m_urlRecords.count(), false);
+
+			for (int j = 0; j < termPostings.at(i).count(); ++j)
+			{
+				for (int k = 0; k < termPostings.at(i).at(j)->count(); ++k)
+				{
+					termMatches[termPostings.at(i).at(j)->at(k)] = true;
+				}
+			}
+
+			for (int j = 0; j < termMatches.count(); ++j)
+			{
+				if (!termMatches.at(j))
+				{
+					(*recordMatches)[j] = false;
+				}
+			}
+		}
+
+		return {};
+	}
+
+	QVector<int> candidates;
+	candidates.reserve(rarestAmount);
+
+	for (int i = 0; i < termPostings.at(rarestTerm).count(); ++i)
+	{
+		candidates += *termPostings.at(rarestTerm).at(i);
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	QVector<int> records;
+	records.reserve(candidates.count());
+
+	for (int i = 0; i < candidates.count(); ++i)
+	{
+		bool isMatch(true);
+
+		for (int j = 0; j < termPostings.count() && isMatch; ++j)
+		{
+			if (j == rarestTerm)
+			{
+				continue;
+			}
+
+			isMatch = false;
+
+			for (int k = 0; k < termPostings.at(j).count(); ++k)
+			{
+				if (std::binary_search(termPostings.at(j).at(k)->constBegin(), termPostings.at(j).at(k)->constEnd(), candidates.at(i)))
+				{
+					isMatch = true;
+
+					break;
+				}
+			}
+		}
+
+		if (isMatch)
+		{
+			records.append(candidates.at(i));
+		}
+	}
+
+	return records;
+}
+
+HistoryModel::HistoryType HistoryModel::getType() const
+{
+	return m_type;
+}
+
+QString HistoryModel::getJournalPath() const
+{
+	return m_path + QLatin1String(".journal");
+}
+
+QVector<HistoryModel::PrefixIndexEntry> HistoryModel::createPrefixIndex(const QVector<UrlRecord> &records, bool hasScheme)
+{
+	QVector<PrefixIndexEntry> index;
+	index.reserve(hasScheme ? records.count() : (records.count() * 2));
+
+	for (int i = 0; i < records.count(); ++i)
+	{
+		if (records.at(i).visitsAmount == 0)
+		{
+			continue;
+		}
+
+		const QStringList keys(hasScheme ? QStringList({records.at(i).prefixKey}) : getPrefixKeys(records.at(i)));
+
+		for (int j = 0; j < keys.count(); ++j)
+		{
+			PrefixIndexEntry entry;
+			entry.key = keys.at(j);
+			entry.record = i;
+
+			index.append(entry);
+		}
+	}
+
+	std::sort(index.begin(), index.end(), comparePrefixIndexEntries);
+
+	return index;
+}
+
+QMap<QString, HistoryModel::TokenPostings> HistoryModel::createTokenIndex(const QVector<UrlRecord> &urlRecords, const QVector<TitleRecord> &titleRecords)
+{
+	QMap<QString, TokenPostings> index;
+
+	for (int i = 0; i < urlRecords.count(); ++i)
+	{
+		if (urlRecords.at(i).visitsAmount > 0)
+		{
+			const QStringList tokens(getTokens(urlRecords.at(i).url.toDisplayString()));
+
+			for (int j = 0; j < tokens.count(); ++j)
+			{
+				index[tokens.at(j)].urlRecords.append(i);
+			}
+
+			const QStringList titleTokens(getTokens(urlRecords.at(i).title));
+
+			for (int j = 0; j < titleTokens.count(); ++j)
+			{
+				index[titleTokens.at(j)].urlTitleRecords.append(i);
+			}
+		}
+	}
+
+	for (int i = 0; i < titleRecords.count(); ++i)
+	{
+		if (titleRecords.at(i).visitsAmount > 0)
+		{
+			const QStringList tokens(getTokens(titleRecords.at(i).title));
+
+			for (int j = 0; j < tokens.count(); ++j)
+			{
+				index[tokens.at(j)].titleRecords.append(i);
+			}
+		}
+	}
+
+	return index;
+}
+
+QStringList HistoryModel::getPrefixKeys(const UrlRecord &record)
+{
+	const int position(record.prefixKey.indexOf(QLatin1String("://")));
+	const QString key((position < 0) ? record.prefixKey : record.prefixKey.mid(position + 3));
+	QStringList keys({key});
+
+	if (key.startsWith(QLatin1String("www.")) && record.normalizedUrl.host().count(QLatin1Char('.')) > 1)
+	{
+		keys.append(key.mid(4));
+	}
+
+	return keys;
+}
+
+QStringList HistoryModel::getTokens(const QString &text)
+{
+	QStringList tokens;
+	QString token;
+
+	for (int i = 0; i < text.count(); ++i)
+	{
+		const QChar character(text.at(i));
+
+		if (character.isLetterOrNumber())
+		{
+			token.append(character.toLower());
+		}
+		else if (!token.isEmpty())
+		{
+			tokens.append(token);
+
+			token.clear();
+		}
+	}
+
+	if (!token.isEmpty())
+	{
+		tokens.append(token);
+	}
+
+	tokens.removeDuplicates();
+
+	return tokens;
+}
+
+qint64 HistoryModel::calculateFrecency(const UrlRecord &record, qint64 currentTime)
+{
+	const qint64 age((currentTime - record.lastVisitTime) / 86400000);
+	int weight(10);
+
+	if (age <= 4)
+	{
+		weight = 100;
+	}
+	else if (age <= 14)
+	{
+		weight = 70;
+	}
+	else if (age <= 31)
+	{
+		weight = 50;
+	}
+	else if (age <= 90)
+	{
+		weight = 30;
+	}
+
+	return (static_cast<qint64>(record.visitsAmount + record.typedAmount) * weight);
+}
+
+bool HistoryModel::comparePrefixIndexEntries(const PrefixIndexEntry &first, const PrefixIndexEntry &second)
+{
+	const int result(first.key.compare(second.key));
+
+	return ((result == 0) ? (first.record < second.record) : (result < 0));
+}
+
+bool HistoryModel::compareRankedRecords(const RankedRecord &first, const RankedRecord &second)
+{
+	return ((first.score == second.score) ? (first.record < second.record) : (first.score > second.score));
+}
+
+bool HistoryModel::compareMatchCandidates(const MatchCandidate &first, const MatchCandidate &second)
+{
+	if (first.isPrefixMatch != second.isPrefixMatch)
+	{
+		return first.isPrefixMatch;
+	}
+
+	return ((first.score == second.score) ? (first.lastVisitTime > second.lastVisitTime) : (first.score > second.score));
+}
+
+int HistoryModel::internUrl(const QUrl &url)
+{
+	int index(m_urlIndexes.value(url, -1));
+
+	if (index < 0)
+	{
+		UrlRecord record;
+		record.url = url;
+		record.normalizedUrl = Utils::normalizeUrl(url);
+		record.prefixKey = record.normalizedUrl.toString().toLower();
+
+		if (m_freeUrlRecords.isEmpty())
+		{
+			index = m_urlRecords.count();
+
+			m_urlRecords.append(record);
+		}
+		else
+		{
+			index = m_freeUrlRecords.takeLast();
+
+			m_urlRecords[index] = record;
+		}
+
+		m_urlIndexes[url] = index;
+		m_normalizedUrls[record.normalizedUrl].append(index);
+
+		if (m_hasPrefixIndex)
+		{
+			addToPrefixIndex(index);
+		}
+
+		if (m_hasTokenIndex)
+		{
+			addToTokenIndex(url.toDisplayString(), index, UrlPostings);
+		}
+	}
+
+	++m_urlRecords[index].visitsAmount;
+
+	return index;
+}
+
+int HistoryModel::internTitle(const QString &title)
+{
+	int index(m_titleIndexes.value(title, -1));
+
+	if (index < 0)
+	{
+		TitleRecord record;
+		record.title = title;
+
+		if (m_freeTitleRecords.isEmpty())
+		{
+			index = m_titleRecords.count();
+
+			m_titleRecords.append(record);
+		}
+		else
+		{
+			index = m_freeTitleRecords.takeLast();
+
+			m_titleRecords[index] = record;
+		}
+
+		m_titleIndexes[title] = index;
+
+		if (m_hasTokenIndex)
+		{
+			addToTokenIndex(title, index, TitlePostings);
+		}
+	}
+
+	++m_titleRecords[index].visitsAmount;
+
+	return index;
+}
+
+int HistoryModel::getPosition(int row) const
+{
+	return (m_visitTimes.count() - row - 1);
+}
+
+int HistoryModel::rowCount(const QModelIndex &parent) const
+{
+	return (parent.isValid() ? 0 : m_rowsAmount);
+}
+
+qint64 HistoryModel::readTime(const QString &time)
+{
+	QDateTime dateTime(QDateTime::fromString(time, Qt::ISODate));
+	dateTime.setTimeSpec(Qt::UTC);
+
+	return (dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : 0);
+}
+
+int HistoryModel::getVisitPosition(quint64 identifier) const
+{
+	const QHash<quint64, int>::const_iterator iterator(m_identifierPositions.constFind(identifier));
+
+	return ((iterator == m_identifierPositions.constEnd()) ? -1 : (iterator.value() - m_positionOffset));
+}
+
+bool HistoryModel::isExpired(qint64 time, int period, qint64 currentTime)
+{
+	if (period < 0)
+	{
+		return false;
+	}
+
+	return (QDateTime::fromMSecsSinceEpoch(time, Qt::UTC).daysTo(QDateTime::fromMSecsSinceEpoch(currentTime, Qt::UTC)) > period);
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+	return (!parent.isValid() && (m_loadWatcher || m_rowsAmount < m_visitTimes.count()));
+}
+
+bool HistoryModel::hasEntry(const QUrl &url) const
+{
+	return m_normalizedUrls.contains(Utils::normalizeUrl(url));
+}
+
+bool HistoryModel::matchesPrefix(int record, const QString &prefix, bool canMatchScheme) const
+{
+	const UrlRecord &urlRecord(m_urlRecords.at(record));
+
+	if (canMatchScheme && urlRecord.prefixKey.startsWith(prefix))
+	{
+		return true;
+	}
+
+	const int position(urlRecord.prefixKey.indexOf(QLatin1String("://")));
+	const int offset((position < 0) ? 0 : (position + 3));
+	const QStringRef key(urlRecord.prefixKey.midRef(offset));
+
+	if (key.startsWith(prefix))
+	{
+		return true;
+	}
+
+	return (key.startsWith(QLatin1String("www.")) && urlRecord.prefixKey.midRef(offset + 4).startsWith(prefix) && urlRecord.normalizedUrl.host().count(QLatin1Char('.')) > 1);
+}
+
+bool HistoryModel::matchesQuery(quint64 identifier, const QString &query) const
+{
+	const int position(getVisitPosition(identifier));
+
+	if (position < 0)
+	{
+		return false;
+	}
+
+	const QStringList terms(getTokens(query));
+	const QStringList tokens(getTokens(m_urlRecords.at(m_visitUrls.at(position)).url.toDisplayString()) + getTokens(m_titleRecords.at(m_visitTitles.at(position)).title));
+
+	for (int i = 0; i < terms.count(); ++i)
+	{
+		bool hasMatch(false);
+
+		for (int j = 0; j < tokens.count(); ++j)
+		{
+			if (tokens.at(j).startsWith(terms.at(i)))
+			{
+				hasMatch = true;
+
+				break;
+			}
+		}
+
+		if (!hasMatch)
+		{
+			return false;
+		}
+	}
+
+	return !terms.isEmpty();
 }
 
 }
@@ -21,14 +21,20 @@
 #ifndef OTTER_HISTORYMODEL_H
 #define OTTER_HISTORYMODEL_H
 
+#include <QtCore/QAbstractListModel>
 #include <QtCore/QDateTime>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMap>
 #include <QtCore/QUrl>
-#include <QtGui/QStandardItemModel>
+#include <QtGui/QIcon>
+
+#include <functional>
 
 namespace Otter
 {
 
-class HistoryModel final : public QStandardItemModel
+class HistoryModel final : public QAbstractListModel
 {
 	Q_OBJECT
 
@@ -47,11 +53,9 @@ public:
 		TypedHistory
 	};
 
-	class Entry final : public QStandardItem
+	class Entry final
 	{
 	public:
-		void setData(const QVariant &value, int role) override;
-		void setItemData(const QVariant &value, int role);
 		QString getTitle() const;
 		QUrl getUrl() const;
 		QDateTime getTimeVisited() const;
@@ -60,43 +64,267 @@ public:
 		bool isValid() const;
 
 	protected:
-		explicit Entry();
+		QString m_title;
+		QUrl m_url;
+		QDateTime m_timeVisited;
+		quint64 m_identifier = 0;
 
 	friend class HistoryModel;
 	};
 
+	struct UrlStatistics final
+	{
+		QString lastTitle;
+		QDateTime firstVisitTime;
+		QDateTime lastVisitTime;
+		int visitsAmount = 0;
+		int typedAmount = 0;
+	};
+
 	struct HistoryEntryMatch final
 	{
-		Entry *entry = nullptr;
+		Entry entry;
 		QString match;
+		bool isPrefixMatch = true;
 		bool isTypedIn = false;
 	};
 
 	explicit HistoryModel(const QString &path, HistoryType type, QObject *parent = nullptr);
 
-	void clearExcessEntries(int limit);
+	void save();
+	void loadAll();
 	void clearRecentEntries(uint period);
-	void clearOldestEntries(int period);
+	void expireEntries(int limit, int period);
 	void removeEntry(quint64 identifier);
-	Entry* addEntry(const QUrl &url, const QString &title, const QIcon &icon, const QDateTime &date = QDateTime::currentDateTimeUtc(), quint64 identifier = 0);
-	Entry* getEntry(quint64 identifier) const;
+	void removeEntries(const QVector<quint64> &identifiers);
+	void removeDomainEntries(const QString &host);
+	void updateEntry(quint64 identifier, const QUrl &url, const QString &title);
+	void fetchMore(const QModelIndex &parent) override;
+	Entry getEntry(quint64 identifier) const;
+	UrlStatistics getUrlStatistics(const QUrl &url) const;
 	QDateTime getLastVisitTime(const QUrl &url) const;
-	QVector<HistoryEntryMatch> findEntries(const QString &prefix, bool markAsTypedIn = false) const;
+	QVariant data(const QModelIndex &index, int role) const override;
+	QVector<HistoryEntryMatch> findEntries(const QString &prefix, bool markAsTypedIn = false, int limit = 50) const;
+	QVector<int> getMatchingRows(const QString &query) const;
 	HistoryType getType() const;
+	quint64 addEntry(const QUrl &url, const QString &title, const QDateTime &date = QDateTime::currentDateTimeUtc(), quint64 identifier = 0, bool isTypedIn = false);
+	int rowCount(const QModelIndex &parent = {}) const override;
+	bool canFetchMore(const QModelIndex &parent) const override;
 	bool hasEntry(const QUrl &url) const;
-	bool save(const QString &path) const;
-	bool setData(const QModelIndex &index, const QVariant &value, int role) override;
+	bool matchesQuery(quint64 identifier, const QString &query) const;
+
+protected:
+	enum CompactionInformation
+	{
+		CompactionRetryInterval = 300000
+	};
+
+	enum ExpiryInformation
+	{
+		ExpiryBatchSize = 500
+	};
+
+	enum PageInformation
+	{
+		InitialPageSize = 2000,
+		PageSize = 1000
+	};
+
+	enum IndexInformation
+	{
+		IndexRebuildThreshold = 100,
+		RankedScanThreshold = 4096,
+		RankingRefreshInterval = 86400000
+	};
+
+	enum PostingsType
+	{
+		UrlPostings = 0,
+		TitlePostings,
+		UrlTitlePostings
+	};
+
+	struct SnapshotEntry final
+	{
+		QString url;
+		QString title;
+		qint64 timeVisited = 0;
+		quint64 identifier = 0;
+		bool isTypedIn = false;
+	};
+
+	struct UrlRecord final
+	{
+		QUrl url;
+		QUrl normalizedUrl;
+		QString prefixKey;
+		QString title;
+		qint64 firstVisitTime = 0;
+		qint64 lastVisitTime = 0;
+		quint64 firstVisitIdentifier = 0;
+		quint64 lastVisitIdentifier = 0;
+		int visitsAmount = 0;
+		int typedAmount = 0;
+	};
+
+	struct PrefixIndexEntry final
+	{
+		QString key;
+		int record = -1;
+	};
+
+	struct RankedRecord final
+	{
+		qint64 score = 0;
+		int record = -1;
+	};
+
+	struct TokenPostings final
+	{
+		QVector<int> urlRecords;
+		QVector<int> titleRecords;
+		QVector<int> urlTitleRecords;
+	};
+
+	struct TermMatches final
+	{
+		QVector<bool> urlRecords;
+		QVector<bool> titleRecords;
+	};
+
+	struct MatchCandidate final
+	{
+		qint64 score = 0;
+		qint64 lastVisitTime = 0;
+		int record = -1;
+		bool isPrefixMatch = false;
+	};
+
+	struct TitleRecord final
+	{
+		QString title;
+		int visitsAmount = 0;
+	};
+
+	struct LoadResult final
+	{
+		QVector<qint64> visitTimes;
+		QVector<quint64> visitIdentifiers;
+		QVector<int> visitUrls;
+		QVector<int> visitTitles;
+		QVector<bool> visitTypedFlags;
+		QVector<UrlRecord> urlRecords;
+		QVector<TitleRecord> titleRecords;
+		QHash<QUrl, int> urlIndexes;
+		QHash<QString, int> titleIndexes;
+		QHash<QUrl, QVector<int> > normalizedUrls;
+		QHash<quint64, int> identifierPositions;
+		QVector<PrefixIndexEntry> prefixIndex;
+		QVector<PrefixIndexEntry> schemePrefixIndex;
+		QMap<QString, TokenPostings> tokenIndex;
+		QString errorString;
+		quint64 lastIdentifier = 0;
+		quint64 journalSequence = 0;
+		int journalRecordsAmount = 0;
+		bool hasError = false;
+	};
+
+	void timerEvent(QTimerEvent *event) override;
+	void appendJournalRecord(const QJsonObject &record, int weight = 1);
+	void finishLoading();
+	void waitForLoaded();
+	void writeJournal();
+	void compact();
+	void compactAndWait();
+	void finishCompaction();
+	void finishExpiry();
+	void removeVisits(int position, int amount);
+	void removeVisits(const QVector<int> &positions);
+	void releaseUrl(int index);
+	void releaseTitle(int index);
+	void updateIdentifierPositions(int position);
+	void updateVisitBounds(const QVector<int> &records);
+	void registerVisit(int position);
+	void updateLastVisit(int record, int position);
+	void updateRankedRecord(int record);
+	void addToPrefixIndex(int record) const;
+	void removeFromPrefixIndex(int record) const;
+	void addToTokenIndex(const QString &text, int record, PostingsType type) const;
+	void removeFromTokenIndex(const QString &text, int record, PostingsType type) const;
+	void ensureTokenIndex() const;
+	void ensureRankedRecords(qint64 currentTime) const;
+	static QStringList getPrefixKeys(const UrlRecord &record);
+	static QStringList getTokens(const QString &text);
+	static LoadResult loadSnapshot(const QString &path, const QString &journalPath);
+	static QVector<PrefixIndexEntry> createPrefixIndex(const QVector<UrlRecord> &records, bool hasScheme);
+	static QMap<QString, TokenPostings> createTokenIndex(const QVector<UrlRecord> &urlRecords, const QVector<TitleRecord> &titleRecords);
+	static qint64 readTime(const QString &time);
+	static bool isExpired(qint64 time, int period, qint64 currentTime);
+	static qint64 calculateFrecency(const UrlRecord &record, qint64 currentTime);
+	static bool comparePrefixIndexEntries(const PrefixIndexEntry &first, const PrefixIndexEntry &second);
+	static bool compareRankedRecords(const RankedRecord &first, const RankedRecord &second);
+	static bool compareMatchCandidates(const MatchCandidate &first, const MatchCandidate &second);
+	QString getJournalPath() const;
+	Entry createEntry(int position) const;
+	QVector<TermMatches> getTermMatches(const QStringList &terms) const;
+	QVector<MatchCandidate> getRankedCandidates(const std::function<bool(int)> &isMatch, qint64 currentTime, int amount, bool isPrefixMatch) const;
+	QVector<int> getMatchingRecords(const QStringList &terms, QVector<bool> *recordMatches = nullptr) const;
+	int internUrl(const QUrl &url);
+	int internTitle(const QString &title);
+	int getPosition(int row) const;
+	int getVisitPosition(quint64 identifier) const;
+	bool matchesPrefix(int record, const QString &prefix, bool canMatchScheme) const;
 
 private:
-	QHash<QUrl, QVector<Entry*> > m_urls;
-	QMap<quint64, Entry*> m_identifiers;
+	QString m_path;
+	QByteArray m_journalBuffer;
+	QVector<qint64> m_visitTimes;
+	QVector<quint64> m_visitIdentifiers;
+	QVector<int> m_visitUrls;
+	QVector<int> m_visitTitles;
+	QVector<bool> m_visitTypedFlags;
+	QVector<UrlRecord> m_urlRecords;
+	QVector<TitleRecord> m_titleRecords;
+	QVector<int> m_freeUrlRecords;
+	QVector<int> m_freeTitleRecords;
+	QHash<QUrl, int> m_urlIndexes;
+	QHash<QString, int> m_titleIndexes;
+	QHash<QUrl, QVector<int> > m_normalizedUrls;
+	QHash<quint64, int> m_identifierPositions;
+	QVector<quint64> m_expiredIdentifiers;
+	mutable QVector<PrefixIndexEntry> m_prefixIndex;
+	mutable QVector<PrefixIndexEntry> m_schemePrefixIndex;
+	mutable QVector<RankedRecord> m_rankedRecords;
+	mutable QVector<qint64> m_recordScores;
+	mutable QMap<QString, TokenPostings> m_tokenIndex;
+	QFutureWatcher<bool> *m_compactionWatcher;
+	QFutureWatcher<QVector<quint64> > *m_expiryWatcher;
+	QFutureWatcher<LoadResult> *m_loadWatcher;
 	HistoryType m_type;
+	quint64 m_lastIdentifier;
+	quint64 m_journalSequence;
+	int m_journalRecordsAmount;
+	int m_bufferedRecordsAmount;
+	int m_compactionTimer;
+	int m_expiryTimer;
+	int m_expiryIndex;
+	int m_expiryLimit;
+	int m_expiryPeriod;
+	int m_positionOffset;
+	int m_rowsAmount;
+	mutable qint64 m_rankingTime;
+	mutable bool m_hasPrefixIndex;
+	mutable bool m_hasRankedRecords;
+	mutable bool m_hasTokenIndex;
+	bool m_needsExpiry;
+	bool m_isLoading;
 
 signals:
 	void cleared();
-	void entryAdded(Entry *entry);
-	void entryModified(Entry *entry);
-	void entryRemoved(Entry *entry);
+	void loaded();
+	void entryAdded(const HistoryModel::Entry &entry);
+	void entryModified(const HistoryModel::Entry &entry);
+	void entryRemoved(const HistoryModel::Entry &entry);
 	void modelModified();
 };
 
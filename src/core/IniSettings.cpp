@@ -20,9 +20,12 @@
 #include "IniSettings.h"
 
 #include <QtCore/QFile>
+#include <QtCore/QHash>
 #include <QtCore/QSaveFile>
 #include <QtCore/QTextStream>
 
+#include <cstring>
+
 namespace Otter
 {
 
@@ -44,54 +47,121 @@ IniSettings::IniSettings(const QString &path, QObject *parent) : QObject(parent)
 		return;
 	}
 
+	const qint64 size(file.size());
+	uchar *data((size > 0) ? file.map(0, size) : nullptr);
+
+	if (data)
+	{
+		parse(reinterpret_cast<const char*>(data), size);
+
+		file.unmap(data);
+	}
+	else
+	{
+		const QByteArray buffer(file.readAll());
+
+		parse(buffer.constData(), buffer.size());
+	}
+
+	file.close();
+}
+
+void IniSettings::parse(const char *data, qint64 size)
+{
+	QHash<QByteArray, QString> names;
+	QMap<QString, Entry> *groupData(nullptr);
 	QString group;
 	QStringList comment;
+	const char *position(data);
+	const char *end(data + size);
 	bool isHeader(true);
-	QTextStream stream(&file);
-	stream.setCodec("UTF-8");
 
-	while (!stream.atEnd())
+	const auto internName([&](const char *name, int length) -> QString
 	{
-		const QString line(stream.readLine());
+		const QByteArray rawName(QByteArray::fromRawData(name, length));
+		const QHash<QByteArray, QString>::const_iterator iterator(names.constFind(rawName));
 
-		if (line.startsWith(QLatin1Char(';')))
+		if (iterator != names.constEnd())
+		{
+			return iterator.value();
+		}
+
+		const QString decodedName(QString::fromUtf8(name, length));
+
+		names.insert(QByteArray(name, length), decodedName);
+
+		return decodedName;
+	});
+
+	if (size >= 3 && qstrncmp(position, "\xEF\xBB\xBF", 3) == 0)
+	{
+		position += 3;
+	}
+
+	while (position < end)
+	{
+		const char *lineEnd(static_cast<const char*>(memchr(position, '\n', static_cast<size_t>(end - position))));
+		const char *nextLine(lineEnd ? (lineEnd + 1) : end);
+
+		if (!lineEnd)
+		{
+			lineEnd = end;
+		}
+
+		if (lineEnd > position && *(lineEnd - 1) == '\r')
+		{
+			--lineEnd;
+		}
+
+		const int length(static_cast<int>(lineEnd - position));
+
+		if (length == 0)
+		{
+			isHeader = false;
+		}
+		else if (*position == ';')
 		{
 			if (isHeader)
 			{
-				comment.append(line.mid(2));
+				comment.append(QString::fromUtf8(position, length).mid(2));
 			}
 		}
-		else if (line.startsWith(QLatin1Char('[')))
+		else if (*position == '[')
 		{
-			if (line.endsWith(QLatin1Char(']')))
+			if (*(lineEnd - 1) == ']' && length > 1)
 			{
-				group = line.mid(1, (line.length() - 2));
+				group = internName((position + 1), (length - 2));
+				groupData = nullptr;
 			}
 		}
-		else if (!line.isEmpty())
+		else
 		{
-			const QString key(line.section(QLatin1Char('='), 0, 0));
-			const QVariant value(line.contains(QLatin1Char('=')) ? QVariant(line.section(QLatin1Char('='), 1, -1)) : QVariant());
+			const char *separator(static_cast<const char*>(memchr(position, '=', static_cast<size_t>(length))));
+			const int keyLength(separator ? static_cast<int>(separator - position) : length);
 
-			if (!key.isEmpty())
+			if (keyLength > 0)
 			{
-				if (!m_data.contains(group))
+				if (!groupData)
+				{
+					groupData = &m_data[group];
+				}
+
+				Entry entry;
+				entry.isRaw = true;
+
+				if (separator)
 				{
-					m_data[group] = {};
+					entry.rawValue = QByteArray((separator + 1), static_cast<int>(lineEnd - separator - 1));
 				}
 
-				m_data[group][key] = value;
+				groupData->insert(internName(position, keyLength), entry);
 			}
 		}
-		else if (isHeader)
-		{
-			isHeader = false;
-		}
+
+		position = nextLine;
 	}
 
 	m_comment = comment.join(QLatin1Char('\n'));
-
-	file.close();
 }
 
 void IniSettings::clear()
@@ -143,12 +213,10 @@ void IniSettings::setValue(const QString &key, const QVariant &value)
 	}
 	else
 	{
-		if (!m_data.contains(m_group))
-		{
-			m_data[m_group] = {};
-		}
+		Entry entry;
+		entry.value = value;
 
-		m_data[m_group][key] = value;
+		m_data[m_group][key] = entry;
 	}
 }
 
@@ -159,9 +227,16 @@ QString IniSettings::getComment() const
 
 QVariant IniSettings::getValue(const QString &key, const QVariant &fallback) const
 {
-	if (m_data.contains(m_group) && m_data[m_group].contains(key))
+	const QMap<QString, QMap<QString, Entry> >::const_iterator groupIterator(m_data.constFind(m_group));
+
+	if (groupIterator != m_data.constEnd())
 	{
-		return m_data[m_group][key];
+		const QMap<QString, Entry>::const_iterator keyIterator(groupIterator.value().constFind(key));
+
+		if (keyIterator != groupIterator.value().constEnd())
+		{
+			return keyIterator.value().getValue();
+		}
 	}
 
 	return fallback;
@@ -187,7 +262,7 @@ QStringList IniSettings::getKeys() const
 	QStringList keys;
 	keys.reserve(m_data.count());
 
-	QMap<QString, QVariantMap>::const_iterator iterator;
+	QMap<QString, QMap<QString, Entry> >::const_iterator iterator;
 
 	for (iterator = m_data.constBegin(); iterator != m_data.constEnd(); ++iterator)
 	{
@@ -244,7 +319,7 @@ bool IniSettings::save(const QString &path, bool isAtomic)
 		canAddNewLine = true;
 	}
 
-	QMap<QString, QVariantMap>::iterator groupsIterator;
+	QMap<QString, QMap<QString, Entry> >::iterator groupsIterator;
 
 	for (groupsIterator = m_data.begin(); groupsIterator != m_data.end(); ++groupsIterator)
 	{
@@ -264,11 +339,11 @@ bool IniSettings::save(const QString &path, bool isAtomic)
 
 		stream << QLatin1Char('[') << groupsIterator.key() << QLatin1String("]\n");
 
-		QVariantMap::iterator keysIterator;
+		QMap<QString, Entry>::iterator keysIterator;
 
 		for (keysIterator = groupsIterator.value().begin(); keysIterator != groupsIterator.value().end(); ++keysIterator)
 		{
-			stream << keysIterator.key() << QLatin1Char('=') << keysIterator.value().toString() << QLatin1Char('\n');
+			stream << keysIterator.key() << QLatin1Char('=') << keysIterator.value().getValue().toString() << QLatin1Char('\n');
 		}
 	}
 
@@ -20,8 +20,9 @@
 #ifndef OTTER_INISETTINGS_H
 #define OTTER_INISETTINGS_H
 
+#include <QtCore/QMap>
 #include <QtCore/QObject>
-#include <QtCore/QVariantMap>
+#include <QtCore/QVariant>
 
 namespace Otter
 {
@@ -47,11 +48,31 @@ public:
 	bool save(const QString &path = {}, bool isAtomic = true);
 	bool hasError() const;
 
+protected:
+	struct Entry final
+	{
+		QVariant value;
+		QByteArray rawValue;
+		bool isRaw = false;
+
+		QVariant getValue() const
+		{
+			if (!isRaw)
+			{
+				return value;
+			}
+
+			return (rawValue.isNull() ? QVariant() : QVariant(QString::fromUtf8(rawValue)));
+		}
+	};
+
+	void parse(const char *data, qint64 size);
+
 private:
 	QString m_path;
 	QString m_group;
 	QString m_comment;
-	QMap<QString, QVariantMap> m_data;
+	QMap<QString, QMap<QString, Entry> > m_data;
 	bool m_hasError;
 };
 
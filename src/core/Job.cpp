@@ -79,7 +79,7 @@ void FetchJob::start()
 		return;
 	}
 
-	m_reply = NetworkManagerFactory::createRequest(m_url, QNetworkAccessManager::GetOperation, m_isPrivate);
+	m_reply = NetworkManagerFactory::createRequest(m_url, QNetworkAccessManager::GetOperation, m_isPrivate, nullptr, m_headers);
 
 	connect(m_reply, &QNetworkReply::downloadProgress, this, [&](qint64 bytesReceived, qint64 bytesTotal)
 	{
@@ -151,6 +151,11 @@ void FetchJob::setPrivate(bool isPrivate)
 	m_isPrivate = isPrivate;
 }
 
+void FetchJob::setHeaders(const QMap<QByteArray, QByteArray> &headers)
+{
+	m_headers = headers;
+}
+
 QUrl FetchJob::getUrl() const
 {
 	return (m_reply ? m_reply->request().url() : m_url);
@@ -191,6 +196,11 @@ QMap<QByteArray, QByteArray> DataFetchJob::getHeaders() const
 	return headers;
 }
 
+int DataFetchJob::getStatusCode() const
+{
+	return (m_reply ? m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() : 0);
+}
+
 IconFetchJob::IconFetchJob(const QUrl &url, QObject *parent) : FetchJob(url, parent)
 {
 	setSizeLimit(20480);
@@ -62,6 +62,7 @@ public:
 	void setTimeout(int seconds);
 	void setSizeLimit(qint64 limit);
 	void setPrivate(bool isPrivate);
+	void setHeaders(const QMap<QByteArray, QByteArray> &headers);
 	QUrl getUrl() const;
 	bool isRunning() const override;
 
@@ -78,6 +79,7 @@ protected:
 private:
 	QNetworkReply *m_reply;
 	QUrl m_url;
+	QMap<QByteArray, QByteArray> m_headers;
 	qint64 m_sizeLimit;
 	int m_timeoutTimer;
 	bool m_isFinished;
@@ -94,6 +96,7 @@ public:
 
 	QIODevice* getData() const;
 	QMap<QByteArray, QByteArray> getHeaders() const;
+	int getStatusCode() const;
 
 protected:
 	void handleSuccessfulReply(QNetworkReply *reply) override;
@@ -19,11 +19,15 @@
 
 #include "JsonSettings.h"
 
+#include <QtCore/QCborArray>
+#include <QtCore/QCborMap>
+#include <QtCore/QCborValue>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonObject>
 #include <QtCore/QFile>
 #include <QtCore/QSaveFile>
-#include <QtCore/QTextStream>
 
 namespace Otter
 {
@@ -44,38 +48,51 @@ JsonSettings::JsonSettings(const QString &path) :
 		return;
 	}
 
-	if (file.read(2) == QByteArray(2, '/'))
+	const QByteArray data(file.readAll());
+
+	file.close();
+
+	if (loadBinaryCache(path, data))
 	{
-		file.reset();
+		return;
+	}
+
+	int position(0);
 
+	if (data.startsWith(QByteArray(2, '/')))
+	{
 		QStringList comment;
-		QTextStream stream(&file);
-		stream.setCodec("UTF-8");
 
-		while (!stream.atEnd())
+		while (position < data.size())
 		{
-			const QString line(stream.readLine());
+			int lineEnd(data.indexOf('\n', position));
 
-			if (line.startsWith(QLatin1String("//")))
+			if (lineEnd < 0)
 			{
-				comment.append(line.mid(3));
+				lineEnd = data.size();
 			}
-			else
+
+			if (!QByteArray::fromRawData((data.constData() + position), (lineEnd - position)).startsWith("//"))
 			{
 				break;
 			}
+
+			QString line(QString::fromUtf8(data.constData() + position, (lineEnd - position)));
+
+			if (line.endsWith(QLatin1Char('\r')))
+			{
+				line.chop(1);
+			}
+
+			comment.append(line.mid(3));
+
+			position = (lineEnd + 1);
 		}
 
 		m_comment = comment.join(QLatin1Char('\n'));
-
-		file.seek(stream.pos());
-	}
-	else
-	{
-		file.reset();
 	}
 
-	const QJsonDocument document(QJsonDocument::fromJson(file.readAll()));
+	const QJsonDocument document(QJsonDocument::fromJson((position > 0) ? data.mid(position) : data));
 
 	if (document.isArray())
 	{
@@ -85,8 +102,25 @@ JsonSettings::JsonSettings(const QString &path) :
 	{
 		setObject(document.object());
 	}
+}
 
-	file.close();
+void JsonSettings::saveBinaryCache(const QString &path, const QByteArray &checksum) const
+{
+	QSaveFile file(getBinaryCachePath(path));
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_15);
+	stream << static_cast<quint32>(BinaryCacheMagic) << static_cast<quint32>(BinaryCacheVersion) << checksum << m_comment << QCborValue::fromJsonValue(isArray() ? QJsonValue(array()) : QJsonValue(object())).toCbor();
+
+	if (stream.status() == QDataStream::Ok)
+	{
+		file.commit();
+	}
 }
 
 void JsonSettings::setComment(const QString &comment)
@@ -238,21 +272,6 @@ bool JsonSettings::save(const QString &path, bool isAtomic)
 
 	m_hasError = false;
 
-	if (!m_comment.isEmpty())
-	{
-		QTextStream stream(file);
-		stream.setCodec("UTF-8");
-
-		const QStringList comment(m_comment.split(QLatin1Char('\n')));
-
-		for (int i = 0; i < comment.count(); ++i)
-		{
-			stream << QLatin1String("// ") << comment.at(i) << QLatin1Char('\n');
-		}
-
-		stream << QLatin1Char('\n');
-	}
-
 	QByteArray data(toJson());
 	int spacesAmount(0);
 	int tabsAmount(0);
@@ -297,6 +316,21 @@ bool JsonSettings::save(const QString &path, bool isAtomic)
 		}
 	}
 
+	if (!m_comment.isEmpty())
+	{
+		QByteArray header;
+		const QStringList comment(m_comment.split(QLatin1Char('\n')));
+
+		for (int i = 0; i < comment.count(); ++i)
+		{
+			header.append(QByteArrayLiteral("// ") + comment.at(i).toUtf8() + '\n');
+		}
+
+		header.append('\n');
+
+		data.prepend(header);
+	}
+
 	file->write(data);
 
 	bool result(true);
@@ -312,9 +346,92 @@ bool JsonSettings::save(const QString &path, bool isAtomic)
 
 	file->deleteLater();
 
+	if (result)
+	{
+		const QString savePath(path.isEmpty() ? m_path : path);
+
+		if (data.size() >= BinaryCacheSizeThreshold)
+		{
+			saveBinaryCache(savePath, QCryptographicHash::hash(data, QCryptographicHash::Md5));
+		}
+		else if (QFile::exists(getBinaryCachePath(savePath)))
+		{
+			QFile::remove(getBinaryCachePath(savePath));
+		}
+	}
+
 	return result;
 }
 
+QString JsonSettings::getBinaryCachePath(const QString &path)
+{
+	return path + QLatin1String(".cbor");
+}
+
+bool JsonSettings::loadBinaryCache(const QString &path, const QByteArray &data)
+{
+	if (data.size() < BinaryCacheSizeThreshold)
+	{
+		return false;
+	}
+
+	QFile file(getBinaryCachePath(path));
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_15);
+
+	quint32 magic(0);
+	quint32 version(0);
+	QByteArray checksum;
+
+	stream >> magic >> version >> checksum;
+
+	if (stream.status() != QDataStream::Ok || magic != BinaryCacheMagic || version != BinaryCacheVersion || checksum != QCryptographicHash::hash(data, QCryptographicHash::Md5))
+	{
+		return false;
+	}
+
+	QString comment;
+	QByteArray document;
+
+	stream >> comment >> document;
+
+	if (stream.status() != QDataStream::Ok)
+	{
+		return false;
+	}
+
+	QCborParserError error;
+	const QCborValue value(QCborValue::fromCbor(document, &error));
+
+	if (error.error != QCborError::NoError)
+	{
+		return false;
+	}
+
+	if (value.isArray())
+	{
+		setArray(value.toArray().toJsonArray());
+	}
+	else if (value.isMap())
+	{
+		setObject(value.toMap().toJsonObject());
+	}
+	else
+	{
+		return false;
+	}
+
+	m_comment = comment;
+
+	return true;
+}
+
 bool JsonSettings::hasError() const
 {
 	return m_hasError;
@@ -40,6 +40,18 @@ public:
 	bool save(const QString &path = {}, bool isAtomic = true);
 	bool hasError() const;
 
+protected:
+	enum BinaryCacheInformation : quint32
+	{
+		BinaryCacheMagic = 0x4f4a5343,
+		BinaryCacheVersion = 1,
+		BinaryCacheSizeThreshold = 65536
+	};
+
+	void saveBinaryCache(const QString &path, const QByteArray &checksum) const;
+	bool loadBinaryCache(const QString &path, const QByteArray &data);
+	static QString getBinaryCachePath(const QString &path);
+
 private:
 	QString m_path;
 	QString m_comment;
@@ -20,13 +20,19 @@
 **************************************************************************/
 
 #include "SettingsManager.h"
+#include "Application.h"
 #include "Utils.h"
 
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
 #include <QtCore/QMetaEnum>
 #include <QtCore/QSettings>
 #include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QTimerEvent>
 #include <QtCore/QVector>
 
 namespace Otter
@@ -36,13 +42,46 @@ SettingsManager* SettingsManager::m_instance(nullptr);
 QString SettingsManager::m_globalPath;
 QString SettingsManager::m_overridePath;
 QVector<SettingsManager::OptionDefinition> SettingsManager::m_definitions;
+QVector<QVariant> SettingsManager::m_globalValues;
+QHash<QString, QHash<int, QVariant> > SettingsManager::m_overrides;
+QVector<SettingsManager::OverridesNode> SettingsManager::m_overridesIndex;
+QCache<QString, QHash<int, QVariant> > SettingsManager::m_resolvedOverrides(1000);
+QMutex SettingsManager::m_resolvedOverridesMutex;
+QCache<QString, std::shared_ptr<const SettingsManager::OptionsSnapshot> > SettingsManager::m_optionsSnapshots(100);
+QMutex SettingsManager::m_optionsSnapshotsMutex;
+QAtomicInt SettingsManager::m_overridesGeneration(0);
+QAtomicInteger<quint64> SettingsManager::m_optionsGeneration(0);
+QHash<QString, QDateTime> SettingsManager::m_modificationTimes;
+QSet<QString> SettingsManager::m_changedPaths;
+QVector<SettingsManager::PendingWrite> SettingsManager::m_pendingWrites;
+QMutex SettingsManager::m_pendingWritesMutex;
+QMutex SettingsManager::m_writerMutex;
+quint64 SettingsManager::m_requestedWritesAmount(0);
+quint64 SettingsManager::m_flushedWritesAmount(0);
+QReadWriteLock SettingsManager::m_valuesLock;
 QHash<QString, int> SettingsManager::m_customOptions;
 int SettingsManager::m_identifierCounter(-1);
 int SettingsManager::m_optionIdentifierEnumerator(0);
 bool SettingsManager::m_hasWildcardedOverrides(false);
 
-SettingsManager::SettingsManager(QObject *parent) : QObject(parent)
+SettingsManager::SettingsManager(QObject *parent) : QObject(parent),
+	m_fileSystemWatcher(new QFileSystemWatcher(this)),
+	m_writeTimer(0)
 {
+	connect(m_fileSystemWatcher, &QFileSystemWatcher::fileChanged, this, &SettingsManager::handleFileChanged);
+	connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &SettingsManager::flush);
+}
+
+void SettingsManager::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() == m_writeTimer)
+	{
+		killTimer(m_writeTimer);
+
+		m_writeTimer = 0;
+
+		QtConcurrent::run(&SettingsManager::writePendingChanges);
+	}
 }
 
 void SettingsManager::createInstance(const QString &path)
@@ -129,7 +168,9 @@ void SettingsManager::createInstance(const QString &path)
 	registerOption(Content_ZoomTextOnlyOption, BooleanType, false);
 	registerOption(ContentBlocking_EnableContentBlockingOption, BooleanType, true);
 	registerOption(ContentBlocking_IgnoreHostsOption, ListType, QStringList());
+	registerOption(ContentBlocking_PendingRequestsPolicyOption, EnumerationType, QLatin1String("allow"), {QLatin1String("allow"), QLatin1String("wait")});
 	registerOption(ContentBlocking_ProfilesOption, ListType, QStringList());
+	registerOption(ContentBlocking_RecordRequestsPathOption, PathType, QString());
 	registerOption(History_BrowsingLimitAmountGlobalOption, IntegerType, 1000);
 	registerOption(History_BrowsingLimitAmountWindowOption, IntegerType, 50);
 	registerOption(History_BrowsingLimitPeriodOption, IntegerType, 30);
@@ -247,67 +288,347 @@ void SettingsManager::createInstance(const QString &path)
 	registerOption(Updates_LastCheckOption, StringType, QString());
 	registerOption(Updates_ServerUrlOption, StringType, QLatin1String("https://www.otter-browser.org/updates/update.json"));
 
-	const QStringList hosts(getOverrideHosts());
+	loadGlobalOptions();
+	loadOverrides();
+	markAsSaved(m_globalPath);
+	markAsSaved(m_overridePath);
+}
+
+void SettingsManager::loadGlobalOptions()
+{
+	const QSettings settings(m_globalPath, QSettings::IniFormat);
+	QVector<QVariant> values(m_definitions.count());
+
+	for (int i = 0; i < m_definitions.count(); ++i)
+	{
+		const QString name(getOptionName(i));
+
+		if (settings.contains(name))
+		{
+			values[i] = convertValue(settings.value(name), m_definitions.at(i).type);
+		}
+	}
+
+	QWriteLocker locker(&m_valuesLock);
+
+	m_globalValues = values;
+
+	m_optionsGeneration.fetchAndAddOrdered(1);
+}
+
+void SettingsManager::loadOverrides()
+{
+	QSettings settings(m_overridePath, QSettings::IniFormat);
+	const QStringList hosts(settings.childGroups());
+	QHash<QString, QHash<int, QVariant> > overrides;
+	overrides.reserve(hosts.count());
+
+	bool hasWildcardedOverrides(false);
 
 	for (int i = 0; i < hosts.count(); ++i)
 	{
-		if (hosts.at(i).startsWith(QLatin1Char('*')))
+		const QString &host(hosts.at(i));
+		QHash<int, QVariant> &values(overrides[host]);
+
+		settings.beginGroup(host);
+
+		const QStringList keys(settings.allKeys());
+
+		for (int j = 0; j < keys.count(); ++j)
 		{
-			m_hasWildcardedOverrides = true;
+			const int identifier(getOptionIdentifier(keys.at(j)));
 
-			break;
+			if (identifier >= 0 && identifier < m_definitions.count())
+			{
+				values[identifier] = convertValue(settings.value(keys.at(j)), m_definitions.at(identifier).type);
+			}
+		}
+
+		settings.endGroup();
+
+		if (host.startsWith(QLatin1Char('*')))
+		{
+			hasWildcardedOverrides = true;
 		}
 	}
+
+	QWriteLocker locker(&m_valuesLock);
+
+	m_overrides = overrides;
+	m_hasWildcardedOverrides = hasWildcardedOverrides;
+
+	updateOverridesIndex();
 }
 
-void SettingsManager::removeOverride(const QString &host, int identifier)
+void SettingsManager::updateOverridesIndex()
 {
-	QSettings settings(m_overridePath, QSettings::IniFormat);
+	QVector<OverridesNode> index(1);
+	QHash<QString, QHash<int, QVariant> >::const_iterator iterator;
 
-	if (identifier >= 0)
+	for (iterator = m_overrides.constBegin(); iterator != m_overrides.constEnd(); ++iterator)
 	{
-		settings.remove(host + QLatin1Char('/') + getOptionName(identifier));
-		settings.sync();
+		const bool isWildcard(iterator.key().startsWith(QLatin1String("*.")));
+		const QStringList labels((isWildcard ? iterator.key().mid(2) : iterator.key()).split(QLatin1Char('.')));
+		int node(0);
 
-		emit m_instance->hostOptionChanged(identifier, getOption(identifier), host);
+		for (int i = (labels.count() - 1); i >= 0; --i)
+		{
+			int child(index.at(node).children.value(labels.at(i), -1));
+
+			if (child < 0)
+			{
+				child = index.count();
+
+				index[node].children[labels.at(i)] = child;
+				index.append(OverridesNode());
+			}
+
+			node = child;
+		}
+
+		if (isWildcard)
+		{
+			index[node].wildcardOverrides = iterator.value();
+			index[node].hasWildcardOverrides = true;
+		}
+		else
+		{
+			index[node].overrides = iterator.value();
+			index[node].hasOverrides = true;
+		}
+	}
+
+	m_overridesIndex = index;
+
+	m_overridesGeneration.fetchAndAddOrdered(1);
+	m_optionsGeneration.fetchAndAddOrdered(1);
+
+	QMutexLocker locker(&m_resolvedOverridesMutex);
+
+	m_resolvedOverrides.clear();
+}
+
+void SettingsManager::markAsSaved(const QString &path)
+{
+	const QFileInfo fileInformation(path);
 
+	{
+		QMutexLocker locker(&m_pendingWritesMutex);
+
+		m_modificationTimes[path] = fileInformation.lastModified();
+	}
+
+	if (!m_instance || !fileInformation.exists())
+	{
 		return;
 	}
 
-	settings.beginGroup(host);
+	if (m_instance->thread() != QThread::currentThread())
+	{
+		QMetaObject::invokeMethod(m_instance, [=]()
+		{
+			markAsSaved(path);
+		}, Qt::QueuedConnection);
+
+		return;
+	}
+
+	if (!m_instance->m_fileSystemWatcher->files().contains(path))
+	{
+		m_instance->m_fileSystemWatcher->addPath(path);
+	}
+
+	reloadChangedFiles();
+}
 
-	const QStringList groups(settings.childGroups());
+void SettingsManager::handleFileChanged(const QString &path)
+{
+	const QFileInfo fileInformation(path);
 
-	if (groups.isEmpty())
+	if (fileInformation.exists() && !m_fileSystemWatcher->files().contains(path))
 	{
+		m_fileSystemWatcher->addPath(path);
+	}
+
+	if (!m_writerMutex.tryLock())
+	{
+		QMutexLocker locker(&m_pendingWritesMutex);
+
+		m_changedPaths.insert(path);
+
 		return;
 	}
 
-	QVector<int> options;
-	options.reserve(groups.count());
+	m_writerMutex.unlock();
 
-	for (int i = 0; i < groups.count(); ++i)
 	{
-		settings.beginGroup(groups.at(i));
+		QMutexLocker locker(&m_pendingWritesMutex);
 
-		const QStringList rawOptions(settings.childKeys());
+		if (fileInformation.lastModified() == m_modificationTimes.value(path))
+		{
+			return;
+		}
 
-		for (int j = 0; j < rawOptions.count(); ++j)
+		if (hasPendingWrites(path))
 		{
-			const int option(getOptionIdentifier(groups.at(i) + QLatin1Char('/') + rawOptions.at(j)));
+			m_changedPaths.insert(path);
+
+			return;
+		}
+
+		m_modificationTimes[path] = fileInformation.lastModified();
+	}
+
+	reloadFile(path);
+}
+
+void SettingsManager::reloadChangedFiles()
+{
+	QStringList paths;
+
+	{
+		QMutexLocker locker(&m_pendingWritesMutex);
+		QSet<QString>::iterator iterator(m_changedPaths.begin());
 
-			if (option >= 0)
+		while (iterator != m_changedPaths.end())
+		{
+			if (hasPendingWrites(*iterator))
+			{
+				++iterator;
+			}
+			else
 			{
-				options.append(option);
+				paths.append(*iterator);
+
+				m_modificationTimes[*iterator] = QFileInfo(*iterator).lastModified();
+
+				iterator = m_changedPaths.erase(iterator);
 			}
 		}
+	}
 
-		settings.endGroup();
+	for (int i = 0; i < paths.count(); ++i)
+	{
+		m_instance->reloadFile(paths.at(i));
+	}
+}
+
+void SettingsManager::reloadFile(const QString &path)
+{
+	if (path == m_globalPath)
+	{
+		QVector<QVariant> previousValues;
+
+		{
+			QReadLocker locker(&m_valuesLock);
+
+			previousValues = m_globalValues;
+		}
+
+		loadGlobalOptions();
+
+		for (int i = 0; i < previousValues.count(); ++i)
+		{
+			if (previousValues.at(i) != m_globalValues.value(i))
+			{
+				emit optionChanged(i, getOption(i));
+			}
+		}
 	}
+	else if (path == m_overridePath)
+	{
+		QHash<QString, QHash<int, QVariant> > previousOverrides;
+
+		{
+			QReadLocker locker(&m_valuesLock);
+
+			previousOverrides = m_overrides;
+		}
+
+		loadOverrides();
+
+		QHash<QString, QHash<int, QVariant> > overrides;
+
+		{
+			QReadLocker locker(&m_valuesLock);
+
+			overrides = m_overrides;
+		}
+
+		QHash<QString, QHash<int, QVariant> >::const_iterator hostsIterator;
+
+		for (hostsIterator = overrides.constBegin(); hostsIterator != overrides.constEnd(); ++hostsIterator)
+		{
+			if (!previousOverrides.contains(hostsIterator.key()))
+			{
+				previousOverrides[hostsIterator.key()] = {};
+			}
+		}
+
+		for (hostsIterator = previousOverrides.constBegin(); hostsIterator != previousOverrides.constEnd(); ++hostsIterator)
+		{
+			const QString &host(hostsIterator.key());
+			const QHash<int, QVariant> &previousValues(hostsIterator.value());
+			const QHash<int, QVariant> values(overrides.value(host));
+			QHash<int, QVariant>::const_iterator valuesIterator;
+
+			for (valuesIterator = previousValues.constBegin(); valuesIterator != previousValues.constEnd(); ++valuesIterator)
+			{
+				if (values.value(valuesIterator.key()) != valuesIterator.value())
+				{
+					emit hostOptionChanged(valuesIterator.key(), getOption(valuesIterator.key(), host), host);
+				}
+			}
 
-	settings.endGroup();
-	settings.remove(host);
-	settings.sync();
+			for (valuesIterator = values.constBegin(); valuesIterator != values.constEnd(); ++valuesIterator)
+			{
+				if (!previousValues.contains(valuesIterator.key()))
+				{
+					emit hostOptionChanged(valuesIterator.key(), valuesIterator.value(), host);
+				}
+			}
+		}
+	}
+}
+
+void SettingsManager::removeOverride(const QString &host, int identifier)
+{
+	if (identifier >= 0)
+	{
+		{
+			QWriteLocker locker(&m_valuesLock);
+
+			if (m_overrides.contains(host))
+			{
+				m_overrides[host].remove(identifier);
+
+				updateOverridesIndex();
+			}
+		}
+
+		saveOption(m_overridePath, (host + QLatin1Char('/') + getOptionName(identifier)), {}, UnknownType);
+
+		emit m_instance->hostOptionChanged(identifier, getOption(identifier), host);
+
+		return;
+	}
+
+	QList<int> options;
+
+	{
+		QWriteLocker locker(&m_valuesLock);
+
+		if (!m_overrides.contains(host))
+		{
+			return;
+		}
+
+		options = m_overrides.take(host).keys();
+
+		updateOverridesIndex();
+	}
+
+	saveOption(m_overridePath, host, {}, UnknownType);
 
 	for (int i = 0; i < options.count(); ++i)
 	{
@@ -329,22 +650,154 @@ void SettingsManager::registerOption(int identifier, OptionType type, const QVar
 
 void SettingsManager::saveOption(const QString &path, const QString &key, const QVariant &value, OptionType type)
 {
-	QSettings settings(path, QSettings::IniFormat);
+	PendingWrite write;
+	write.path = path;
+	write.key = key;
+
+	if (!value.isNull())
+	{
+		write.value = ((type == ColorType) ? convertValue(value, type) : value);
+	}
+
+	{
+		QMutexLocker locker(&m_pendingWritesMutex);
+		const QString groupPrefix(key + QLatin1Char('/'));
+
+		for (int i = (m_pendingWrites.count() - 1); i >= 0; --i)
+		{
+			const PendingWrite &pendingWrite(m_pendingWrites.at(i));
+
+			if (pendingWrite.path == path && (pendingWrite.key == key || (value.isNull() && pendingWrite.key.startsWith(groupPrefix))))
+			{
+				m_pendingWrites.removeAt(i);
+			}
+		}
+
+		m_pendingWrites.append(write);
+
+		++m_requestedWritesAmount;
+	}
+
+	if (!m_instance || Application::isAboutToQuit())
+	{
+		writePendingChanges();
+
+		return;
+	}
+
+	if (m_instance->m_writeTimer != 0)
+	{
+		m_instance->killTimer(m_instance->m_writeTimer);
+	}
+
+	m_instance->m_writeTimer = m_instance->startTimer(500);
+}
+
+void SettingsManager::writePendingChanges()
+{
+	QMutexLocker writerLocker(&m_writerMutex);
+	QVector<PendingWrite> writes;
+
+	{
+		QMutexLocker locker(&m_pendingWritesMutex);
+
+		writes.swap(m_pendingWrites);
+	}
+
+	while (!writes.isEmpty())
+	{
+		const QString path(writes.first().path);
+		quint64 amount(0);
+
+		{
+			QSettings settings(path, QSettings::IniFormat);
+
+			for (int i = 0; i < writes.count(); ++i)
+			{
+				const PendingWrite &write(writes.at(i));
+
+				if (write.path != path)
+				{
+					continue;
+				}
+
+				if (write.value.isNull())
+				{
+					settings.remove(write.key);
+				}
+				else
+				{
+					settings.setValue(write.key, write.value);
+				}
+
+				writes.removeAt(i);
+
+				--i;
+				++amount;
+			}
+
+			settings.sync();
+		}
+
+		{
+			QMutexLocker locker(&m_pendingWritesMutex);
+
+			m_flushedWritesAmount += amount;
+		}
 
-	if (value.isNull())
+		markAsSaved(path);
+	}
+}
+
+bool SettingsManager::hasPendingWrites(const QString &path)
+{
+	for (int i = 0; i < m_pendingWrites.count(); ++i)
 	{
-		settings.remove(key);
+		if (m_pendingWrites.at(i).path == path)
+		{
+			return true;
+		}
 	}
-	else if (type == ColorType)
+
+	return false;
+}
+
+void SettingsManager::flush()
+{
+	if (m_instance && m_instance->m_writeTimer != 0)
 	{
-		const QColor color(value.value<QColor>());
+		m_instance->killTimer(m_instance->m_writeTimer);
 
-		settings.setValue(key, (color.isValid() ? color.name(QColor::HexArgb).toUpper() : QString()));
+		m_instance->m_writeTimer = 0;
 	}
-	else
+
+	writePendingChanges();
+}
+
+QVariant SettingsManager::convertValue(const QVariant &value, OptionType type)
+{
+	switch (type)
 	{
-		settings.setValue(key, value);
+		case BooleanType:
+			return value.toBool();
+		case ColorType:
+			if (value.type() == QVariant::Color)
+			{
+				const QColor color(value.value<QColor>());
+
+				return (color.isValid() ? color.name(QColor::HexArgb).toUpper() : QString());
+			}
+
+			break;
+		case IntegerType:
+			return value.toInt();
+		case ListType:
+			return value.toStringList();
+		default:
+			break;
 	}
+
+	return (value.isValid() ? value : QVariant(QString()));
 }
 
 void SettingsManager::updateOptionDefinition(int identifier, const SettingsManager::OptionDefinition &definition)
@@ -353,6 +806,8 @@ void SettingsManager::updateOptionDefinition(int identifier, const SettingsManag
 	{
 		m_definitions[identifier].defaultValue = definition.defaultValue;
 		m_definitions[identifier].choices = definition.choices;
+
+		m_optionsGeneration.fetchAndAddOrdered(1);
 	}
 }
 
@@ -365,20 +820,31 @@ void SettingsManager::setOption(int identifier, const QVariant &value, const QSt
 	{
 		const QString overrideName(host + QLatin1Char('/') + name);
 
-		if (value.isNull())
-		{
-			QSettings(m_overridePath, QSettings::IniFormat).remove(overrideName);
-		}
-		else
 		{
-			saveOption(m_overridePath, overrideName, value, type);
-		}
+			QWriteLocker locker(&m_valuesLock);
 
-		if (!m_hasWildcardedOverrides && overrideName.startsWith(QLatin1Char('*')))
-		{
-			m_hasWildcardedOverrides = true;
+			if (value.isNull())
+			{
+				if (m_overrides.contains(host))
+				{
+					m_overrides[host].remove(identifier);
+				}
+			}
+			else
+			{
+				m_overrides[host][identifier] = convertValue(value, type);
+			}
+
+			if (!m_hasWildcardedOverrides && overrideName.startsWith(QLatin1Char('*')))
+			{
+				m_hasWildcardedOverrides = true;
+			}
+
+			updateOverridesIndex();
 		}
 
+		saveOption(m_overridePath, overrideName, value, type);
+
 		emit m_instance->hostOptionChanged(identifier, value, host);
 
 		return;
@@ -386,6 +852,17 @@ void SettingsManager::setOption(int identifier, const QVariant &value, const QSt
 
 	if (getOption(identifier) != value)
 	{
+		{
+			QWriteLocker locker(&m_valuesLock);
+
+			if (identifier >= 0 && identifier < m_globalValues.count())
+			{
+				m_globalValues[identifier] = (value.isNull() ? QVariant() : convertValue(value, type));
+			}
+
+			m_optionsGeneration.fetchAndAddOrdered(1);
+		}
+
 		saveOption(m_globalPath, name, value, type);
 
 		emit m_instance->optionChanged(identifier, value);
@@ -445,6 +922,8 @@ QString SettingsManager::createDisplayValue(int identifier, const QVariant &valu
 
 QString SettingsManager::createReport()
 {
+	flush();
+
 	QString report;
 	QTextStream stream(&report);
 	stream.setFieldAlignment(QTextStream::AlignLeft);
@@ -503,6 +982,12 @@ QString SettingsManager::createReport()
 
 	stream << QLatin1Char('\n');
 
+	{
+		QMutexLocker locker(&m_pendingWritesMutex);
+
+		stream << QStringLiteral("\tWrites: %1 requested, %2 flushed, %3 coalesced\n\n").arg(m_requestedWritesAmount).arg(m_flushedWritesAmount).arg(m_requestedWritesAmount - m_flushedWritesAmount - static_cast<quint64>(m_pendingWrites.count()));
+	}
+
 	return report;
 }
 
@@ -537,32 +1022,71 @@ QVariant SettingsManager::getOption(int identifier, const QString &host)
 		return {};
 	}
 
-	const QString name(getOptionName(identifier));
+	if (!host.isEmpty())
+	{
+		const QHash<int, QVariant> overrides(getHostOverrides(host));
+		const QHash<int, QVariant>::const_iterator iterator(overrides.constFind(identifier));
+
+		if (iterator != overrides.constEnd())
+		{
+			return iterator.value();
+		}
+	}
+
+	QReadLocker locker(&m_valuesLock);
+	const QVariant value(m_globalValues.value(identifier));
+
+	return (value.isValid() ? value : m_definitions.at(identifier).defaultValue);
+}
+
+std::shared_ptr<const SettingsManager::OptionsSnapshot> SettingsManager::getOptionsSnapshot(const QString &host)
+{
+	const quint64 generation(m_optionsGeneration.loadAcquire());
 
-	if (host.isEmpty())
 	{
-		return QSettings(m_globalPath, QSettings::IniFormat).value(name, m_definitions.at(identifier).defaultValue);
+		QMutexLocker locker(&m_optionsSnapshotsMutex);
+		const std::shared_ptr<const OptionsSnapshot> *cachedSnapshot(m_optionsSnapshots.object(host));
+
+		if (cachedSnapshot && (*cachedSnapshot)->generation == generation)
+		{
+			return *cachedSnapshot;
+		}
 	}
 
-	const QString overrideName(host + QLatin1Char('/') + name);
-	const QSettings overrides(m_overridePath, QSettings::IniFormat);
+	std::shared_ptr<OptionsSnapshot> snapshot(std::make_shared<OptionsSnapshot>());
+	snapshot->host = host;
+	snapshot->generation = generation;
+
+	const QHash<int, QVariant> overrides(host.isEmpty() ? QHash<int, QVariant>() : getHostOverrides(host));
 
-	if (m_hasWildcardedOverrides && !overrides.contains(overrideName))
 	{
-		const QStringList hostParts(host.split(QLatin1Char('.')));
+		QReadLocker locker(&m_valuesLock);
+
+		snapshot->values.reserve(m_definitions.count());
 
-		for (int i = 1; i < hostParts.count(); ++i)
+		for (int i = 0; i < m_definitions.count(); ++i)
 		{
-			const QString wildcardedName(QLatin1String("*.") + hostParts.mid(i).join(QLatin1Char('.')) + QLatin1Char('/') + name);
+			const QVariant value(m_globalValues.value(i));
 
-			if (overrides.contains(wildcardedName))
-			{
-				return QSettings(m_overridePath, QSettings::IniFormat).value(wildcardedName, getOption(identifier));
-			}
+			snapshot->values.append(value.isValid() ? value : m_definitions.at(i).defaultValue);
 		}
 	}
 
-	return QSettings(m_overridePath, QSettings::IniFormat).value(overrideName, getOption(identifier));
+	QHash<int, QVariant>::const_iterator iterator;
+
+	for (iterator = overrides.constBegin(); iterator != overrides.constEnd(); ++iterator)
+	{
+		if (iterator.key() >= 0 && iterator.key() < snapshot->values.count())
+		{
+			snapshot->values[iterator.key()] = iterator.value();
+		}
+	}
+
+	QMutexLocker locker(&m_optionsSnapshotsMutex);
+
+	m_optionsSnapshots.insert(host, new std::shared_ptr<const OptionsSnapshot>(snapshot));
+
+	return snapshot;
 }
 
 QStringList SettingsManager::getOptions()
@@ -582,24 +1106,22 @@ QStringList SettingsManager::getOptions()
 
 QStringList SettingsManager::getOverrideHosts(int identifier)
 {
-	if (identifier < 0)
-	{
-		return QSettings(m_overridePath, QSettings::IniFormat).childGroups();
-	}
-
-	const QSettings overrides(m_overridePath, QSettings::IniFormat);
-	const QStringList overridesGroups(overrides.childGroups());
+	QReadLocker locker(&m_valuesLock);
 	QStringList hosts;
-	const QString optionName(getOptionName(identifier));
+	hosts.reserve(m_overrides.count());
 
-	for (int i = 0; i < overridesGroups.count(); ++i)
+	QHash<QString, QHash<int, QVariant> >::const_iterator iterator;
+
+	for (iterator = m_overrides.constBegin(); iterator != m_overrides.constEnd(); ++iterator)
 	{
-		if (overrides.contains(overridesGroups.at(i) + QLatin1Char('/') + optionName))
+		if (identifier < 0 || iterator.value().contains(identifier))
 		{
-			hosts.append(overridesGroups.at(i));
+			hosts.append(iterator.key());
 		}
 	}
 
+	hosts.sort();
+
 	return hosts;
 }
 
@@ -612,24 +1134,21 @@ QStringList SettingsManager::getOverridesHierarchy(const QString &host)
 		return hierarchy;
 	}
 
-	const QStringList groups(QSettings(m_overridePath, QSettings::IniFormat).childGroups());
-	const QStringList hostParts(host.split(QLatin1Char('.')));
+	QReadLocker locker(&m_valuesLock);
+	const QVector<QPair<int, int> > path(getOverridesPath(host));
+	const int labelsAmount(host.count(QLatin1Char('.')) + 1);
 
-	for (int i = 0; i < hostParts.count(); ++i)
+	for (int i = (path.count() - 1); i >= 0; --i)
 	{
-		const QString explicitHost(hostParts.mid(i).join(QLatin1Char('.')));
+		const OverridesNode &node(m_overridesIndex.at(path.at(i).first));
+		const QString explicitHost(host.mid(path.at(i).second));
 
-		if (i > 0)
+		if (i < (labelsAmount - 1) && node.hasWildcardOverrides)
 		{
-			const QString wildcardedHost(QLatin1String("*.") + explicitHost);
-
-			if (groups.contains(wildcardedHost))
-			{
-				hierarchy.append(wildcardedHost);
-			}
+			hierarchy.append(QLatin1String("*.") + explicitHost);
 		}
 
-		if (groups.contains(explicitHost))
+		if (node.hasOverrides)
 		{
 			hierarchy.append(explicitHost);
 		}
@@ -638,6 +1157,95 @@ QStringList SettingsManager::getOverridesHierarchy(const QString &host)
 	return hierarchy;
 }
 
+QVector<QPair<int, int> > SettingsManager::getOverridesPath(const QString &host)
+{
+	QVector<QPair<int, int> > path;
+
+	if (m_overridesIndex.isEmpty())
+	{
+		return path;
+	}
+
+	int node(0);
+	int end(host.length());
+
+	while (end > 0)
+	{
+		const int start(host.lastIndexOf(QLatin1Char('.'), (end - 1)) + 1);
+
+		node = m_overridesIndex.at(node).children.value(host.mid(start, (end - start)), -1);
+
+		if (node < 0)
+		{
+			break;
+		}
+
+		path.append({node, start});
+
+		end = (start - 1);
+	}
+
+	return path;
+}
+
+QHash<int, QVariant> SettingsManager::getHostOverrides(const QString &host)
+{
+	{
+		QMutexLocker locker(&m_resolvedOverridesMutex);
+		const QHash<int, QVariant> *overrides(m_resolvedOverrides.object(host));
+
+		if (overrides)
+		{
+			return *overrides;
+		}
+	}
+
+	QHash<int, QVariant> overrides;
+	int generation(0);
+
+	{
+		QReadLocker locker(&m_valuesLock);
+
+		if (m_overrides.isEmpty())
+		{
+			return overrides;
+		}
+
+		generation = m_overridesGeneration.loadAcquire();
+
+		const QVector<QPair<int, int> > path(getOverridesPath(host));
+		const int labelsAmount(host.count(QLatin1Char('.')) + 1);
+
+		for (int i = 0; i < path.count(); ++i)
+		{
+			const OverridesNode &node(m_overridesIndex.at(path.at(i).first));
+			const bool isHost(i == (labelsAmount - 1));
+
+			if ((isHost && !node.hasOverrides) || (!isHost && !node.hasWildcardOverrides))
+			{
+				continue;
+			}
+
+			const QHash<int, QVariant> &nodeOverrides(isHost ? node.overrides : node.wildcardOverrides);
+			QHash<int, QVariant>::const_iterator iterator;
+
+			for (iterator = nodeOverrides.constBegin(); iterator != nodeOverrides.constEnd(); ++iterator)
+			{
+				overrides[iterator.key()] = iterator.value();
+			}
+		}
+	}
+
+	QMutexLocker locker(&m_resolvedOverridesMutex);
+
+	if (generation == m_overridesGeneration.loadAcquire())
+	{
+		m_resolvedOverrides.insert(host, new QHash<int, QVariant>(overrides));
+	}
+
+	return overrides;
+}
+
 SettingsManager::OptionDefinition SettingsManager::getOptionDefinition(int identifier)
 {
 	if (identifier >= 0 && identifier < m_definitions.count())
@@ -670,6 +1278,48 @@ int SettingsManager::registerOption(const QString &name, OptionType type, const
 
 	m_definitions.append(definition);
 
+	const QSettings settings(m_globalPath, QSettings::IniFormat);
+	const QSettings overrides(m_overridePath, QSettings::IniFormat);
+	QHash<QString, QVariant> overridesValues;
+
+	{
+		QReadLocker locker(&m_valuesLock);
+		QHash<QString, QHash<int, QVariant> >::const_iterator iterator;
+
+		for (iterator = m_overrides.constBegin(); iterator != m_overrides.constEnd(); ++iterator)
+		{
+			const QString overrideName(iterator.key() + QLatin1Char('/') + name);
+
+			if (overrides.contains(overrideName))
+			{
+				overridesValues[iterator.key()] = convertValue(overrides.value(overrideName), type);
+			}
+		}
+	}
+
+	QWriteLocker locker(&m_valuesLock);
+
+	m_globalValues.resize(m_definitions.count());
+
+	if (settings.contains(name))
+	{
+		m_globalValues[identifier] = convertValue(settings.value(name), type);
+	}
+
+	QHash<QString, QVariant>::const_iterator iterator;
+
+	for (iterator = overridesValues.constBegin(); iterator != overridesValues.constEnd(); ++iterator)
+	{
+		m_overrides[iterator.key()][identifier] = iterator.value();
+	}
+
+	if (!overridesValues.isEmpty())
+	{
+		updateOverridesIndex();
+	}
+
+	m_optionsGeneration.fetchAndAddOrdered(1);
+
 	return identifier;
 }
 
@@ -693,14 +1343,13 @@ int SettingsManager::getOptionIdentifier(const QString &name)
 
 int SettingsManager::getOverridesCount(int identifier)
 {
-	const QSettings overrides(m_overridePath, QSettings::IniFormat);
-	const QStringList overridesGroups(overrides.childGroups());
-	const QString optionName(getOptionName(identifier));
+	QReadLocker locker(&m_valuesLock);
+	QHash<QString, QHash<int, QVariant> >::const_iterator iterator;
 	int amount(0);
 
-	for (int i = 0; i < overridesGroups.count(); ++i)
+	for (iterator = m_overrides.constBegin(); iterator != m_overrides.constEnd(); ++iterator)
 	{
-		if (overrides.contains(overridesGroups.at(i) + QLatin1Char('/') + optionName))
+		if (iterator.value().contains(identifier))
 		{
 			++amount;
 		}
@@ -709,14 +1358,28 @@ int SettingsManager::getOverridesCount(int identifier)
 	return amount;
 }
 
+quint64 SettingsManager::getOptionsGeneration()
+{
+	return m_optionsGeneration.loadAcquire();
+}
+
+quint64 SettingsManager::getCoalescedWritesAmount()
+{
+	QMutexLocker locker(&m_pendingWritesMutex);
+
+	return (m_requestedWritesAmount - m_flushedWritesAmount - static_cast<quint64>(m_pendingWrites.count()));
+}
+
 bool SettingsManager::hasOverride(const QString &host, int identifier)
 {
+	QReadLocker locker(&m_valuesLock);
+
 	if (identifier < 0)
 	{
-		return QSettings(m_overridePath, QSettings::IniFormat).childGroups().contains(host);
+		return m_overrides.contains(host);
 	}
 
-	return QSettings(m_overridePath, QSettings::IniFormat).contains(host + QLatin1Char('/') + getOptionName(identifier));
+	return m_overrides.value(host).contains(identifier);
 }
 
 }
@@ -22,10 +22,20 @@
 #ifndef OTTER_SETTINGSMANAGER_H
 #define OTTER_SETTINGSMANAGER_H
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QDateTime>
+#include <QtCore/QMutex>
 #include <QtCore/QObject>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QSet>
 #include <QtCore/QVariant>
 #include <QtGui/QIcon>
 
+#include <memory>
+
+class QFileSystemWatcher;
+
 namespace Otter
 {
 
@@ -105,7 +115,9 @@ public:
 		Content_ZoomTextOnlyOption,
 		ContentBlocking_EnableContentBlockingOption,
 		ContentBlocking_IgnoreHostsOption,
+		ContentBlocking_PendingRequestsPolicyOption,
 		ContentBlocking_ProfilesOption,
+		ContentBlocking_RecordRequestsPathOption,
 		History_BrowsingLimitAmountGlobalOption,
 		History_BrowsingLimitAmountWindowOption,
 		History_BrowsingLimitPeriodOption,
@@ -303,7 +315,20 @@ public:
 		}
 	};
 
+	struct OptionsSnapshot final
+	{
+		QString host;
+		QVector<QVariant> values;
+		quint64 generation = 0;
+
+		QVariant getValue(int identifier) const
+		{
+			return values.value(identifier);
+		}
+	};
+
 	static void createInstance(const QString &path);
+	static void flush();
 	static void removeOverride(const QString &host, int identifier = -1);
 	static void updateOptionDefinition(int identifier, const OptionDefinition &definition);
 	static void setOption(int identifier, const QVariant &value, const QString &host = {});
@@ -314,6 +339,7 @@ public:
 	static QString getOverridePath();
 	static QString getOptionName(int identifier);
 	static QVariant getOption(int identifier, const QString &host = {});
+	static std::shared_ptr<const OptionsSnapshot> getOptionsSnapshot(const QString &host = {});
 	static QStringList getOptions();
 	static QStringList getOverrideHosts(int identifier = -1);
 	static QStringList getOverridesHierarchy(const QString &host);
@@ -321,19 +347,73 @@ public:
 	static int registerOption(const QString &name, OptionType type, const QVariant &defaultValue = {}, const QStringList &choices = {}, OptionDefinition::OptionFlags flags = static_cast<OptionDefinition::OptionFlags>(OptionDefinition::IsEnabledFlag | OptionDefinition::IsVisibleFlag));
 	static int getOptionIdentifier(const QString &name);
 	static int getOverridesCount(int identifier);
+	static quint64 getOptionsGeneration();
+	static quint64 getCoalescedWritesAmount();
 	static bool hasOverride(const QString &host, int identifier = -1);
 
 protected:
+	struct OverridesNode final
+	{
+		QHash<QString, int> children;
+		QHash<int, QVariant> overrides;
+		QHash<int, QVariant> wildcardOverrides;
+		bool hasOverrides = false;
+		bool hasWildcardOverrides = false;
+	};
+
+	struct PendingWrite final
+	{
+		QString path;
+		QString key;
+		QVariant value;
+	};
+
 	explicit SettingsManager(QObject *parent);
 
+	void timerEvent(QTimerEvent *event) override;
+
 	static void registerOption(int identifier, OptionType type, const QVariant &defaultValue = {}, const QStringList &choices = {}, OptionDefinition::OptionFlags flags = static_cast<OptionDefinition::OptionFlags>(OptionDefinition::IsEnabledFlag | OptionDefinition::IsVisibleFlag | OptionDefinition::IsBuiltInFlag));
 	static void saveOption(const QString &path, const QString &key, const QVariant &value, OptionType type);
+	static void writePendingChanges();
+	static void loadGlobalOptions();
+	static void loadOverrides();
+	static void markAsSaved(const QString &path);
+	static void reloadChangedFiles();
+	static void updateOverridesIndex();
+	static QVector<QPair<int, int> > getOverridesPath(const QString &host);
+	static QHash<int, QVariant> getHostOverrides(const QString &host);
+	static QVariant convertValue(const QVariant &value, OptionType type);
+	static bool hasPendingWrites(const QString &path);
+	void reloadFile(const QString &path);
+
+protected slots:
+	void handleFileChanged(const QString &path);
 
 private:
+	QFileSystemWatcher *m_fileSystemWatcher;
+	int m_writeTimer;
+
 	static SettingsManager *m_instance;
 	static QString m_globalPath;
 	static QString m_overridePath;
 	static QVector<OptionDefinition> m_definitions;
+	static QVector<QVariant> m_globalValues;
+	static QHash<QString, QHash<int, QVariant> > m_overrides;
+	static QVector<OverridesNode> m_overridesIndex;
+	static QCache<QString, QHash<int, QVariant> > m_resolvedOverrides;
+	static QMutex m_resolvedOverridesMutex;
+	static QCache<QString, std::shared_ptr<const OptionsSnapshot> > m_optionsSnapshots;
+	static QMutex m_optionsSnapshotsMutex;
+	static QAtomicInt m_overridesGeneration;
+	static QAtomicInteger<quint64> m_optionsGeneration;
+	static QHash<QString, QDateTime> m_modificationTimes;
+	static QSet<QString> m_changedPaths;
+	static QVector<PendingWrite> m_pendingWrites;
+	static QMutex m_pendingWritesMutex;
+	static QMutex m_writerMutex;
+	static quint64 m_requestedWritesAmount;
+	static quint64 m_flushedWritesAmount;
+	static QReadWriteLock m_valuesLock;
 	static QHash<QString, int> m_customOptions;
 	static int m_identifierCounter;
 	static int m_optionIdentifierEnumerator;
@@ -34,23 +34,31 @@ WebBackend* QtWebEngineUrlRequestInterceptor::m_backend(nullptr);
 
 QtWebEngineUrlRequestInterceptor::QtWebEngineUrlRequestInterceptor(QtWebEngineWebWidget *parent) : QWebEngineUrlRequestInterceptor(parent),
 	m_widget(parent),
-	m_doNotTrackPolicy(NetworkManagerFactory::SkipTrackPolicy),
-	m_areImagesEnabled(true),
-	m_canSendReferrer(true),
-	m_isWorkingOffline(false)
+	m_options(std::make_shared<RequestOptions>()),
+	m_pendingBlockedRequests(nullptr),
+	m_startedRequestsAmount(0)
 {
+	connect(ContentFiltersManager::getInstance(), &ContentFiltersManager::profileAdded, this, &QtWebEngineUrlRequestInterceptor::updateContentBlockingProfiles);
+	connect(ContentFiltersManager::getInstance(), &ContentFiltersManager::profileRemoved, this, &QtWebEngineUrlRequestInterceptor::updateContentBlockingProfiles);
+}
+
+QtWebEngineUrlRequestInterceptor::~QtWebEngineUrlRequestInterceptor()
+{
+	deleteBlockedRequests(m_pendingBlockedRequests.fetchAndStoreAcquire(nullptr));
 }
 
 void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo &request)
 {
-	if (m_isWorkingOffline || (!m_areImagesEnabled && request.resourceType() == QWebEngineUrlRequestInfo::ResourceTypeImage))
+	const std::shared_ptr<const RequestOptions> options(std::atomic_load(&m_options));
+
+	if (options->isWorkingOffline || (!options->areImagesEnabled && request.resourceType() == QWebEngineUrlRequestInfo::ResourceTypeImage))
 	{
 		request.block(true);
 
 		return;
 	}
 
-	if (!m_contentBlockingProfiles.isEmpty() && (m_unblockedHosts.isEmpty() || !m_unblockedHosts.contains(Utils::extractHost(request.firstPartyUrl()))))
+	if (!options->contentBlockingProfiles.isEmpty() && (options->unblockedHosts.isEmpty() || !options->unblockedHosts.contains(Utils::extractHost(request.firstPartyUrl()))))
 	{
 		NetworkManager::ResourceType resourceType(NetworkManager::OtherType);
 		bool storeBlockedUrl(true);
@@ -97,29 +105,18 @@ void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo
 				break;
 		}
 
-		const ContentFiltersManager::CheckResult result(ContentFiltersManager::checkUrl(m_contentBlockingProfiles, request.firstPartyUrl(), request.requestUrl(), resourceType));
+		const ContentFiltersManager::CheckResult result(ContentFiltersManager::checkUrl(options->contentBlockingProfiles, request.firstPartyUrl(), request.requestUrl(), resourceType));
 
 		if (result.isBlocked)
 		{
-			const ContentFiltersProfile *profile(ContentFiltersManager::getProfile(result.profile));
-
-			Console::addMessage(QCoreApplication::translate("main", "Request blocked by rule from profile %1:\n%2").arg(profile ? profile->getTitle() : QCoreApplication::translate("main", "(Unknown)"), result.rule), Console::NetworkCategory, Console::LogLevel, request.requestUrl().toString(), -1);
+			BlockedRequest *blockedRequest(new BlockedRequest());
+			blockedRequest->resource.url = request.requestUrl();
+			blockedRequest->resource.resourceType = resourceType;
+			blockedRequest->resource.metaData[NetworkManager::ContentBlockingProfileMetaData] = result.profile;
+			blockedRequest->resource.metaData[NetworkManager::ContentBlockingRuleMetaData] = result.rule;
+			blockedRequest->storeBlockedUrl = storeBlockedUrl;
 
-			if (storeBlockedUrl && !m_blockedElements.contains(request.requestUrl().url()))
-			{
-				m_blockedElements.append(request.requestUrl().url());
-			}
-
-			NetworkManager::ResourceInformation resource;
-			resource.url = request.requestUrl();
-			resource.resourceType = resourceType;
-			resource.metaData[NetworkManager::ContentBlockingProfileMetaData] = result.profile;
-			resource.metaData[NetworkManager::ContentBlockingRuleMetaData] = result.rule;
-
-			m_blockedRequests.append(resource);
-
-			emit pageInformationChanged(WebWidget::RequestsBlockedInformation, m_blockedRequests.count());
-			emit requestBlocked(resource);
+			queueBlockedRequest(blockedRequest);
 
 			request.block(true);
 
@@ -127,72 +124,167 @@ void QtWebEngineUrlRequestInterceptor::interceptRequest(QWebEngineUrlRequestInfo
 		}
 	}
 
-	++m_startedRequestsAmount;
+	const quint64 startedRequestsAmount(m_startedRequestsAmount.fetchAndAddRelaxed(1) + 1);
 
-	request.setHttpHeader(QByteArrayLiteral("Accept-Language"), (m_acceptLanguage.isEmpty() ? NetworkManagerFactory::getAcceptLanguage().toLatin1() : m_acceptLanguage.toLatin1()));
-	request.setHttpHeader(QByteArrayLiteral("User-Agent"), m_userAgent.toUtf8());
+	request.setHttpHeader(QByteArrayLiteral("Accept-Language"), (options->acceptLanguage.isEmpty() ? NetworkManagerFactory::getAcceptLanguage().toLatin1() : options->acceptLanguage.toLatin1()));
+	request.setHttpHeader(QByteArrayLiteral("User-Agent"), options->userAgent.toUtf8());
 
-	if (m_doNotTrackPolicy != NetworkManagerFactory::SkipTrackPolicy)
+	if (options->doNotTrackPolicy != NetworkManagerFactory::SkipTrackPolicy)
 	{
-		request.setHttpHeader(QByteArrayLiteral("DNT"), ((m_doNotTrackPolicy == NetworkManagerFactory::DoNotAllowToTrackPolicy) ? QByteArrayLiteral("1") : QByteArrayLiteral("0")));
+		request.setHttpHeader(QByteArrayLiteral("DNT"), ((options->doNotTrackPolicy == NetworkManagerFactory::DoNotAllowToTrackPolicy) ? QByteArrayLiteral("1") : QByteArrayLiteral("0")));
 	}
 
-	if (!m_canSendReferrer)
+	if (!options->canSendReferrer)
 	{
 		request.setHttpHeader(QByteArrayLiteral("Referer"), {});
 	}
 
-	emit pageInformationChanged(WebWidget::RequestsStartedInformation, m_startedRequestsAmount);
+	emit pageInformationChanged(WebWidget::RequestsStartedInformation, startedRequestsAmount);
+}
+
+void QtWebEngineUrlRequestInterceptor::queueBlockedRequest(BlockedRequest *request)
+{
+	BlockedRequest *head(m_pendingBlockedRequests.loadRelaxed());
+
+	do
+	{
+		request->next = head;
+	}
+	while (!m_pendingBlockedRequests.testAndSetOrdered(head, request, head));
+
+	if (!head)
+	{
+		QMetaObject::invokeMethod(this, &QtWebEngineUrlRequestInterceptor::handleBlockedRequests, Qt::QueuedConnection);
+	}
+}
+
+void QtWebEngineUrlRequestInterceptor::deleteBlockedRequests(BlockedRequest *request)
+{
+	while (request)
+	{
+		BlockedRequest *next(request->next);
+
+		delete request;
+
+		request = next;
+	}
 }
 
 void QtWebEngineUrlRequestInterceptor::resetStatistics()
 {
+	deleteBlockedRequests(m_pendingBlockedRequests.fetchAndStoreAcquire(nullptr));
+
 	m_blockedRequests.clear();
 	m_blockedElements.clear();
-	m_startedRequestsAmount = 0;
+	m_startedRequestsAmount.storeRelaxed(0);
+}
+
+void QtWebEngineUrlRequestInterceptor::handleBlockedRequests()
+{
+	BlockedRequest *request(m_pendingBlockedRequests.fetchAndStoreAcquire(nullptr));
+	BlockedRequest *previousRequest(nullptr);
+
+	while (request)
+	{
+		BlockedRequest *next(request->next);
+		request->next = previousRequest;
+		previousRequest = request;
+		request = next;
+	}
+
+	if (!previousRequest)
+	{
+		return;
+	}
+
+	request = previousRequest;
+
+	while (request)
+	{
+		const NetworkManager::ResourceInformation &resource(request->resource);
+		const QString url(resource.url.url());
+		const ContentFiltersProfile *profile(ContentFiltersManager::getProfile(resource.metaData.value(NetworkManager::ContentBlockingProfileMetaData).toInt()));
+
+		Console::addMessage(QCoreApplication::translate("main", "Request blocked by rule from profile %1:\n%2").arg(profile ? profile->getTitle() : QCoreApplication::translate("main", "(Unknown)"), resource.metaData.value(NetworkManager::ContentBlockingRuleMetaData).toString()), Console::NetworkCategory, Console::LogLevel, resource.url.toString(), -1);
+
+		if (request->storeBlockedUrl && !m_blockedElements.contains(url))
+		{
+			m_blockedElements.append(url);
+		}
+
+		m_blockedRequests.append(resource);
+
+		emit requestBlocked(resource);
+
+		BlockedRequest *next(request->next);
+
+		delete request;
+
+		request = next;
+	}
+
+	emit pageInformationChanged(WebWidget::RequestsBlockedInformation, m_blockedRequests.count());
 }
 
 void QtWebEngineUrlRequestInterceptor::updateOptions(const QUrl &url)
 {
-	if (!m_backend)
+	const std::shared_ptr<const SettingsManager::OptionsSnapshot> optionsSnapshot(getOptionsSnapshot(url));
+
+	if (optionsSnapshot == m_optionsSnapshot)
 	{
-		m_backend = AddonsManager::getWebBackend(QLatin1String("qtwebengine"));
+		return;
 	}
 
-	if (getOption(SettingsManager::ContentBlocking_EnableContentBlockingOption, url).toBool())
+	m_optionsSnapshot = optionsSnapshot;
+
+	if (!m_backend)
 	{
-		m_contentBlockingProfiles = ContentFiltersManager::getProfileIdentifiers(getOption(SettingsManager::ContentBlocking_ProfilesOption, url).toStringList());
+		m_backend = AddonsManager::getWebBackend(QLatin1String("qtwebengine"));
 	}
-	else
+
+	std::shared_ptr<RequestOptions> options(std::make_shared<RequestOptions>());
+
+	if (optionsSnapshot->getValue(SettingsManager::ContentBlocking_EnableContentBlockingOption).toBool())
 	{
-		m_contentBlockingProfiles.clear();
+		options->contentBlockingProfiles = ContentFiltersManager::getProfileIdentifiers(optionsSnapshot->getValue(SettingsManager::ContentBlocking_ProfilesOption).toStringList());
 	}
 
-	QString acceptLanguage(getOption(SettingsManager::Network_AcceptLanguageOption, url).toString());
+	QString acceptLanguage(optionsSnapshot->getValue(SettingsManager::Network_AcceptLanguageOption).toString());
 	acceptLanguage = ((acceptLanguage.isEmpty()) ? QLatin1String(" ") : acceptLanguage.replace(QLatin1String("system"), QLocale::system().bcp47Name()));
 
-	m_acceptLanguage = ((acceptLanguage == NetworkManagerFactory::getAcceptLanguage()) ? QString() : acceptLanguage);
-	m_userAgent = m_backend->getUserAgent(NetworkManagerFactory::getUserAgent(getOption(SettingsManager::Network_UserAgentOption, url).toString()).value);
-	m_unblockedHosts = getOption(SettingsManager::ContentBlocking_IgnoreHostsOption, url).toStringList();
+	options->acceptLanguage = ((acceptLanguage == NetworkManagerFactory::getAcceptLanguage()) ? QString() : acceptLanguage);
+	options->userAgent = m_backend->getUserAgent(NetworkManagerFactory::getUserAgent(optionsSnapshot->getValue(SettingsManager::Network_UserAgentOption).toString()).value);
+	options->unblockedHosts = optionsSnapshot->getValue(SettingsManager::ContentBlocking_IgnoreHostsOption).toStringList();
 
-	const QString doNotTrackPolicyValue(getOption(SettingsManager::Network_DoNotTrackPolicyOption, url).toString());
+	const QString doNotTrackPolicyValue(optionsSnapshot->getValue(SettingsManager::Network_DoNotTrackPolicyOption).toString());
 
 	if (doNotTrackPolicyValue == QLatin1String("allow"))
 	{
-		m_doNotTrackPolicy = NetworkManagerFactory::AllowToTrackPolicy;
+		options->doNotTrackPolicy = NetworkManagerFactory::AllowToTrackPolicy;
 	}
 	else if (doNotTrackPolicyValue == QLatin1String("doNotAllow"))
 	{
-		m_doNotTrackPolicy = NetworkManagerFactory::DoNotAllowToTrackPolicy;
+		options->doNotTrackPolicy = NetworkManagerFactory::DoNotAllowToTrackPolicy;
 	}
-	else
+
+	options->areImagesEnabled = (optionsSnapshot->getValue(SettingsManager::Permissions_EnableImagesOption).toString() != QLatin1String("disabled"));
+	options->canSendReferrer = optionsSnapshot->getValue(SettingsManager::Network_EnableReferrerOption).toBool();
+	options->isWorkingOffline = optionsSnapshot->getValue(SettingsManager::Network_WorkOfflineOption).toBool();
+
+	std::atomic_store(&m_options, std::shared_ptr<const RequestOptions>(options));
+}
+
+void QtWebEngineUrlRequestInterceptor::updateContentBlockingProfiles()
+{
+	if (!m_optionsSnapshot || !m_optionsSnapshot->getValue(SettingsManager::ContentBlocking_EnableContentBlockingOption).toBool())
 	{
-		m_doNotTrackPolicy = NetworkManagerFactory::SkipTrackPolicy;
+		return;
 	}
 
-	m_areImagesEnabled = (getOption(SettingsManager::Permissions_EnableImagesOption, url).toString() != QLatin1String("disabled"));
-	m_canSendReferrer = getOption(SettingsManager::Network_EnableReferrerOption, url).toBool();
-	m_isWorkingOffline = getOption(SettingsManager::Network_WorkOfflineOption, url).toBool();
+	std::shared_ptr<RequestOptions> options(std::make_shared<RequestOptions>(*std::atomic_load(&m_options)));
+	options->contentBlockingProfiles = ContentFiltersManager::getProfileIdentifiers(m_optionsSnapshot->getValue(SettingsManager::ContentBlocking_ProfilesOption).toStringList());
+
+	std::atomic_store(&m_options, std::shared_ptr<const RequestOptions>(options));
 }
 
 QVariant QtWebEngineUrlRequestInterceptor::getOption(int identifier, const QUrl &url) const
@@ -200,6 +292,11 @@ QVariant QtWebEngineUrlRequestInterceptor::getOption(int identifier, const QUrl
 	return (m_widget ? m_widget->getOption(identifier, url) : SettingsManager::getOption(identifier, Utils::extractHost(url)));
 }
 
+std::shared_ptr<const SettingsManager::OptionsSnapshot> QtWebEngineUrlRequestInterceptor::getOptionsSnapshot(const QUrl &url) const
+{
+	return (m_widget ? m_widget->getOptionsSnapshot(url) : SettingsManager::getOptionsSnapshot(Utils::extractHost(url)));
+}
+
 QVariant QtWebEngineUrlRequestInterceptor::getPageInformation(WebWidget::PageInformation key) const
 {
 	switch (key)
@@ -208,7 +305,7 @@ QVariant QtWebEngineUrlRequestInterceptor::getPageInformation(WebWidget::PageInf
 			return m_blockedRequests.count();
 
 		case WebWidget::RequestsStartedInformation:
-			return m_startedRequestsAmount;
+			return m_startedRequestsAmount.loadRelaxed();
 		default:
 			break;
 	}
@@ -27,6 +27,8 @@
 
 #include <QtWebEngineCore/QWebEngineUrlRequestInterceptor>
 
+#include <memory>
+
 namespace Otter
 {
 
@@ -36,32 +38,52 @@ class QtWebEngineUrlRequestInterceptor final : public QWebEngineUrlRequestInterc
 
 public:
 	explicit QtWebEngineUrlRequestInterceptor(QtWebEngineWebWidget *parent);
+	~QtWebEngineUrlRequestInterceptor();
 
 	void interceptRequest(QWebEngineUrlRequestInfo &request) override;
 	QStringList getBlockedElements() const;
 	QVector<NetworkManager::ResourceInformation> getBlockedRequests() const;
 
 protected:
+	struct RequestOptions final
+	{
+		QString acceptLanguage;
+		QString userAgent;
+		QStringList unblockedHosts;
+		QVector<int> contentBlockingProfiles;
+		NetworkManagerFactory::DoNotTrackPolicy doNotTrackPolicy = NetworkManagerFactory::SkipTrackPolicy;
+		bool areImagesEnabled = true;
+		bool canSendReferrer = true;
+		bool isWorkingOffline = false;
+	};
+
+	struct BlockedRequest final
+	{
+		NetworkManager::ResourceInformation resource;
+		BlockedRequest *next = nullptr;
+		bool storeBlockedUrl = true;
+	};
+
 	void updateOptions(const QUrl &url);
+	void queueBlockedRequest(BlockedRequest *request);
+	static void deleteBlockedRequests(BlockedRequest *request);
 	QVariant getOption(int identifier, const QUrl &url) const;
+	std::shared_ptr<const SettingsManager::OptionsSnapshot> getOptionsSnapshot(const QUrl &url) const;
 	QVariant getPageInformation(WebWidget::PageInformation key) const;
 
 protected slots:
 	void resetStatistics();
+	void handleBlockedRequests();
+	void updateContentBlockingProfiles();
 
 private:
 	QtWebEngineWebWidget *m_widget;
-	QString m_acceptLanguage;
-	QString m_userAgent;
+	std::shared_ptr<const RequestOptions> m_options;
+	std::shared_ptr<const SettingsManager::OptionsSnapshot> m_optionsSnapshot;
 	QStringList m_blockedElements;
-	QStringList m_unblockedHosts;
 	QVector<NetworkManager::ResourceInformation> m_blockedRequests;
-	QVector<int> m_contentBlockingProfiles;
-	NetworkManagerFactory::DoNotTrackPolicy m_doNotTrackPolicy;
-	quint64 m_startedRequestsAmount;
-	bool m_areImagesEnabled;
-	bool m_canSendReferrer;
-	bool m_isWorkingOffline;
+	QAtomicPointer<BlockedRequest> m_pendingBlockedRequests;
+	QAtomicInteger<quint64> m_startedRequestsAmount;
 
 	static WebBackend *m_backend;
 
@@ -1215,22 +1215,23 @@ void QtWebEngineWebWidget::notifyWatchedDataChanged(ChangeWatcher watcher)
 
 void QtWebEngineWebWidget::updateOptions(const QUrl &url)
 {
-	const QString encoding(getOption(SettingsManager::Content_DefaultCharacterEncodingOption, url).toString());
+	const std::shared_ptr<const SettingsManager::OptionsSnapshot> options(getOptionsSnapshot(url));
+	const QString encoding(options->getValue(SettingsManager::Content_DefaultCharacterEncodingOption).toString());
 	QWebEngineSettings *settings(m_page->settings());
-	settings->setAttribute(QWebEngineSettings::AllowRunningInsecureContent, getOption(SettingsManager::Security_AllowMixedContentOption, url).toBool());
-	settings->setAttribute(QWebEngineSettings::AutoLoadImages, (getOption(SettingsManager::Permissions_EnableImagesOption, url).toString() != QLatin1String("onlyCached")));
-	settings->setAttribute(QWebEngineSettings::DnsPrefetchEnabled, getOption(SettingsManager::Network_EnableDnsPrefetchOption, url).toBool());
-	settings->setAttribute(QWebEngineSettings::JavascriptEnabled, getOption(SettingsManager::Permissions_EnableJavaScriptOption, url).toBool());
-	settings->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, getOption(SettingsManager::Permissions_ScriptsCanAccessClipboardOption, url).toBool());
-	settings->setAttribute(QWebEngineSettings::JavascriptCanOpenWindows, (getOption(SettingsManager::Permissions_ScriptsCanOpenWindowsOption, url).toString() != QLatin1String("blockAll")));
-	settings->setAttribute(QWebEngineSettings::LocalStorageEnabled, getOption(SettingsManager::Permissions_EnableLocalStorageOption, url).toBool());
-	settings->setAttribute(QWebEngineSettings::ShowScrollBars, getOption(SettingsManager::Interface_ShowScrollBarsOption, url).toBool());
-	settings->setAttribute(QWebEngineSettings::WebGLEnabled, getOption(SettingsManager::Permissions_EnableWebglOption, url).toBool());
+	settings->setAttribute(QWebEngineSettings::AllowRunningInsecureContent, options->getValue(SettingsManager::Security_AllowMixedContentOption).toBool());
+	settings->setAttribute(QWebEngineSettings::AutoLoadImages, (options->getValue(SettingsManager::Permissions_EnableImagesOption).toString() != QLatin1String("onlyCached")));
+	settings->setAttribute(QWebEngineSettings::DnsPrefetchEnabled, options->getValue(SettingsManager::Network_EnableDnsPrefetchOption).toBool());
+	settings->setAttribute(QWebEngineSettings::JavascriptEnabled, options->getValue(SettingsManager::Permissions_EnableJavaScriptOption).toBool());
+	settings->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, options->getValue(SettingsManager::Permissions_ScriptsCanAccessClipboardOption).toBool());
+	settings->setAttribute(QWebEngineSettings::JavascriptCanOpenWindows, (options->getValue(SettingsManager::Permissions_ScriptsCanOpenWindowsOption).toString() != QLatin1String("blockAll")));
+	settings->setAttribute(QWebEngineSettings::LocalStorageEnabled, options->getValue(SettingsManager::Permissions_EnableLocalStorageOption).toBool());
+	settings->setAttribute(QWebEngineSettings::ShowScrollBars, options->getValue(SettingsManager::Interface_ShowScrollBarsOption).toBool());
+	settings->setAttribute(QWebEngineSettings::WebGLEnabled, options->getValue(SettingsManager::Permissions_EnableWebglOption).toBool());
 	settings->setDefaultTextEncoding((encoding == QLatin1String("auto")) ? QString() : encoding);
 
 	disconnect(m_page, &QtWebEnginePage::geometryChangeRequested, this, &QtWebEngineWebWidget::requestedGeometryChange);
 
-	if (getOption(SettingsManager::Permissions_ScriptsCanChangeWindowGeometryOption, url).toBool())
+	if (options->getValue(SettingsManager::Permissions_ScriptsCanChangeWindowGeometryOption).toBool())
 	{
 		connect(m_page, &QtWebEnginePage::geometryChangeRequested, this, &QtWebEngineWebWidget::requestedGeometryChange);
 	}
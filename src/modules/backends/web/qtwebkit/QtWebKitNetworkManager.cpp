@@ -65,6 +65,7 @@ QtWebKitNetworkManager::QtWebKitNetworkManager(bool isPrivate, QtWebKitCookieJar
 	m_loadingSpeedTimer(0),
 	m_areImagesEnabled(true),
 	m_canSendReferrer(true),
+	m_hasPendingRequests(false),
 	m_isWorkingOffline(false)
 {
 	NetworkManagerFactory::initialize();
@@ -100,6 +101,17 @@ QtWebKitNetworkManager::QtWebKitNetworkManager(bool isPrivate, QtWebKitCookieJar
 	connect(this, &QtWebKitNetworkManager::authenticationRequired, this, &QtWebKitNetworkManager::handleAuthenticationRequired);
 	connect(this, &QtWebKitNetworkManager::proxyAuthenticationRequired, this, &QtWebKitNetworkManager::handleProxyAuthenticationRequired);
 	connect(this, &QtWebKitNetworkManager::sslErrors, this, &QtWebKitNetworkManager::handleSslErrors);
+	connect(ContentFiltersManager::getInstance(), &ContentFiltersManager::profileAdded, this, &QtWebKitNetworkManager::updateContentBlockingProfiles);
+	connect(ContentFiltersManager::getInstance(), &ContentFiltersManager::profileRemoved, this, &QtWebKitNetworkManager::updateContentBlockingProfiles);
+	connect(ContentFiltersManager::getInstance(), &ContentFiltersManager::profileLoaded, this, [&]()
+	{
+		if (m_hasPendingRequests && m_widget)
+		{
+			m_hasPendingRequests = false;
+
+			m_widget->triggerAction(ActionsManager::ReloadAction);
+		}
+	});
 #if QT_VERSION < 0x060000
 	connect(NetworkManagerFactory::getInstance(), &NetworkManagerFactory::onlineStateChanged, this, [&](bool isOnline)
 	{
@@ -152,6 +164,7 @@ void QtWebKitNetworkManager::resetStatistics()
 	m_contentState = WebWidget::UnknownContentState;
 	m_isSecureValue = UnknownValue;
 	m_bytesReceivedDifference = 0;
+	m_hasPendingRequests = false;
 
 	updateLoadingSpeed();
 
@@ -441,28 +454,30 @@ void QtWebKitNetworkManager::updateLoadingSpeed()
 
 void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 {
-	if (!m_backend)
-	{
-		m_backend = AddonsManager::getWebBackend(QLatin1String("qtwebkit"));
-	}
+	const std::shared_ptr<const SettingsManager::OptionsSnapshot> options(getOptionsSnapshot(url));
 
-	if (getOption(SettingsManager::ContentBlocking_EnableContentBlockingOption, url).toBool())
+	if (options == m_optionsSnapshot)
 	{
-		m_contentBlockingProfiles = ContentFiltersManager::getProfileIdentifiers(getOption(SettingsManager::ContentBlocking_ProfilesOption, url).toStringList());
+		return;
 	}
-	else
+
+	m_optionsSnapshot = options;
+
+	if (!m_backend)
 	{
-		m_contentBlockingProfiles.clear();
+		m_backend = AddonsManager::getWebBackend(QLatin1String("qtwebkit"));
 	}
 
-	QString acceptLanguage(getOption(SettingsManager::Network_AcceptLanguageOption, url).toString());
+	updateContentBlockingProfiles();
+
+	QString acceptLanguage(options->getValue(SettingsManager::Network_AcceptLanguageOption).toString());
 	acceptLanguage = ((acceptLanguage.isEmpty()) ? QLatin1String(" ") : acceptLanguage.replace(QLatin1String("system"), QLocale::system().bcp47Name()));
 
 	m_acceptLanguage = ((acceptLanguage == NetworkManagerFactory::getAcceptLanguage()) ? QString() : acceptLanguage);
-	m_userAgent = m_backend->getUserAgent(NetworkManagerFactory::getUserAgent(getOption(SettingsManager::Network_UserAgentOption, url).toString()).value);
-	m_unblockedHosts = getOption(SettingsManager::ContentBlocking_IgnoreHostsOption, url).toStringList();
+	m_userAgent = m_backend->getUserAgent(NetworkManagerFactory::getUserAgent(options->getValue(SettingsManager::Network_UserAgentOption).toString()).value);
+	m_unblockedHosts = options->getValue(SettingsManager::ContentBlocking_IgnoreHostsOption).toStringList();
 
-	const QString doNotTrackPolicyValue(getOption(SettingsManager::Network_DoNotTrackPolicyOption, url).toString());
+	const QString doNotTrackPolicyValue(options->getValue(SettingsManager::Network_DoNotTrackPolicyOption).toString());
 
 	if (doNotTrackPolicyValue == QLatin1String("allow"))
 	{
@@ -477,11 +492,11 @@ void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 		m_doNotTrackPolicy = NetworkManagerFactory::SkipTrackPolicy;
 	}
 
-	m_areImagesEnabled = (getOption(SettingsManager::Permissions_EnableImagesOption, url).toString() != QLatin1String("disabled"));
-	m_canSendReferrer = getOption(SettingsManager::Network_EnableReferrerOption, url).toBool();
-	m_isWorkingOffline = getOption(SettingsManager::Network_WorkOfflineOption, url).toBool();
+	m_areImagesEnabled = (options->getValue(SettingsManager::Permissions_EnableImagesOption).toString() != QLatin1String("disabled"));
+	m_canSendReferrer = options->getValue(SettingsManager::Network_EnableReferrerOption).toBool();
+	m_isWorkingOffline = options->getValue(SettingsManager::Network_WorkOfflineOption).toBool();
 
-	const QString generalCookiesPolicyValue(getOption(SettingsManager::Network_CookiesPolicyOption, url).toString());
+	const QString generalCookiesPolicyValue(options->getValue(SettingsManager::Network_CookiesPolicyOption).toString());
 	CookieJar::CookiesPolicy generalCookiesPolicy(CookieJar::AcceptAllCookies);
 
 	if (generalCookiesPolicyValue == QLatin1String("ignore"))
@@ -497,7 +512,7 @@ void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 		generalCookiesPolicy = CookieJar::AcceptExistingCookies;
 	}
 
-	const QString thirdPartyCookiesPolicyValue(getOption(SettingsManager::Network_ThirdPartyCookiesPolicyOption, url).toString());
+	const QString thirdPartyCookiesPolicyValue(options->getValue(SettingsManager::Network_ThirdPartyCookiesPolicyOption).toString());
 	CookieJar::CookiesPolicy thirdPartyCookiesPolicy(CookieJar::AcceptAllCookies);
 
 	if (thirdPartyCookiesPolicyValue == QLatin1String("ignore"))
@@ -513,7 +528,7 @@ void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 		thirdPartyCookiesPolicy = CookieJar::AcceptExistingCookies;
 	}
 
-	const QString keepCookiesModeValue(getOption(SettingsManager::Network_CookiesKeepModeOption, url).toString());
+	const QString keepCookiesModeValue(options->getValue(SettingsManager::Network_CookiesKeepModeOption).toString());
 	CookieJar::KeepMode keepCookiesMode(CookieJar::KeepUntilExpiresMode);
 
 	if (keepCookiesModeValue == QLatin1String("keepUntilExit"))
@@ -525,7 +540,7 @@ void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 		keepCookiesMode = CookieJar::AskIfKeepMode;
 	}
 
-	m_cookieJarProxy->setup(getOption(SettingsManager::Network_ThirdPartyCookiesAcceptedHostsOption, url).toStringList(), getOption(SettingsManager::Network_ThirdPartyCookiesRejectedHostsOption, url).toStringList(), generalCookiesPolicy, thirdPartyCookiesPolicy, keepCookiesMode);
+	m_cookieJarProxy->setup(options->getValue(SettingsManager::Network_ThirdPartyCookiesAcceptedHostsOption).toStringList(), options->getValue(SettingsManager::Network_ThirdPartyCookiesRejectedHostsOption).toStringList(), generalCookiesPolicy, thirdPartyCookiesPolicy, keepCookiesMode);
 
 	if (!m_proxyFactory && ((m_widget && m_widget->hasOption(SettingsManager::Network_ProxyOption)) || SettingsManager::hasOverride(Utils::extractHost(url), SettingsManager::Network_ProxyOption)))
 	{
@@ -536,7 +551,19 @@ void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 
 	if (m_proxyFactory)
 	{
-		m_proxyFactory->setProxy(getOption(SettingsManager::Network_ProxyOption, url).toString());
+		m_proxyFactory->setProxy(options->getValue(SettingsManager::Network_ProxyOption).toString());
+	}
+}
+
+void QtWebKitNetworkManager::updateContentBlockingProfiles()
+{
+	if (m_optionsSnapshot && m_optionsSnapshot->getValue(SettingsManager::ContentBlocking_EnableContentBlockingOption).toBool())
+	{
+		m_contentBlockingProfiles = ContentFiltersManager::getProfileIdentifiers(m_optionsSnapshot->getValue(SettingsManager::ContentBlocking_ProfilesOption).toStringList());
+	}
+	else
+	{
+		m_contentBlockingProfiles.clear();
 	}
 }
 
@@ -671,7 +698,14 @@ QNetworkReply* QtWebKitNetworkManager::createRequest(Operation operation, const
 
 		if (needsContentBlockingCheck)
 		{
-			const ContentFiltersManager::CheckResult result(ContentFiltersManager::checkUrl(m_contentBlockingProfiles, baseUrl, request.url(), resourceType));
+			const ContentFiltersManager::CheckResult result(ContentFiltersManager::checkUrl(m_contentBlockingProfiles, baseUrl, request.url(), resourceType, m_widget->getWindowIdentifier()));
+
+			if (result.isPending)
+			{
+				m_hasPendingRequests = true;
+
+				return QNetworkAccessManager::createRequest(GetOperation, QNetworkRequest());
+			}
 
 			if (result.isBlocked)
 			{
@@ -824,6 +858,11 @@ QVariant QtWebKitNetworkManager::getOption(int identifier, const QUrl &url) cons
 	return (m_widget ? m_widget->getOption(identifier, url) : SettingsManager::getOption(identifier, Utils::extractHost(url)));
 }
 
+std::shared_ptr<const SettingsManager::OptionsSnapshot> QtWebKitNetworkManager::getOptionsSnapshot(const QUrl &url) const
+{
+	return (m_widget ? m_widget->getOptionsSnapshot(url) : SettingsManager::getOptionsSnapshot(Utils::extractHost(url)));
+}
+
 QVariant QtWebKitNetworkManager::getPageInformation(WebWidget::PageInformation key) const
 {
 	if (key == WebWidget::RequestsBlockedInformation)
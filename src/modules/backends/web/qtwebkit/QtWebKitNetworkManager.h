@@ -71,6 +71,7 @@ protected:
 	QNetworkReply* createRequest(Operation operation, const QNetworkRequest &request, QIODevice *outgoingData) override;
 	QString getUserAgent() const;
 	QVariant getOption(int identifier, const QUrl &url) const;
+	std::shared_ptr<const SettingsManager::OptionsSnapshot> getOptionsSnapshot(const QUrl &url) const;
 
 protected slots:
 	void handleDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
@@ -80,6 +81,7 @@ protected slots:
 	void handleProxyAuthenticationRequired(const QNetworkProxy &proxy, QAuthenticator *authenticator);
 	void handleSslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
 	void handleLoadFinished(bool result);
+	void updateContentBlockingProfiles();
 
 private:
 	QPointer<QtWebKitWebWidget> m_widget;
@@ -87,6 +89,7 @@ private:
 	QtWebKitCookieJar *m_cookieJarProxy;
 	NetworkProxyFactory *m_proxyFactory;
 	QNetworkReply *m_baseReply;
+	std::shared_ptr<const SettingsManager::OptionsSnapshot> m_optionsSnapshot;
 	QString m_acceptLanguage;
 	QString m_userAgent;
 	QUrl m_formRequestUrl;
@@ -108,6 +111,7 @@ private:
 	int m_loadingSpeedTimer;
 	bool m_areImagesEnabled;
 	bool m_canSendReferrer;
+	bool m_hasPendingRequests;
 	bool m_isWorkingOffline;
 
 	static WebBackend *m_backend;
@@ -311,15 +311,19 @@ void QtWebKitWebWidget::triggerAction(int identifier, const QVariantMap &paramet
 		case ActionsManager::ClearTabHistoryAction:
 			if (parameters.value(QLatin1String("clearGlobalHistory")).toBool())
 			{
+				QVector<quint64> historyIdentifiers;
+
 				for (int i = 0; i < m_page->history()->count(); ++i)
 				{
 					const quint64 historyIdentifier(getGlobalHistoryEntryIdentifier(i));
 
 					if (historyIdentifier > 0)
 					{
-						HistoryManager::removeEntry(historyIdentifier);
+						historyIdentifiers.append(historyIdentifier);
 					}
 				}
+
+				HistoryManager::removeEntries(historyIdentifiers);
 			}
 
 			setUrl(QUrl(QLatin1String("about:blank")));
@@ -1682,40 +1686,41 @@ void QtWebKitWebWidget::updateAmountOfDeferredPlugins()
 
 void QtWebKitWebWidget::updateOptions(const QUrl &url)
 {
-	const QString encoding(getOption(SettingsManager::Content_DefaultCharacterEncodingOption, url).toString());
+	const std::shared_ptr<const SettingsManager::OptionsSnapshot> options(getOptionsSnapshot(url));
+	const QString encoding(options->getValue(SettingsManager::Content_DefaultCharacterEncodingOption).toString());
 #ifdef OTTER_QTWEBKIT_PLUGINS_AVAILABLE
-	const bool arePluginsEnabled(getOption(SettingsManager::Permissions_EnablePluginsOption, url).toString() != QLatin1String("disabled"));
+	const bool arePluginsEnabled(options->getValue(SettingsManager::Permissions_EnablePluginsOption).toString() != QLatin1String("disabled"));
 #endif
 	QWebSettings *settings(m_page->settings());
-	settings->setAttribute(QWebSettings::AutoLoadImages, (getOption(SettingsManager::Permissions_EnableImagesOption, url).toString() != QLatin1String("onlyCached")));
-	settings->setAttribute(QWebSettings::DnsPrefetchEnabled, getOption(SettingsManager::Network_EnableDnsPrefetchOption, url).toBool());
+	settings->setAttribute(QWebSettings::AutoLoadImages, (options->getValue(SettingsManager::Permissions_EnableImagesOption).toString() != QLatin1String("onlyCached")));
+	settings->setAttribute(QWebSettings::DnsPrefetchEnabled, options->getValue(SettingsManager::Network_EnableDnsPrefetchOption).toBool());
 #ifdef OTTER_QTWEBKIT_PLUGINS_AVAILABLE
 	settings->setAttribute(QWebSettings::PluginsEnabled, arePluginsEnabled);
 	settings->setAttribute(QWebSettings::JavaEnabled, arePluginsEnabled);
 #endif
-	settings->setAttribute(QWebSettings::JavascriptEnabled, (m_page->isDisplayingErrorPage() || m_page->isViewingMedia() || getOption(SettingsManager::Permissions_EnableJavaScriptOption, url).toBool()));
-	settings->setAttribute(QWebSettings::JavascriptCanAccessClipboard, getOption(SettingsManager::Permissions_ScriptsCanAccessClipboardOption, url).toBool());
-	settings->setAttribute(QWebSettings::JavascriptCanOpenWindows, (getOption(SettingsManager::Permissions_ScriptsCanOpenWindowsOption, url).toString() != QLatin1String("blockAll")));
-	settings->setAttribute(QWebSettings::WebGLEnabled, getOption(SettingsManager::Permissions_EnableWebglOption, url).toBool());
-	settings->setAttribute(QWebSettings::LocalStorageEnabled, getOption(SettingsManager::Permissions_EnableLocalStorageOption, url).toBool());
-	settings->setAttribute(QWebSettings::OfflineStorageDatabaseEnabled, getOption(SettingsManager::Permissions_EnableOfflineStorageDatabaseOption, url).toBool());
-	settings->setAttribute(QWebSettings::OfflineWebApplicationCacheEnabled, getOption(SettingsManager::Permissions_EnableOfflineWebApplicationCacheOption, url).toBool());
-	settings->setAttribute(QWebSettings::AllowRunningInsecureContent, getOption(SettingsManager::Security_AllowMixedContentOption, url).toBool());
-	settings->setAttribute(QWebSettings::MediaEnabled, getOption(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableMediaOption), url).toBool());
-	settings->setAttribute(QWebSettings::MediaSourceEnabled, getOption(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableMediaSourceOption), url).toBool());
-	settings->setAttribute(QWebSettings::SiteSpecificQuirksEnabled, getOption(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableSiteSpecificQuirksOption), url).toBool());
-	settings->setAttribute(QWebSettings::WebSecurityEnabled, getOption(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableWebSecurityOption), url).toBool());
+	settings->setAttribute(QWebSettings::JavascriptEnabled, (m_page->isDisplayingErrorPage() || m_page->isViewingMedia() || options->getValue(SettingsManager::Permissions_EnableJavaScriptOption).toBool()));
+	settings->setAttribute(QWebSettings::JavascriptCanAccessClipboard, options->getValue(SettingsManager::Permissions_ScriptsCanAccessClipboardOption).toBool());
+	settings->setAttribute(QWebSettings::JavascriptCanOpenWindows, (options->getValue(SettingsManager::Permissions_ScriptsCanOpenWindowsOption).toString() != QLatin1String("blockAll")));
+	settings->setAttribute(QWebSettings::WebGLEnabled, options->getValue(SettingsManager::Permissions_EnableWebglOption).toBool());
+	settings->setAttribute(QWebSettings::LocalStorageEnabled, options->getValue(SettingsManager::Permissions_EnableLocalStorageOption).toBool());
+	settings->setAttribute(QWebSettings::OfflineStorageDatabaseEnabled, options->getValue(SettingsManager::Permissions_EnableOfflineStorageDatabaseOption).toBool());
+	settings->setAttribute(QWebSettings::OfflineWebApplicationCacheEnabled, options->getValue(SettingsManager::Permissions_EnableOfflineWebApplicationCacheOption).toBool());
+	settings->setAttribute(QWebSettings::AllowRunningInsecureContent, options->getValue(SettingsManager::Security_AllowMixedContentOption).toBool());
+	settings->setAttribute(QWebSettings::MediaEnabled, options->getValue(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableMediaOption)).toBool());
+	settings->setAttribute(QWebSettings::MediaSourceEnabled, options->getValue(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableMediaSourceOption)).toBool());
+	settings->setAttribute(QWebSettings::SiteSpecificQuirksEnabled, options->getValue(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableSiteSpecificQuirksOption)).toBool());
+	settings->setAttribute(QWebSettings::WebSecurityEnabled, options->getValue(QtWebKitWebBackend::getOptionIdentifier(QtWebKitWebBackend::QtWebKitBackend_EnableWebSecurityOption)).toBool());
 	settings->setDefaultTextEncoding((encoding == QLatin1String("auto")) ? QString() : encoding);
 
 	disconnect(m_page, &QtWebKitPage::geometryChangeRequested, this, &QtWebKitWebWidget::requestedGeometryChange);
 	disconnect(m_page, &QtWebKitPage::statusBarMessage, this, &QtWebKitWebWidget::setStatusMessage);
 
-	if (getOption(SettingsManager::Permissions_ScriptsCanChangeWindowGeometryOption, url).toBool())
+	if (options->getValue(SettingsManager::Permissions_ScriptsCanChangeWindowGeometryOption).toBool())
 	{
 		connect(m_page, &QtWebKitPage::geometryChangeRequested, this, &QtWebKitWebWidget::requestedGeometryChange);
 	}
 
-	if (getOption(SettingsManager::Permissions_ScriptsCanShowStatusMessagesOption, url).toBool())
+	if (options->getValue(SettingsManager::Permissions_ScriptsCanShowStatusMessagesOption).toBool())
 	{
 		connect(m_page, &QtWebKitPage::statusBarMessage, this, &QtWebKitWebWidget::setStatusMessage);
 	}
@@ -1729,7 +1734,7 @@ void QtWebKitWebWidget::updateOptions(const QUrl &url)
 	m_networkManager->updateOptions(url);
 
 #ifdef OTTER_QTWEBKIT_PLUGINS_AVAILABLE
-	m_canLoadPlugins = (getOption(SettingsManager::Permissions_EnablePluginsOption, url).toString() == QLatin1String("enabled"));
+	m_canLoadPlugins = (options->getValue(SettingsManager::Permissions_EnablePluginsOption).toString() == QLatin1String("enabled"));
 #endif
 }
 
@@ -2298,11 +2303,11 @@ Session::Window::History QtWebKitWebWidget::getHistory() const
 
 		if (identifier > 0)
 		{
-			const HistoryModel::Entry *globalEntry(HistoryManager::getEntry(identifier));
+			const HistoryModel::Entry globalEntry(HistoryManager::getEntry(identifier));
 
-			if (globalEntry)
+			if (globalEntry.isValid())
 			{
-				entry.icon = globalEntry->icon();
+				entry.icon = globalEntry.getIcon();
 			}
 		}
 
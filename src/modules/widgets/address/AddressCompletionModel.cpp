@@ -163,7 +163,10 @@ void AddressCompletionModel::updateModel()
 
 		for (int i = 0; i < entries.count(); ++i)
 		{
-			completions.append(CompletionEntry(entries.at(i).entry->getUrl(), entries.at(i).entry->getTitle(), entries.at(i).match, entries.at(i).entry->getIcon(), entries.at(i).entry->getTimeVisited(), (entries.at(i).isTypedIn ? CompletionEntry::TypedHistoryType : CompletionEntry::HistoryType)));
+			CompletionEntry completionEntry(entries.at(i).entry.getUrl(), entries.at(i).entry.getTitle(), entries.at(i).match, entries.at(i).entry.getIcon(), entries.at(i).entry.getTimeVisited(), (entries.at(i).isTypedIn ? CompletionEntry::TypedHistoryType : CompletionEntry::HistoryType));
+			completionEntry.isInlineAllowed = entries.at(i).isPrefixMatch;
+
+			completions.append(completionEntry);
 		}
 	}
 
@@ -178,7 +181,7 @@ void AddressCompletionModel::updateModel()
 
 		for (int i = 0; i < entries.count(); ++i)
 		{
-			completions.append(CompletionEntry(entries.at(i).entry->getUrl(), entries.at(i).entry->getTitle(), entries.at(i).match, entries.at(i).entry->getIcon(), entries.at(i).entry->getTimeVisited(), CompletionEntry::TypedHistoryType, entries.at(i).entry->getIdentifier()));
+			completions.append(CompletionEntry(entries.at(i).entry.getUrl(), entries.at(i).entry.getTitle(), entries.at(i).match, entries.at(i).entry.getIcon(), entries.at(i).entry.getTimeVisited(), CompletionEntry::TypedHistoryType, entries.at(i).entry.getIdentifier()));
 		}
 	}
 
@@ -288,6 +291,11 @@ QVariant AddressCompletionModel::data(const QModelIndex &index, int role) const
 		case KeywordRole:
 			return m_completions.at(index.row()).keyword;
 		case MatchRole:
+			if (!m_completions.at(index.row()).isInlineAllowed)
+			{
+				return {};
+			}
+
 			return (m_completions.at(index.row()).match.isEmpty() ? m_completions.at(index.row()).url.toString() : m_completions.at(index.row()).match);
 		case TimeVisitedRole:
 			return m_completions.at(index.row()).timeVisited;
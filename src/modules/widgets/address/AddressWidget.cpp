@@ -321,7 +321,7 @@ AddressWidget::AddressWidget(Window *window, QWidget *parent) : LineEditWidget(p
 	{
 		if (index.isValid() && index.data(AddressCompletionModel::IsRemovableRole).toBool() && index.data(AddressCompletionModel::TypeRole).toInt() == AddressCompletionModel::CompletionEntry::TypedHistoryType)
 		{
-			HistoryManager::getTypedHistoryModel()->removeEntry(index.data(AddressCompletionModel::HistoryIdentifierRole).toULongLong());
+			HistoryManager::getTypedHistoryModel()->removeEntries({index.data(AddressCompletionModel::HistoryIdentifierRole).toULongLong()});
 
 			updateCompletion(true, true);
 		}
@@ -789,7 +789,7 @@ void AddressWidget::showCompletion(bool isTypedHistory)
 				menu.addSeparator();
 				menu.addAction(ThemesManager::createIcon(QLatin1String("edit-delete")), tr("Remove Entry"), this, [&]()
 				{
-					HistoryManager::getTypedHistoryModel()->removeEntry(index.data(AddressCompletionModel::HistoryIdentifierRole).toULongLong());
+					HistoryManager::getTypedHistoryModel()->removeEntries({index.data(AddressCompletionModel::HistoryIdentifierRole).toULongLong()});
 
 					updateCompletion(true, true);
 				});
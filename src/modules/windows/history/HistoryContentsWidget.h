@@ -23,8 +23,6 @@
 #include "../../../core/HistoryManager.h"
 #include "../../../ui/ContentsWidget.h"
 
-#include <QtGui/QStandardItemModel>
-
 namespace Otter
 {
 
@@ -33,6 +31,7 @@ namespace Ui
 	class HistoryContentsWidget;
 }
 
+class HistoryGroupingModel;
 class Window;
 
 class HistoryContentsWidget final : public ContentsWidget
@@ -40,13 +39,6 @@ class HistoryContentsWidget final : public ContentsWidget
 	Q_OBJECT
 
 public:
-	enum DataRole
-	{
-		IdentifierRole = Qt::UserRole,
-		TimeVisitedRole,
-		GroupDateRole
-	};
-
 	explicit HistoryContentsWidget(const QVariantMap &parameters, Window *window, QWidget *parent);
 	~HistoryContentsWidget();
 
@@ -63,7 +55,6 @@ public slots:
 
 protected:
 	void changeEvent(QEvent *event) override;
-	QStandardItem* findEntry(quint64 identifier);
 	quint64 getEntry(const QModelIndex &index) const;
 
 protected slots:
@@ -71,13 +62,14 @@ protected slots:
 	void removeEntry();
 	void removeDomainEntries();
 	void openEntry();
-	void handleEntryAdded(HistoryModel::Entry *entry);
-	void handleEntryModified(HistoryModel::Entry *entry);
-	void handleEntryRemoved(HistoryModel::Entry *entry);
+	void fetchEntries();
+	void filterEntries(const QString &filter);
+	void expandGroups();
 	void showContextMenu(const QPoint &position);
 
 private:
-	QStandardItemModel *m_model;
+	HistoryGroupingModel *m_model;
+	QString m_filterString;
 	bool m_isLoading;
 	Ui::HistoryContentsWidget *m_ui;
 };
@@ -0,0 +1,649 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2013 - 2023 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "HistoryGroupingModel.h"
+#include "../../../core/ThemesManager.h"
+#include "../../../core/Utils.h"
+#include "../../../ui/ItemViewWidget.h"
+
+#include <algorithm>
+
+namespace Otter
+{
+
+HistoryGroupingModel::HistoryGroupingModel(HistoryModel *model, QObject *parent) : QAbstractItemModel(parent),
+	m_model(model)
+{
+	createGroups();
+
+	connect(m_model, &HistoryModel::modelAboutToBeReset, this, &HistoryGroupingModel::handleModelAboutToBeReset);
+	connect(m_model, &HistoryModel::modelReset, this, &HistoryGroupingModel::handleModelReset);
+	connect(m_model, &HistoryModel::rowsInserted, this, &HistoryGroupingModel::handleRowsInserted);
+	connect(m_model, &HistoryModel::rowsRemoved, this, &HistoryGroupingModel::handleRowsRemoved);
+	connect(m_model, &HistoryModel::dataChanged, this, &HistoryGroupingModel::handleDataChanged);
+}
+
+void HistoryGroupingModel::createGroups()
+{
+	const QDate date(QDate::currentDate());
+
+	m_dates = {date, date.addDays(-1), date.addDays(-7), date.addDays(-14), date.addDays(-30), date.addDays(-365)};
+	m_groups = QVector<Group>(GroupsAmount);
+
+	const QVector<int> boundaries(getGroupBoundaries());
+
+	if (!isFiltered())
+	{
+		for (int i = 0; i < GroupsAmount; ++i)
+		{
+			m_groups[i].firstRow = ((i == 0) ? 0 : boundaries.at(i - 1));
+			m_groups[i].rowsAmount = (boundaries.at(i) - m_groups.at(i).firstRow);
+		}
+
+		return;
+	}
+
+	const QVector<int> rows(m_model->getMatchingRows(m_filter));
+	int group(0);
+
+	for (int i = 0; i < rows.count(); ++i)
+	{
+		while (rows.at(i) >= boundaries.at(group))
+		{
+			++group;
+		}
+
+		m_groups[group].rows.append(rows.at(i));
+	}
+
+	for (int i = 0; i < GroupsAmount; ++i)
+	{
+		m_groups[i].rowsAmount = m_groups.at(i).rows.count();
+	}
+}
+
+void HistoryGroupingModel::removeGroupRows(int group, int row, int amount)
+{
+	const int groupRow(getGroupRow(group));
+
+	if (amount == m_groups.at(group).rowsAmount)
+	{
+		beginRemoveRows({}, groupRow, groupRow);
+	}
+	else
+	{
+		beginRemoveRows(index(groupRow, 0), row, (row + amount - 1));
+	}
+
+	if (isFiltered())
+	{
+		m_groups[group].rows.remove(row, amount);
+	}
+
+	m_groups[group].rowsAmount -= amount;
+
+	endRemoveRows();
+}
+
+void HistoryGroupingModel::handleModelAboutToBeReset()
+{
+	beginResetModel();
+}
+
+void HistoryGroupingModel::handleModelReset()
+{
+	createGroups();
+
+	endResetModel();
+
+	if (isFiltered() && m_model->canFetchMore({}))
+	{
+		m_model->loadAll();
+	}
+}
+
+void HistoryGroupingModel::handleRowsInserted(const QModelIndex &parent, int first, int last)
+{
+	if (parent.isValid())
+	{
+		return;
+	}
+
+	const QVector<int> boundaries(getGroupBoundaries());
+
+	if (isFiltered())
+	{
+		if (first != last)
+		{
+			beginResetModel();
+			createGroups();
+			endResetModel();
+
+			return;
+		}
+
+		for (int i = 0; i < GroupsAmount; ++i)
+		{
+			for (int j = 0; j < m_groups.at(i).rows.count(); ++j)
+			{
+				if (m_groups.at(i).rows.at(j) >= first)
+				{
+					++m_groups[i].rows[j];
+				}
+			}
+		}
+
+		if (!m_model->matchesQuery(m_model->index(first).data(HistoryModel::IdentifierRole).toULongLong(), m_filter))
+		{
+			return;
+		}
+
+		int group(0);
+
+		while (first >= boundaries.at(group))
+		{
+			++group;
+		}
+
+		const int groupRow(getGroupRow(group));
+		const int row(static_cast<int>(std::lower_bound(m_groups.at(group).rows.constBegin(), m_groups.at(group).rows.constEnd(), first) - m_groups.at(group).rows.constBegin()));
+
+		if (m_groups.at(group).rowsAmount == 0)
+		{
+			beginInsertRows({}, groupRow, groupRow);
+		}
+		else
+		{
+			beginInsertRows(index(groupRow, 0), row, row);
+		}
+
+		m_groups[group].rows.insert(row, first);
+		m_groups[group].rowsAmount = m_groups.at(group).rows.count();
+
+		endInsertRows();
+
+		return;
+	}
+
+	int insertedAmount(0);
+
+	for (int i = 0; i < GroupsAmount; ++i)
+	{
+		const int amount(boundaries.at(i) - ((i == 0) ? 0 : boundaries.at(i - 1)) - m_groups.at(i).rowsAmount);
+
+		if (amount < 0)
+		{
+			insertedAmount = -1;
+
+			break;
+		}
+
+		insertedAmount += amount;
+	}
+
+	if (insertedAmount != (last - first + 1))
+	{
+		beginResetModel();
+		createGroups();
+		endResetModel();
+
+		return;
+	}
+
+	for (int i = 0; i < GroupsAmount; ++i)
+	{
+		const int firstRow((i == 0) ? 0 : boundaries.at(i - 1));
+		const int rowsAmount(boundaries.at(i) - firstRow);
+		const int amount(rowsAmount - m_groups.at(i).rowsAmount);
+
+		if (amount == 0)
+		{
+			m_groups[i].firstRow = firstRow;
+
+			continue;
+		}
+
+		const int groupRow(getGroupRow(i));
+
+		if (m_groups.at(i).rowsAmount == 0)
+		{
+			beginInsertRows({}, groupRow, groupRow);
+		}
+		else
+		{
+			const int row(qMax(first, firstRow) - firstRow);
+
+			beginInsertRows(index(groupRow, 0), row, (row + amount - 1));
+		}
+
+		m_groups[i].firstRow = firstRow;
+		m_groups[i].rowsAmount = rowsAmount;
+
+		endInsertRows();
+	}
+}
+
+void HistoryGroupingModel::handleRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+	if (parent.isValid())
+	{
+		return;
+	}
+
+	const int amount(last - first + 1);
+
+	if (isFiltered())
+	{
+		for (int i = 0; i < GroupsAmount; ++i)
+		{
+			const QVector<int> &rows(m_groups.at(i).rows);
+			const int firstRow(static_cast<int>(std::lower_bound(rows.constBegin(), rows.constEnd(), first) - rows.constBegin()));
+			const int lastRow(static_cast<int>(std::upper_bound(rows.constBegin(), rows.constEnd(), last) - rows.constBegin()));
+
+			if (firstRow < lastRow)
+			{
+				removeGroupRows(i, firstRow, (lastRow - firstRow));
+			}
+		}
+
+		for (int i = 0; i < GroupsAmount; ++i)
+		{
+			for (int j = 0; j < m_groups.at(i).rows.count(); ++j)
+			{
+				if (m_groups.at(i).rows.at(j) > last)
+				{
+					m_groups[i].rows[j] -= amount;
+				}
+			}
+		}
+
+		return;
+	}
+
+	int removedAmount(0);
+
+	for (int i = 0; i < GroupsAmount; ++i)
+	{
+		const int groupFirstRow(m_groups.at(i).firstRow);
+		const int firstRow(qMax(first, groupFirstRow));
+		const int lastRow(qMin(last, (groupFirstRow + m_groups.at(i).rowsAmount - 1)));
+
+		m_groups[i].firstRow -= removedAmount;
+
+		if (firstRow <= lastRow)
+		{
+			removeGroupRows(i, (firstRow - groupFirstRow), (lastRow - firstRow + 1));
+
+			removedAmount += (lastRow - firstRow + 1);
+		}
+	}
+}
+
+void HistoryGroupingModel::handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+	if (topLeft.parent().isValid())
+	{
+		return;
+	}
+
+	for (int i = topLeft.row(); i <= bottomRight.row(); ++i)
+	{
+		for (int j = 0; j < GroupsAmount; ++j)
+		{
+			const Group &group(m_groups.at(j));
+			int row(-1);
+
+			if (isFiltered())
+			{
+				const QVector<int>::const_iterator iterator(std::lower_bound(group.rows.constBegin(), group.rows.constEnd(), i));
+
+				if (iterator != group.rows.constEnd() && *iterator == i)
+				{
+					row = static_cast<int>(iterator - group.rows.constBegin());
+				}
+			}
+			else if (i >= group.firstRow && i < (group.firstRow + group.rowsAmount))
+			{
+				row = (i - group.firstRow);
+			}
+
+			if (row >= 0)
+			{
+				const QModelIndex parent(index(getGroupRow(j), 0));
+
+				emit dataChanged(index(row, 0, parent), index(row, 2, parent));
+
+				break;
+			}
+		}
+	}
+}
+
+void HistoryGroupingModel::setFilter(const QString &filter)
+{
+	if (filter == m_filter)
+	{
+		return;
+	}
+
+	if (!filter.trimmed().isEmpty())
+	{
+		m_model->loadAll();
+	}
+
+	beginResetModel();
+
+	m_filter = filter;
+
+	createGroups();
+
+	endResetModel();
+}
+
+void HistoryGroupingModel::reloadModel()
+{
+	beginResetModel();
+	createGroups();
+	endResetModel();
+}
+
+QModelIndex HistoryGroupingModel::index(int row, int column, const QModelIndex &parent) const
+{
+	if (row < 0 || column < 0 || column >= columnCount())
+	{
+		return {};
+	}
+
+	if (!parent.isValid())
+	{
+		return ((getGroup(row) < 0) ? QModelIndex() : createIndex(row, column, quintptr(0)));
+	}
+
+	if (parent.internalId() != 0 || parent.column() != 0)
+	{
+		return {};
+	}
+
+	const int group(getGroup(parent.row()));
+
+	if (group < 0 || row >= m_groups.at(group).rowsAmount)
+	{
+		return {};
+	}
+
+	return createIndex(row, column, static_cast<quintptr>(group + 1));
+}
+
+QModelIndex HistoryGroupingModel::parent(const QModelIndex &child) const
+{
+	if (!child.isValid() || child.internalId() == 0)
+	{
+		return {};
+	}
+
+	return createIndex(getGroupRow(static_cast<int>(child.internalId() - 1)), 0, quintptr(0));
+}
+
+QDate HistoryGroupingModel::getDate(int row) const
+{
+	return m_model->index(row).data(HistoryModel::TimeVisitedRole).toDateTime().date();
+}
+
+QVariant HistoryGroupingModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid())
+	{
+		return {};
+	}
+
+	if (index.internalId() == 0)
+	{
+		if (index.column() != 0)
+		{
+			return {};
+		}
+
+		if (role == Qt::DecorationRole)
+		{
+			return ThemesManager::createIcon(QLatin1String("inode-directory"));
+		}
+
+		if (role != Qt::DisplayRole)
+		{
+			return {};
+		}
+
+		switch (getGroup(index.row()))
+		{
+			case 0:
+				return tr("Today");
+			case 1:
+				return tr("Yesterday");
+			case 2:
+				return tr("Earlier This Week");
+			case 3:
+				return tr("Previous Week");
+			case 4:
+				return tr("Earlier This Month");
+			case 5:
+				return tr("Earlier This Year");
+			case 6:
+				return tr("Older");
+			default:
+				break;
+		}
+
+		return {};
+	}
+
+	const QModelIndex sourceIndex(m_model->index(getSourceRow(index)));
+
+	switch (index.column())
+	{
+		case 0:
+			if (role == Qt::DisplayRole)
+			{
+				return sourceIndex.data(HistoryModel::UrlRole).toUrl().toDisplayString().replace(QLatin1String("%23"), QString(QLatin1Char('#')));
+			}
+
+			if (role == Qt::DecorationRole || role == HistoryModel::IdentifierRole)
+			{
+				return sourceIndex.data(role);
+			}
+
+			break;
+		case 1:
+			if (role == Qt::DisplayRole)
+			{
+				return sourceIndex.data(HistoryModel::TitleRole);
+			}
+
+			break;
+		case 2:
+			if (role == Qt::DisplayRole)
+			{
+				return Utils::formatDateTime(sourceIndex.data(HistoryModel::TimeVisitedRole).toDateTime());
+			}
+
+			if (role == Qt::ToolTipRole)
+			{
+				return Utils::formatDateTime(sourceIndex.data(HistoryModel::TimeVisitedRole).toDateTime(), {}, false);
+			}
+
+			if (role == HistoryModel::TimeVisitedRole)
+			{
+				return sourceIndex.data(role);
+			}
+
+			break;
+		default:
+			break;
+	}
+
+	return {};
+}
+
+QVariant HistoryGroupingModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal)
+	{
+		return {};
+	}
+
+	if (role == HeaderViewWidget::WidthRole)
+	{
+		return ((section < 2) ? QVariant(300) : QVariant());
+	}
+
+	if (role != Qt::DisplayRole)
+	{
+		return {};
+	}
+
+	switch (section)
+	{
+		case 0:
+			return tr("Address");
+		case 1:
+			return tr("Title");
+		case 2:
+			return tr("Date");
+		default:
+			break;
+	}
+
+	return {};
+}
+
+QVector<int> HistoryGroupingModel::getGroupBoundaries() const
+{
+	const int rowsAmount(m_model->rowCount());
+	QVector<int> boundaries;
+	boundaries.reserve(GroupsAmount);
+
+	int firstRow(0);
+
+	for (int i = 0; i < m_dates.count(); ++i)
+	{
+		int lastRow(rowsAmount);
+
+		while (firstRow < lastRow)
+		{
+			const int row((firstRow + lastRow) / 2);
+
+			if (getDate(row) >= m_dates.at(i))
+			{
+				firstRow = (row + 1);
+			}
+			else
+			{
+				lastRow = row;
+			}
+		}
+
+		boundaries.append(firstRow);
+	}
+
+	boundaries.append(rowsAmount);
+
+	return boundaries;
+}
+
+Qt::ItemFlags HistoryGroupingModel::flags(const QModelIndex &index) const
+{
+	if (!index.isValid())
+	{
+		return Qt::NoItemFlags;
+	}
+
+	return ((index.internalId() == 0) ? (Qt::ItemIsEnabled | Qt::ItemIsSelectable) : (Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemNeverHasChildren));
+}
+
+int HistoryGroupingModel::getGroup(int row) const
+{
+	for (int i = 0; i < GroupsAmount; ++i)
+	{
+		if (m_groups.at(i).rowsAmount == 0)
+		{
+			continue;
+		}
+
+		if (row == 0)
+		{
+			return i;
+		}
+
+		--row;
+	}
+
+	return -1;
+}
+
+int HistoryGroupingModel::getGroupRow(int group) const
+{
+	int row(0);
+
+	for (int i = 0; i < group; ++i)
+	{
+		if (m_groups.at(i).rowsAmount > 0)
+		{
+			++row;
+		}
+	}
+
+	return row;
+}
+
+int HistoryGroupingModel::getSourceRow(const QModelIndex &index) const
+{
+	const Group &group(m_groups.at(static_cast<int>(index.internalId() - 1)));
+
+	return (isFiltered() ? group.rows.value(index.row(), -1) : (group.firstRow + index.row()));
+}
+
+int HistoryGroupingModel::rowCount(const QModelIndex &parent) const
+{
+	if (!parent.isValid())
+	{
+		return getGroupRow(GroupsAmount);
+	}
+
+	if (parent.internalId() != 0 || parent.column() != 0)
+	{
+		return 0;
+	}
+
+	const int group(getGroup(parent.row()));
+
+	return ((group < 0) ? 0 : m_groups.at(group).rowsAmount);
+}
+
+int HistoryGroupingModel::columnCount(const QModelIndex &parent) const
+{
+	Q_UNUSED(parent)
+
+	return 3;
+}
+
+bool HistoryGroupingModel::isFiltered() const
+{
+	return !m_filter.trimmed().isEmpty();
+}
+
+}
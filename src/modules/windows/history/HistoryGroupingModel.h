@@ -0,0 +1,83 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2013 - 2023 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_HISTORYGROUPINGMODEL_H
+#define OTTER_HISTORYGROUPINGMODEL_H
+
+#include "../../../core/HistoryModel.h"
+
+namespace Otter
+{
+
+class HistoryGroupingModel final : public QAbstractItemModel
+{
+	Q_OBJECT
+
+public:
+	explicit HistoryGroupingModel(HistoryModel *model, QObject *parent = nullptr);
+
+	void setFilter(const QString &filter);
+	void reloadModel();
+	QModelIndex index(int row, int column, const QModelIndex &parent = {}) const override;
+	QModelIndex parent(const QModelIndex &child) const override;
+	QVariant data(const QModelIndex &index, int role) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	Qt::ItemFlags flags(const QModelIndex &index) const override;
+	int rowCount(const QModelIndex &parent = {}) const override;
+	int columnCount(const QModelIndex &parent = {}) const override;
+
+protected:
+	enum GroupInformation
+	{
+		GroupsAmount = 7
+	};
+
+	struct Group final
+	{
+		QVector<int> rows;
+		int firstRow = 0;
+		int rowsAmount = 0;
+	};
+
+	void createGroups();
+	void removeGroupRows(int group, int row, int amount);
+	QVector<int> getGroupBoundaries() const;
+	QDate getDate(int row) const;
+	int getGroup(int row) const;
+	int getGroupRow(int group) const;
+	int getSourceRow(const QModelIndex &index) const;
+	bool isFiltered() const;
+
+protected slots:
+	void handleModelAboutToBeReset();
+	void handleModelReset();
+	void handleRowsInserted(const QModelIndex &parent, int first, int last);
+	void handleRowsRemoved(const QModelIndex &parent, int first, int last);
+	void handleDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+private:
+	HistoryModel *m_model;
+	QString m_filter;
+	QVector<QDate> m_dates;
+	QVector<Group> m_groups;
+};
+
+}
+
+#endif
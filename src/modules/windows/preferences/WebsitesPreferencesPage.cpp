@@ -24,6 +24,7 @@
 
 #include "ui_WebsitesPreferencesPage.h"
 
+#include <QtGui/QStandardItemModel>
 #include <QtWidgets/QMessageBox>
 
 namespace Otter
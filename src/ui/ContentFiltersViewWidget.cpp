@@ -133,6 +133,11 @@ bool ContentFiltersTitleDelegate::helpEvent(QHelpEvent *event, QAbstractItemView
 			toolTip.append(tr("No update URL"));
 		}
 
+		if (profile && profile->getMemoryUsage() > 0)
+		{
+			toolTip.append(tr("Memory usage: %1").arg(Utils::formatUnit(profile->getMemoryUsage())));
+		}
+
 		if (!toolTip.isEmpty())
 		{
 			toolTip.prepend(displayText(index.data(Qt::DisplayRole), view->locale()));
@@ -257,6 +257,7 @@ void WebWidget::clearOptions()
 	const QList<int> identifiers(m_options.keys());
 
 	m_options.clear();
+	m_optionsSnapshot.reset();
 
 	for (int i = 0; i < identifiers.count(); ++i)
 	{
@@ -679,6 +680,8 @@ void WebWidget::setOption(int identifier, const QVariant &value)
 		m_options[identifier] = value;
 	}
 
+	m_optionsSnapshot.reset();
+
 	SessionsManager::markSessionAsModified();
 
 	switch (identifier)
@@ -749,6 +752,8 @@ void WebWidget::setOptions(const QHash<int, QVariant> &options, const QStringLis
 		}
 	}
 
+	m_optionsSnapshot.reset();
+
 	const QString host(Utils::extractHost(getUrl()));
 
 	for (int i = 0; i < identifiers.count(); ++i)
@@ -1561,6 +1566,37 @@ QHash<int, QVariant> WebWidget::getOptions() const
 	return m_options;
 }
 
+std::shared_ptr<const SettingsManager::OptionsSnapshot> WebWidget::getOptionsSnapshot(const QUrl &url) const
+{
+	const std::shared_ptr<const SettingsManager::OptionsSnapshot> snapshot(SettingsManager::getOptionsSnapshot(Utils::extractHost(url.isEmpty() ? getUrl() : url)));
+
+	if (m_options.isEmpty())
+	{
+		return snapshot;
+	}
+
+	if (m_optionsSnapshot && m_baseOptionsSnapshot == snapshot)
+	{
+		return m_optionsSnapshot;
+	}
+
+	std::shared_ptr<SettingsManager::OptionsSnapshot> widgetSnapshot(std::make_shared<SettingsManager::OptionsSnapshot>(*snapshot));
+	QHash<int, QVariant>::const_iterator iterator;
+
+	for (iterator = m_options.constBegin(); iterator != m_options.constEnd(); ++iterator)
+	{
+		if (iterator.key() >= 0 && iterator.key() < widgetSnapshot->values.count())
+		{
+			widgetSnapshot->values[iterator.key()] = iterator.value();
+		}
+	}
+
+	m_baseOptionsSnapshot = snapshot;
+	m_optionsSnapshot = widgetSnapshot;
+
+	return m_optionsSnapshot;
+}
+
 QMap<QByteArray, QByteArray> WebWidget::getHeaders() const
 {
 	return {};
@@ -27,6 +27,7 @@
 #include "../core/NetworkManager.h"
 #include "../core/PasswordsManager.h"
 #include "../core/SessionsManager.h"
+#include "../core/SettingsManager.h"
 #include "../core/SpellCheckManager.h"
 
 #include <QtGui/QHelpEvent>
@@ -36,6 +37,8 @@
 #include <QtPrintSupport/QPrinter>
 #include <QtWidgets/QWidget>
 
+#include <memory>
+
 namespace Otter
 {
 
@@ -248,6 +251,7 @@ public:
 	virtual QVector<LinkUrl> getSearchEngines() const;
 	virtual QVector<NetworkManager::ResourceInformation> getBlockedRequests() const;
 	QHash<int, QVariant> getOptions() const;
+	std::shared_ptr<const SettingsManager::OptionsSnapshot> getOptionsSnapshot(const QUrl &url = {}) const;
 	virtual QMap<QByteArray, QByteArray> getHeaders() const;
 	virtual QMultiMap<QString, QString> getMetaData() const;
 	virtual ContentStates getContentState() const;
@@ -332,6 +336,8 @@ private:
 	QPoint m_toolTipPosition;
 	QStringList m_toolTip;
 	QHash<int, QVariant> m_options;
+	mutable std::shared_ptr<const SettingsManager::OptionsSnapshot> m_optionsSnapshot;
+	mutable std::shared_ptr<const SettingsManager::OptionsSnapshot> m_baseOptionsSnapshot;
 	QHash<ChangeWatcher, QVector<QObject*> > m_changeWatchers;
 	HitTestResult m_hitResult;
 	quint64 m_windowIdentifier;